@@ -0,0 +1,612 @@
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace rocket {
+	static Aabb combine(const Aabb& a, const Aabb& b)
+	{
+		return { glm::min(a.lower, b.lower), glm::max(a.upper, b.upper) };
+	}
+
+	static float perimeter(const Aabb& box)
+	{
+		glm::vec2 size = box.upper - box.lower;
+		return 2.0f * (size.x + size.y);
+	}
+
+	std::unique_ptr<Broadphase> Broadphase::create(BroadphaseType type)
+	{
+		switch (type) {
+		case BroadphaseType::UNIFORM_GRID:
+			return std::make_unique<UniformGridBroadphase>();
+		case BroadphaseType::SORT_AND_SWEEP:
+			return std::make_unique<SortAndSweepBroadphase>();
+		case BroadphaseType::DYNAMIC_TREE:
+			return std::make_unique<DynamicTreeBroadphase>();
+		}
+		throw std::runtime_error("Unknown broadphase type");
+	}
+
+	const char* Broadphase::typeName(BroadphaseType type)
+	{
+		switch (type) {
+		case BroadphaseType::UNIFORM_GRID:
+			return "Uniform grid";
+		case BroadphaseType::SORT_AND_SWEEP:
+			return "Sort and sweep";
+		case BroadphaseType::DYNAMIC_TREE:
+			return "Dynamic AABB tree";
+		}
+		return "Unknown";
+	}
+
+	glm::ivec2 UniformGridBroadphase::cellOf(glm::vec2 position) const
+	{
+		// Clamped as floats, query boxes far outside the grid would overflow int
+		glm::vec2 cell = glm::floor((position - origin) / currentCellSize);
+		return { static_cast<int>(glm::clamp(cell.x, 0.0f, static_cast<float>(gridWidth - 1))),
+			static_cast<int>(glm::clamp(cell.y, 0.0f, static_cast<float>(gridHeight - 1))) };
+	}
+
+	void UniformGridBroadphase::update(const std::vector<Aabb>& newBoxes)
+	{
+		boxes = newBoxes;
+		gridWidth = 0;
+		gridHeight = 0;
+		cellStart.assign(1, 0);
+		cellProxies.clear();
+		if (boxes.empty()) {
+			return;
+		}
+
+		Aabb bounds = boxes[0];
+		float extentSum = 0.0f;
+		for (const auto& box : boxes) {
+			bounds = combine(bounds, box);
+			extentSum += std::max(box.upper.x - box.lower.x, box.upper.y - box.lower.y);
+		}
+		currentCellSize = cellSize > 0.0f ? cellSize : 2.0f * extentSum / boxes.size();
+		currentCellSize = std::max(currentCellSize, 1e-6f);
+		glm::vec2 span = bounds.upper - bounds.lower;
+		float maxCells = static_cast<float>(maxCellsPerBox) * boxes.size();
+		while ((std::floor(span.x / currentCellSize) + 1.0f) * (std::floor(span.y / currentCellSize) + 1.0f) > maxCells) {
+			currentCellSize *= 1.25f;
+		}
+		origin = bounds.lower;
+		gridWidth = static_cast<int>(span.x / currentCellSize) + 1;
+		gridHeight = static_cast<int>(span.y / currentCellSize) + 1;
+
+		// Counting sort of (cell, proxy) entries, a box goes into every cell it covers
+		cellStart.assign(static_cast<size_t>(gridWidth) * gridHeight + 1, 0);
+		for (const auto& box : boxes) {
+			glm::ivec2 first = cellOf(box.lower);
+			glm::ivec2 last = cellOf(box.upper);
+			for (int y = first.y; y <= last.y; y++) {
+				for (int x = first.x; x <= last.x; x++) {
+					cellStart[y * gridWidth + x + 1]++;
+				}
+			}
+		}
+		for (size_t cell = 1; cell < cellStart.size(); cell++) {
+			cellStart[cell] += cellStart[cell - 1];
+		}
+		cellProxies.resize(cellStart.back());
+		std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+		for (uint32_t proxy = 0; proxy < boxes.size(); proxy++) {
+			glm::ivec2 first = cellOf(boxes[proxy].lower);
+			glm::ivec2 last = cellOf(boxes[proxy].upper);
+			for (int y = first.y; y <= last.y; y++) {
+				for (int x = first.x; x <= last.x; x++) {
+					cellProxies[cursor[y * gridWidth + x]++] = proxy;
+				}
+			}
+		}
+	}
+
+	void UniformGridBroadphase::findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const
+	{
+		for (int y = 0; y < gridHeight; y++) {
+			for (int x = 0; x < gridWidth; x++) {
+				uint32_t begin = cellStart[y * gridWidth + x];
+				uint32_t end = cellStart[y * gridWidth + x + 1];
+				for (uint32_t i = begin; i < end; i++) {
+					uint32_t a = cellProxies[i];
+					for (uint32_t j = i + 1; j < end; j++) {
+						uint32_t b = cellProxies[j];
+						if (!boxes[a].overlaps(boxes[b])) {
+							continue;
+						}
+						// Both boxes cover the cell of their intersection's lower corner, only that cell reports the pair
+						glm::ivec2 owner = cellOf(glm::max(boxes[a].lower, boxes[b].lower));
+						if (owner.x == x && owner.y == y) {
+							pairs.push_back({ std::min(a, b), std::max(a, b) });
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void UniformGridBroadphase::query(const Aabb& box, std::vector<uint32_t>& results) const
+	{
+		if (boxes.empty()) {
+			return;
+		}
+		glm::ivec2 first = cellOf(box.lower);
+		glm::ivec2 last = cellOf(box.upper);
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				for (uint32_t i = cellStart[y * gridWidth + x]; i < cellStart[y * gridWidth + x + 1]; i++) {
+					uint32_t proxy = cellProxies[i];
+					if (!box.overlaps(boxes[proxy])) {
+						continue;
+					}
+					glm::ivec2 owner = cellOf(glm::max(box.lower, boxes[proxy].lower));
+					if (owner.x == x && owner.y == y) {
+						results.push_back(proxy);
+					}
+				}
+			}
+		}
+	}
+
+	void SortAndSweepBroadphase::update(const std::vector<Aabb>& newBoxes)
+	{
+		lastSortSwaps = 0;
+		if (newBoxes.size() != boxes.size()) {
+			boxes = newBoxes;
+			order.resize(boxes.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				return boxes[a].lower.x < boxes[b].lower.x;
+			});
+		}
+		else {
+			boxes = newBoxes;
+			// Insertion sort, proxies move little between updates so this is close to one pass over the array
+			for (size_t i = 1; i < order.size(); i++) {
+				uint32_t proxy = order[i];
+				float key = boxes[proxy].lower.x;
+				size_t j = i;
+				while (j > 0 && boxes[order[j - 1]].lower.x > key) {
+					order[j] = order[j - 1];
+					j--;
+					lastSortSwaps++;
+				}
+				order[j] = proxy;
+			}
+		}
+
+		sortedLowerX.resize(order.size());
+		maxWidth = 0.0f;
+		for (size_t i = 0; i < order.size(); i++) {
+			const Aabb& box = boxes[order[i]];
+			sortedLowerX[i] = box.lower.x;
+			maxWidth = std::max(maxWidth, box.upper.x - box.lower.x);
+		}
+	}
+
+	void SortAndSweepBroadphase::findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const
+	{
+		for (size_t i = 0; i < order.size(); i++) {
+			uint32_t a = order[i];
+			for (size_t j = i + 1; j < order.size(); j++) {
+				uint32_t b = order[j];
+				if (boxes[b].lower.x > boxes[a].upper.x) {
+					break;
+				}
+				if (boxes[b].lower.y > boxes[a].upper.y || boxes[b].upper.y < boxes[a].lower.y) {
+					continue;
+				}
+				pairs.push_back({ std::min(a, b), std::max(a, b) });
+			}
+		}
+	}
+
+	void SortAndSweepBroadphase::query(const Aabb& box, std::vector<uint32_t>& results) const
+	{
+		// No proxy wider than maxWidth can reach box from further left
+		size_t i = std::lower_bound(sortedLowerX.begin(), sortedLowerX.end(), box.lower.x - maxWidth) - sortedLowerX.begin();
+		for (; i < order.size() && sortedLowerX[i] <= box.upper.x; i++) {
+			if (box.overlaps(boxes[order[i]])) {
+				results.push_back(order[i]);
+			}
+		}
+	}
+
+	int DynamicTreeBroadphase::allocateNode()
+	{
+		int node;
+		if (freeList == NULL_NODE) {
+			node = static_cast<int>(nodes.size());
+			nodes.emplace_back();
+		}
+		else {
+			node = freeList;
+			freeList = nodes[node].parent;
+		}
+		nodes[node].parent = NULL_NODE;
+		nodes[node].child1 = NULL_NODE;
+		nodes[node].child2 = NULL_NODE;
+		nodes[node].height = 0;
+		nodes[node].proxy = UINT32_MAX;
+		return node;
+	}
+
+	void DynamicTreeBroadphase::freeNode(int node)
+	{
+		nodes[node].parent = freeList;
+		nodes[node].height = -1;
+		freeList = node;
+	}
+
+	void DynamicTreeBroadphase::insertLeaf(int leaf)
+	{
+		if (root == NULL_NODE) {
+			root = leaf;
+			nodes[root].parent = NULL_NODE;
+			return;
+		}
+
+		// Walk down to the cheapest sibling, the cost of a node is its perimeter plus the growth it causes in its ancestors
+		Aabb leafBox = nodes[leaf].box;
+		int index = root;
+		while (nodes[index].height > 0) {
+			float area = perimeter(nodes[index].box);
+			float combinedArea = perimeter(combine(nodes[index].box, leafBox));
+			float cost = 2.0f * combinedArea;
+			float inheritanceCost = 2.0f * (combinedArea - area);
+			auto descendCost = [&](int child) {
+				float childCost = perimeter(combine(leafBox, nodes[child].box));
+				if (nodes[child].height > 0) {
+					childCost -= perimeter(nodes[child].box);
+				}
+				return childCost + inheritanceCost;
+			};
+			float cost1 = descendCost(nodes[index].child1);
+			float cost2 = descendCost(nodes[index].child2);
+			if (cost < cost1 && cost < cost2) {
+				break;
+			}
+			index = cost1 < cost2 ? nodes[index].child1 : nodes[index].child2;
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].box = combine(leafBox, nodes[sibling].box);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		if (oldParent != NULL_NODE) {
+			if (nodes[oldParent].child1 == sibling) {
+				nodes[oldParent].child1 = newParent;
+			}
+			else {
+				nodes[oldParent].child2 = newParent;
+			}
+		}
+		else {
+			root = newParent;
+		}
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+		refit(newParent);
+	}
+
+	void DynamicTreeBroadphase::removeLeaf(int leaf)
+	{
+		if (leaf == root) {
+			root = NULL_NODE;
+			return;
+		}
+
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+		if (grandParent != NULL_NODE) {
+			if (nodes[grandParent].child1 == parent) {
+				nodes[grandParent].child1 = sibling;
+			}
+			else {
+				nodes[grandParent].child2 = sibling;
+			}
+			nodes[sibling].parent = grandParent;
+			freeNode(parent);
+			refit(grandParent);
+		}
+		else {
+			root = sibling;
+			nodes[sibling].parent = NULL_NODE;
+			freeNode(parent);
+		}
+	}
+
+	// Walks up from node, rebalancing and recomputing boxes and heights
+	void DynamicTreeBroadphase::refit(int node)
+	{
+		while (node != NULL_NODE) {
+			node = balance(node);
+			Node& current = nodes[node];
+			current.height = 1 + std::max(nodes[current.child1].height, nodes[current.child2].height);
+			current.box = combine(nodes[current.child1].box, nodes[current.child2].box);
+			node = current.parent;
+		}
+	}
+
+	// Rotates the taller grandchild up when a's children differ in height by more than one. Returns the
+	// node now at a's place.
+	int DynamicTreeBroadphase::balance(int iA)
+	{
+		Node& A = nodes[iA];
+		if (A.height < 2) {
+			return iA;
+		}
+
+		int iB = A.child1;
+		int iC = A.child2;
+		Node& B = nodes[iB];
+		Node& C = nodes[iC];
+		int heightDifference = C.height - B.height;
+
+		if (heightDifference > 1) {
+			int iF = C.child1;
+			int iG = C.child2;
+			Node& F = nodes[iF];
+			Node& G = nodes[iG];
+
+			C.child1 = iA;
+			C.parent = A.parent;
+			A.parent = iC;
+			if (C.parent != NULL_NODE) {
+				if (nodes[C.parent].child1 == iA) {
+					nodes[C.parent].child1 = iC;
+				}
+				else {
+					nodes[C.parent].child2 = iC;
+				}
+			}
+			else {
+				root = iC;
+			}
+
+			if (F.height > G.height) {
+				C.child2 = iF;
+				A.child2 = iG;
+				G.parent = iA;
+				A.box = combine(B.box, G.box);
+				C.box = combine(A.box, F.box);
+				A.height = 1 + std::max(B.height, G.height);
+				C.height = 1 + std::max(A.height, F.height);
+			}
+			else {
+				C.child2 = iG;
+				A.child2 = iF;
+				F.parent = iA;
+				A.box = combine(B.box, F.box);
+				C.box = combine(A.box, G.box);
+				A.height = 1 + std::max(B.height, F.height);
+				C.height = 1 + std::max(A.height, G.height);
+			}
+			return iC;
+		}
+
+		if (heightDifference < -1) {
+			int iD = B.child1;
+			int iE = B.child2;
+			Node& D = nodes[iD];
+			Node& E = nodes[iE];
+
+			B.child1 = iA;
+			B.parent = A.parent;
+			A.parent = iB;
+			if (B.parent != NULL_NODE) {
+				if (nodes[B.parent].child1 == iA) {
+					nodes[B.parent].child1 = iB;
+				}
+				else {
+					nodes[B.parent].child2 = iB;
+				}
+			}
+			else {
+				root = iB;
+			}
+
+			if (D.height > E.height) {
+				B.child2 = iD;
+				A.child1 = iE;
+				E.parent = iA;
+				A.box = combine(C.box, E.box);
+				B.box = combine(A.box, D.box);
+				A.height = 1 + std::max(C.height, E.height);
+				B.height = 1 + std::max(A.height, D.height);
+			}
+			else {
+				B.child2 = iE;
+				A.child1 = iD;
+				D.parent = iA;
+				A.box = combine(C.box, D.box);
+				B.box = combine(A.box, E.box);
+				A.height = 1 + std::max(C.height, D.height);
+				B.height = 1 + std::max(A.height, E.height);
+			}
+			return iB;
+		}
+
+		return iA;
+	}
+
+	template <typename Visitor>
+	void DynamicTreeBroadphase::traverse(const Aabb& box, Visitor&& visit) const
+	{
+		if (root == NULL_NODE) {
+			return;
+		}
+		// The tree is kept balanced, its height stays far below this
+		constexpr int MAX_STACK = 256;
+		int stack[MAX_STACK];
+		int count = 0;
+		stack[count++] = root;
+		while (count > 0) {
+			const Node& node = nodes[stack[--count]];
+			if (!node.box.overlaps(box)) {
+				continue;
+			}
+			if (node.height == 0) {
+				visit(node.proxy);
+			}
+			else {
+				assert(count + 2 <= MAX_STACK && "dynamic tree is too deep");
+				stack[count++] = node.child1;
+				stack[count++] = node.child2;
+			}
+		}
+	}
+
+	void DynamicTreeBroadphase::update(const std::vector<Aabb>& newBoxes)
+	{
+		lastReinsertions = 0;
+		glm::vec2 margin{ fatMargin };
+		if (newBoxes.size() != boxes.size()) {
+			boxes = newBoxes;
+			nodes.clear();
+			nodes.reserve(2 * boxes.size());
+			root = NULL_NODE;
+			freeList = NULL_NODE;
+			proxyLeaves.resize(boxes.size());
+			for (uint32_t proxy = 0; proxy < boxes.size(); proxy++) {
+				int leaf = allocateNode();
+				nodes[leaf].box = { boxes[proxy].lower - margin, boxes[proxy].upper + margin };
+				nodes[leaf].proxy = proxy;
+				proxyLeaves[proxy] = leaf;
+				insertLeaf(leaf);
+			}
+			return;
+		}
+
+		boxes = newBoxes;
+		for (uint32_t proxy = 0; proxy < boxes.size(); proxy++) {
+			int leaf = proxyLeaves[proxy];
+			if (nodes[leaf].box.contains(boxes[proxy])) {
+				continue;
+			}
+			removeLeaf(leaf);
+			nodes[leaf].box = { boxes[proxy].lower - margin, boxes[proxy].upper + margin };
+			insertLeaf(leaf);
+			lastReinsertions++;
+		}
+	}
+
+	void DynamicTreeBroadphase::findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const
+	{
+		for (uint32_t proxy = 0; proxy < boxes.size(); proxy++) {
+			traverse(boxes[proxy], [&](uint32_t other) {
+				if (other > proxy && boxes[other].overlaps(boxes[proxy])) {
+					pairs.push_back({ proxy, other });
+				}
+			});
+		}
+	}
+
+	void DynamicTreeBroadphase::query(const Aabb& box, std::vector<uint32_t>& results) const
+	{
+		traverse(box, [&](uint32_t proxy) {
+			if (boxes[proxy].overlaps(box)) {
+				results.push_back(proxy);
+			}
+		});
+	}
+
+	void BroadphaseRecording::recordFrame(const std::vector<RocketGameObject>& gameObjects)
+	{
+		std::vector<Aabb> frame;
+		for (const auto& object : gameObjects) {
+			if (object.type != RocketGameObjectType::PARTICLE) {
+				continue;
+			}
+			glm::vec2 position = object.transform2d.translation;
+			frame.push_back({ position - glm::vec2(object.radius), position + glm::vec2(object.radius) });
+		}
+		frames.push_back(std::move(frame));
+	}
+
+	static constexpr uint32_t RECORDING_MAGIC = 0x50425052; // "RPBP"
+	static constexpr uint32_t RECORDING_VERSION = 1;
+
+	void BroadphaseRecording::save(const std::string& path) const
+	{
+		std::ofstream file{ path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+		uint32_t header[3] = { RECORDING_MAGIC, RECORDING_VERSION, static_cast<uint32_t>(frames.size()) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		for (const auto& frame : frames) {
+			uint32_t count = static_cast<uint32_t>(frame.size());
+			file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+			file.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(Aabb));
+		}
+		if (!file) {
+			throw std::runtime_error("Failed to write broadphase recording: " + path);
+		}
+	}
+
+	void BroadphaseRecording::load(const std::string& path)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+		uint32_t header[3];
+		if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != RECORDING_MAGIC) {
+			throw std::runtime_error("Not a broadphase recording: " + path);
+		}
+		if (header[1] != RECORDING_VERSION) {
+			throw std::runtime_error("Unsupported broadphase recording version in " + path);
+		}
+		std::vector<std::vector<Aabb>> loaded(header[2]);
+		for (auto& frame : loaded) {
+			uint32_t count = 0;
+			file.read(reinterpret_cast<char*>(&count), sizeof(count));
+			frame.resize(count);
+			if (!file.read(reinterpret_cast<char*>(frame.data()), count * sizeof(Aabb))) {
+				throw std::runtime_error("Truncated broadphase recording: " + path);
+			}
+		}
+		frames = std::move(loaded);
+	}
+
+	std::vector<BroadphaseReport> compareBroadphases(const BroadphaseRecording& recording)
+	{
+		using clock = std::chrono::steady_clock;
+		std::vector<BroadphaseReport> reports;
+		std::vector<std::pair<uint32_t, uint32_t>> pairs;
+		for (BroadphaseType type : { BroadphaseType::UNIFORM_GRID, BroadphaseType::SORT_AND_SWEEP, BroadphaseType::DYNAMIC_TREE }) {
+			auto broadphase = Broadphase::create(type);
+			BroadphaseReport report;
+			report.type = type;
+			for (const auto& frame : recording.frames) {
+				auto start = clock::now();
+				broadphase->update(frame);
+				auto updated = clock::now();
+				pairs.clear();
+				broadphase->findPairs(pairs);
+				auto found = clock::now();
+
+				report.frames++;
+				report.totalPairs += pairs.size();
+				report.updateMilliseconds += std::chrono::duration<double, std::milli>(updated - start).count();
+				report.pairMilliseconds += std::chrono::duration<double, std::milli>(found - updated).count();
+			}
+			reports.push_back(report);
+		}
+		return reports;
+	}
+}
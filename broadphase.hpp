@@ -0,0 +1,166 @@
+#pragma once
+#include "rocket_game_object.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rocket {
+	struct Aabb {
+		glm::vec2 lower;
+		glm::vec2 upper;
+
+		bool overlaps(const Aabb& other) const
+		{
+			return lower.x <= other.upper.x && other.lower.x <= upper.x &&
+				lower.y <= other.upper.y && other.lower.y <= upper.y;
+		}
+		bool contains(const Aabb& other) const
+		{
+			return lower.x <= other.lower.x && lower.y <= other.lower.y &&
+				other.upper.x <= upper.x && other.upper.y <= upper.y;
+		}
+	};
+
+	enum class BroadphaseType {
+		UNIFORM_GRID,
+		SORT_AND_SWEEP,
+		DYNAMIC_TREE
+	};
+
+	// Finds overlapping pairs among a set of boxes. Proxy i is boxes[i] of the last update(), callers
+	// keep proxy indices stable between frames so implementations can reuse last frame's work. A change
+	// in the number of boxes rebuilds from scratch.
+	class Broadphase {
+	public:
+		virtual ~Broadphase() = default;
+
+		static std::unique_ptr<Broadphase> create(BroadphaseType type);
+		static const char* typeName(BroadphaseType type);
+
+		virtual BroadphaseType type() const = 0;
+		virtual void update(const std::vector<Aabb>& boxes) = 0;
+		// Every overlapping pair once, as (lower proxy, higher proxy) in no particular order
+		virtual void findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const = 0;
+		// Appends the proxies overlapping box
+		virtual void query(const Aabb& box, std::vector<uint32_t>& results) const = 0;
+	};
+
+	// Boxes binned into square cells, best when boxes have similar sizes. A pair is reported by the one
+	// cell holding the lower corner of the boxes' intersection, so no deduplication is needed.
+	class UniformGridBroadphase : public Broadphase {
+	public:
+		BroadphaseType type() const override { return BroadphaseType::UNIFORM_GRID; }
+		void update(const std::vector<Aabb>& boxes) override;
+		void findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const override;
+		void query(const Aabb& box, std::vector<uint32_t>& results) const override;
+
+		// 0 picks twice the average box extent
+		float cellSize = 0.0f;
+		// Sparse scenes grow the cells rather than allocate more than this many per box
+		int maxCellsPerBox = 4;
+	private:
+		glm::ivec2 cellOf(glm::vec2 position) const;
+
+		std::vector<Aabb> boxes;
+		glm::vec2 origin{ 0.0f };
+		float currentCellSize = 1.0f;
+		int gridWidth = 0;
+		int gridHeight = 0;
+		// Cell c holds cellProxies[cellStart[c], cellStart[c + 1])
+		std::vector<uint32_t> cellStart;
+		std::vector<uint32_t> cellProxies;
+	};
+
+	// Proxies kept sorted by lower x, swept for overlaps. The order carries over between updates, so
+	// the insertion sort only moves proxies that passed each other. Best for sparse scenes.
+	class SortAndSweepBroadphase : public Broadphase {
+	public:
+		BroadphaseType type() const override { return BroadphaseType::SORT_AND_SWEEP; }
+		void update(const std::vector<Aabb>& boxes) override;
+		void findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const override;
+		void query(const Aabb& box, std::vector<uint32_t>& results) const override;
+
+		size_t sortSwaps() const { return lastSortSwaps; }
+	private:
+		std::vector<Aabb> boxes;
+		std::vector<uint32_t> order;
+		std::vector<float> sortedLowerX;
+		float maxWidth = 0.0f;
+		size_t lastSortSwaps = 0;
+	};
+
+	// Bounding volume tree of fattened leaf boxes. A proxy is only reinserted when it leaves its fat box,
+	// insertion follows the surface area heuristic and rotations keep the tree balanced. Best for mixed sizes.
+	class DynamicTreeBroadphase : public Broadphase {
+	public:
+		BroadphaseType type() const override { return BroadphaseType::DYNAMIC_TREE; }
+		void update(const std::vector<Aabb>& boxes) override;
+		void findPairs(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const override;
+		void query(const Aabb& box, std::vector<uint32_t>& results) const override;
+
+		// Leaf boxes are grown by this much so small motions don't touch the tree
+		float fatMargin = 0.01f;
+
+		size_t reinsertions() const { return lastReinsertions; }
+		int height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+	private:
+		static constexpr int NULL_NODE = -1;
+
+		struct Node {
+			Aabb box;
+			int parent;
+			int child1;
+			int child2;
+			// Leaves have height 0 and proxy set, free nodes height -1 and parent as the next free node
+			int height;
+			uint32_t proxy;
+		};
+
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int node);
+		void refit(int node);
+		template <typename Visitor>
+		void traverse(const Aabb& box, Visitor&& visit) const;
+
+		std::vector<Aabb> boxes;
+		std::vector<Node> nodes;
+		std::vector<int> proxyLeaves;
+		int root = NULL_NODE;
+		int freeList = NULL_NODE;
+		size_t lastReinsertions = 0;
+	};
+
+	// Bounding boxes of the particles in a scene over consecutive frames, replayed through every broadphase
+	// to see which one suits the scene. Proxy i is the i-th particle in gameObjects, so a ParticleReorder
+	// during recording gives the proxies new identities and the replay sees a burst of moved boxes.
+	class BroadphaseRecording {
+	public:
+		void recordFrame(const std::vector<RocketGameObject>& gameObjects);
+		void clear() { frames.clear(); }
+		size_t frameCount() const { return frames.size(); }
+
+		// Binary file of frames, throws std::runtime_error on failure
+		void save(const std::string& path) const;
+		void load(const std::string& path);
+
+		std::vector<std::vector<Aabb>> frames;
+	};
+
+	struct BroadphaseReport {
+		BroadphaseType type;
+		size_t frames = 0;
+		size_t totalPairs = 0;
+		// Totals over all frames
+		double updateMilliseconds = 0.0;
+		double pairMilliseconds = 0.0;
+	};
+
+	std::vector<BroadphaseReport> compareBroadphases(const BroadphaseRecording& recording);
+}
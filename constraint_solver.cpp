@@ -0,0 +1,312 @@
+#include "constraint_solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rocket {
+	// Greedy colouring tracks the colours used by each particle in a 64 bit mask. Constraints that find all
+	// 64 taken go into one extra colour that is solved serially, which never happens for ropes and cloth.
+	static constexpr uint32_t MAX_PARALLEL_COLOURS = 64;
+
+	void ConstraintSolver::ConstraintBatch::push(uint32_t first, uint32_t second, float rest, float constraintCompliance, glm::vec2 pinTarget)
+	{
+		a.push_back(first);
+		b.push_back(second);
+		restLength.push_back(rest);
+		compliance.push_back(constraintCompliance);
+		lambda.push_back(0.0f);
+		target.push_back(pinTarget);
+	}
+
+	void ConstraintSolver::ConstraintBatch::clear()
+	{
+		a.clear();
+		b.clear();
+		restLength.clear();
+		compliance.clear();
+		lambda.clear();
+		target.clear();
+		colourStart.clear();
+	}
+
+	ConstraintSolver::ConstraintSolver(glm::vec2 gravity, RocketThreadPool& threadPool) : gravity{ gravity }, threadPool{ threadPool }
+	{
+	}
+
+	uint32_t ConstraintSolver::particleSlot(id_t id)
+	{
+		auto it = particleSlots.find(id);
+		if (it != particleSlots.end()) {
+			return it->second;
+		}
+		uint32_t slot = static_cast<uint32_t>(particleIds.size());
+		particleIds.push_back(id);
+		particleSlots.emplace(id, slot);
+		return slot;
+	}
+
+	void ConstraintSolver::addDistanceConstraint(id_t a, id_t b, float restLength, float compliance)
+	{
+		distance.push(particleSlot(a), particleSlot(b), restLength, compliance, glm::vec2{ 0.0f });
+		coloursDirty = true;
+	}
+
+	void ConstraintSolver::addBendingConstraint(id_t a, id_t c, float restLength, float compliance)
+	{
+		bending.push(particleSlot(a), particleSlot(c), restLength, compliance, glm::vec2{ 0.0f });
+		coloursDirty = true;
+	}
+
+	void ConstraintSolver::addPinConstraint(id_t particle, glm::vec2 target, float compliance)
+	{
+		uint32_t slot = particleSlot(particle);
+		pins.push(slot, slot, 0.0f, compliance, target);
+		coloursDirty = true;
+	}
+
+	void ConstraintSolver::clear()
+	{
+		distance.clear();
+		bending.clear();
+		pins.clear();
+		particleIds.clear();
+		particleSlots.clear();
+		coloursDirty = false;
+	}
+
+	void ConstraintSolver::colourBatch(ConstraintBatch& batch)
+	{
+		size_t count = batch.size();
+		std::vector<uint64_t> usedColours(particleIds.size(), 0);
+		std::vector<uint32_t> colours(count);
+		uint32_t colourCount = 0;
+		for (size_t i = 0; i < count; i++) {
+			uint64_t used = usedColours[batch.a[i]] | usedColours[batch.b[i]];
+			uint32_t colour = 0;
+			while (colour < MAX_PARALLEL_COLOURS && (used & (uint64_t{ 1 } << colour))) {
+				colour++;
+			}
+			if (colour < MAX_PARALLEL_COLOURS) {
+				usedColours[batch.a[i]] |= uint64_t{ 1 } << colour;
+				usedColours[batch.b[i]] |= uint64_t{ 1 } << colour;
+			}
+			colours[i] = colour;
+			colourCount = std::max(colourCount, colour + 1);
+		}
+
+		// Counting sort by colour so every colour is one contiguous range of the arrays
+		batch.colourStart.assign(colourCount + 1, 0);
+		for (uint32_t colour : colours) {
+			batch.colourStart[colour + 1]++;
+		}
+		for (uint32_t c = 0; c < colourCount; c++) {
+			batch.colourStart[c + 1] += batch.colourStart[c];
+		}
+		std::vector<uint32_t> cursor(batch.colourStart.begin(), batch.colourStart.end() - 1);
+		ConstraintBatch sorted;
+		sorted.a.resize(count);
+		sorted.b.resize(count);
+		sorted.restLength.resize(count);
+		sorted.compliance.resize(count);
+		sorted.lambda.resize(count);
+		sorted.target.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			uint32_t to = cursor[colours[i]]++;
+			sorted.a[to] = batch.a[i];
+			sorted.b[to] = batch.b[i];
+			sorted.restLength[to] = batch.restLength[i];
+			sorted.compliance[to] = batch.compliance[i];
+			sorted.target[to] = batch.target[i];
+		}
+		sorted.colourStart = std::move(batch.colourStart);
+		batch = std::move(sorted);
+	}
+
+	void ConstraintSolver::removeMissingParticles()
+	{
+		std::vector<uint32_t> remap(particleIds.size(), UINT32_MAX);
+		std::vector<id_t> keptIds;
+		for (uint32_t slot = 0; slot < particleIds.size(); slot++) {
+			if (objectIndexById.count(particleIds[slot])) {
+				remap[slot] = static_cast<uint32_t>(keptIds.size());
+				keptIds.push_back(particleIds[slot]);
+			}
+		}
+		for (ConstraintBatch* batch : { &distance, &bending, &pins }) {
+			ConstraintBatch kept;
+			for (size_t i = 0; i < batch->size(); i++) {
+				if (remap[batch->a[i]] != UINT32_MAX && remap[batch->b[i]] != UINT32_MAX) {
+					kept.push(remap[batch->a[i]], remap[batch->b[i]], batch->restLength[i], batch->compliance[i], batch->target[i]);
+				}
+			}
+			*batch = std::move(kept);
+		}
+		particleIds = std::move(keptIds);
+		particleSlots.clear();
+		for (uint32_t slot = 0; slot < particleIds.size(); slot++) {
+			particleSlots.emplace(particleIds[slot], slot);
+		}
+		coloursDirty = true;
+	}
+
+	bool ConstraintSolver::gatherParticles(std::vector<RocketGameObject>& gameObjects)
+	{
+		objectIndexById.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			if (gameObjects[i].constraintsApplied) {
+				objectIndexById.emplace(gameObjects[i].getId(), i);
+			}
+		}
+		for (id_t id : particleIds) {
+			if (!objectIndexById.count(id)) {
+				// Objects were removed from the scene, drop every constraint that refers to them
+				removeMissingParticles();
+				break;
+			}
+		}
+		if (particleIds.empty()) {
+			return false;
+		}
+
+		size_t count = particleIds.size();
+		objectIndices.resize(count);
+		positions.resize(count);
+		previousPositions.resize(count);
+		velocities.resize(count);
+		inverseMasses.resize(count);
+		gravityApplied.resize(count);
+		for (size_t slot = 0; slot < count; slot++) {
+			uint32_t index = objectIndexById[particleIds[slot]];
+			const auto& object = gameObjects[index];
+			objectIndices[slot] = index;
+			positions[slot] = object.transform2d.translation;
+			velocities[slot] = object.velocity;
+			inverseMasses[slot] = object.mass > 0.0f ? 1.0f / object.mass : 0.0f;
+			gravityApplied[slot] = object.gravityApplied;
+		}
+		return true;
+	}
+
+	void ConstraintSolver::scatterParticles(std::vector<RocketGameObject>& gameObjects)
+	{
+		for (size_t slot = 0; slot < particleIds.size(); slot++) {
+			auto& object = gameObjects[objectIndices[slot]];
+			object.transform2d.translation = positions[slot];
+			object.velocity = velocities[slot];
+		}
+	}
+
+	void ConstraintSolver::solveBatch(ConstraintBatch& batch, float alphaScale, bool pinned)
+	{
+		auto solveRange = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				uint32_t a = batch.a[i];
+				uint32_t b = batch.b[i];
+				float wa = inverseMasses[a];
+				float wb = pinned ? 0.0f : inverseMasses[b];
+				glm::vec2 other = pinned ? batch.target[i] : positions[b];
+				glm::vec2 delta = positions[a] - other;
+				float length = glm::length(delta);
+				float alpha = batch.compliance[i] * alphaScale;
+				float weight = wa + wb + alpha;
+				if (length < 1e-7f || weight <= 0.0f) {
+					continue;
+				}
+				glm::vec2 normal = delta / length;
+				float c = length - batch.restLength[i];
+				float deltaLambda = (-c - alpha * batch.lambda[i]) / weight;
+				batch.lambda[i] += deltaLambda;
+				positions[a] += normal * (wa * deltaLambda);
+				if (!pinned) {
+					positions[b] -= normal * (wb * deltaLambda);
+				}
+			}
+		};
+
+		for (size_t colour = 0; colour < batch.colourCount(); colour++) {
+			size_t begin = batch.colourStart[colour];
+			size_t end = batch.colourStart[colour + 1];
+			if (colour >= MAX_PARALLEL_COLOURS) {
+				solveRange(begin, end);
+				continue;
+			}
+			threadPool.parallelFor(end - begin, [&](size_t chunkBegin, size_t chunkEnd) {
+				solveRange(begin + chunkBegin, begin + chunkEnd);
+			}, 512);
+		}
+	}
+
+	void ConstraintSolver::holdParticles(const std::vector<RocketGameObject>& gameObjects)
+	{
+		heldParticles.clear();
+		if (particleIds.empty()) {
+			return;
+		}
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			const auto& object = gameObjects[i];
+			if (object.constraintsApplied) {
+				heldParticles.push_back({ i, object.getId(), object.transform2d.translation, object.velocity });
+			}
+		}
+	}
+
+	void ConstraintSolver::restoreHeldParticles(std::vector<RocketGameObject>& gameObjects)
+	{
+		for (const auto& held : heldParticles) {
+			// Systems between hold and solve only move objects, they never add, remove or reorder them
+			if (held.index < gameObjects.size() && gameObjects[held.index].getId() == held.id) {
+				gameObjects[held.index].transform2d.translation = held.translation;
+				gameObjects[held.index].velocity = held.velocity;
+			}
+		}
+		heldParticles.clear();
+	}
+
+	void ConstraintSolver::solveConstraints(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		restoreHeldParticles(gameObjects);
+		if (!(dt > 0.0f) || !gatherParticles(gameObjects)) {
+			return;
+		}
+		if (coloursDirty) {
+			colourBatch(distance);
+			colourBatch(bending);
+			colourBatch(pins);
+			coloursDirty = false;
+		}
+
+		int stepCount = std::max(1, substeps);
+		float h = dt / stepCount;
+		// XPBD scales compliance by 1 / h^2 so stiffness does not depend on the step or iteration count
+		float alphaScale = 1.0f / (h * h);
+		size_t count = positions.size();
+		for (int step = 0; step < stepCount; step++) {
+			threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					if (inverseMasses[i] > 0.0f && gravityApplied[i]) {
+						velocities[i] += gravity * h;
+					}
+					previousPositions[i] = positions[i];
+					positions[i] += velocities[i] * h;
+				}
+			}, 4096);
+
+			for (ConstraintBatch* batch : { &distance, &bending, &pins }) {
+				std::fill(batch->lambda.begin(), batch->lambda.end(), 0.0f);
+			}
+			for (int iteration = 0; iteration < std::max(1, iterations); iteration++) {
+				solveBatch(distance, alphaScale, false);
+				solveBatch(bending, alphaScale, false);
+				solveBatch(pins, alphaScale, true);
+			}
+
+			threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					positions[i] = glm::clamp(positions[i], boundsMin, boundsMax);
+					velocities[i] = (positions[i] - previousPositions[i]) / h;
+				}
+			}, 4096);
+		}
+		scatterParticles(gameObjects);
+	}
+}
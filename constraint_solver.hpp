@@ -0,0 +1,103 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "rocket_thread_pool.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+	// Extended position based dynamics (XPBD) over game objects, for chains, ropes and cloth.
+	// Constraints refer to objects by id, so they survive reordering of the game object vector. Objects
+	// handed to the solver should have constraintsApplied set: the solver integrates them itself
+	// (gravity only if gravityApplied) and other systems skip them. PhysicsSystem does not know the flag,
+	// call holdParticles() before it runs so its step is undone for constrained objects.
+	//
+	// Constraints are kept as one array per kind, grouped by colour. No two constraints of a colour share
+	// a particle, so each colour is solved with parallelFor and plain writes.
+	class ConstraintSolver {
+	public:
+		using id_t = RocketGameObject::id_t;
+
+		ConstraintSolver(glm::vec2 gravity, RocketThreadPool& threadPool);
+
+		ConstraintSolver(const ConstraintSolver&) = delete;
+		ConstraintSolver& operator=(const ConstraintSolver&) = delete;
+
+		// Compliance is the inverse stiffness in m/N, 0 makes the constraint rigid
+		void addDistanceConstraint(id_t a, id_t b, float restLength, float compliance = 0.0f);
+		// Keeps a and c, the outer particles of a chain a-b-c, at restLength, resisting bending around b
+		void addBendingConstraint(id_t a, id_t c, float restLength, float compliance = 0.0001f);
+		void addPinConstraint(id_t particle, glm::vec2 target, float compliance = 0.0f);
+		void clear();
+
+		// Remembers the position and velocity of every constrained object. The next solveConstraints
+		// starts from them, so whatever another system did to those objects in between is discarded and
+		// they are integrated once, by the solver.
+		void holdParticles(const std::vector<RocketGameObject>& gameObjects);
+		void solveConstraints(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		glm::vec2 gravity;
+		int substeps = 10;
+		int iterations = 1;
+		glm::vec2 boundsMin{ -1.0f, -1.0f };
+		glm::vec2 boundsMax{ 1.0f, 1.0f };
+
+		size_t constraintCount() const { return distance.size() + bending.size() + pins.size(); }
+		size_t colourCount() const { return distance.colourCount() + bending.colourCount() + pins.colourCount(); }
+	private:
+		// Two particle constraint |x[a] - x[b]| = restLength. Pins use the same layout with b = a and
+		// the target position in the pins array.
+		struct ConstraintBatch {
+			std::vector<uint32_t> a;
+			std::vector<uint32_t> b;
+			std::vector<float> restLength;
+			std::vector<float> compliance;
+			std::vector<float> lambda;
+			std::vector<glm::vec2> target;
+			// Constraints of colour c are [colourStart[c], colourStart[c + 1])
+			std::vector<uint32_t> colourStart;
+
+			size_t size() const { return a.size(); }
+			size_t colourCount() const { return colourStart.empty() ? 0 : colourStart.size() - 1; }
+			void push(uint32_t first, uint32_t second, float rest, float constraintCompliance, glm::vec2 pinTarget);
+			void clear();
+		};
+
+		struct HeldParticle {
+			uint32_t index;
+			id_t id;
+			glm::vec2 translation;
+			glm::vec2 velocity;
+		};
+
+		uint32_t particleSlot(id_t id);
+		void restoreHeldParticles(std::vector<RocketGameObject>& gameObjects);
+		bool gatherParticles(std::vector<RocketGameObject>& gameObjects);
+		void scatterParticles(std::vector<RocketGameObject>& gameObjects);
+		void removeMissingParticles();
+		void colourBatch(ConstraintBatch& batch);
+		void solveBatch(ConstraintBatch& batch, float alphaScale, bool pinned);
+
+		RocketThreadPool& threadPool;
+
+		ConstraintBatch distance;
+		ConstraintBatch bending;
+		ConstraintBatch pins;
+		bool coloursDirty = false;
+
+		// Solver particles, constraints index into these
+		std::vector<id_t> particleIds;
+		std::unordered_map<id_t, uint32_t> particleSlots;
+		std::vector<uint32_t> objectIndices;
+		std::vector<glm::vec2> positions;
+		std::vector<glm::vec2> previousPositions;
+		std::vector<glm::vec2> velocities;
+		std::vector<float> inverseMasses;
+		std::vector<uint8_t> gravityApplied;
+
+		std::unordered_map<id_t, uint32_t> objectIndexById;
+		std::vector<HeldParticle> heldParticles;
+	};
+}
@@ -0,0 +1,227 @@
+#include "continuous_collision_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rocket {
+	// Pairs of fast particles are tested directly, their start positions can be far outside each other's sweep.
+	// Past this many fast particles the frame is an explosion and only the grid is used.
+	static constexpr size_t MAX_DIRECT_FAST_PAIRS = 256;
+
+	ContinuousCollisionSystem::ContinuousCollisionSystem(RocketThreadPool& threadPool) : threadPool{ threadPool }
+	{
+	}
+
+	bool ContinuousCollisionSystem::sweptCircleTimeOfImpact(glm::vec2 relativePosition, glm::vec2 relativeMotion, float radiusSum, float& timeOfImpact)
+	{
+		// Smallest t in [0, 1] with |p + d t| = r
+		float a = glm::dot(relativeMotion, relativeMotion);
+		float b = 2.0f * glm::dot(relativePosition, relativeMotion);
+		float c = glm::dot(relativePosition, relativePosition) - radiusSum * radiusSum;
+		if (c <= 0.0f || b >= 0.0f || a < 1e-12f) {
+			// Already overlapping (left to the discrete pass) or not approaching
+			return false;
+		}
+		float discriminant = b * b - 4.0f * a * c;
+		if (discriminant < 0.0f) {
+			return false;
+		}
+		float t = (-b - std::sqrt(discriminant)) / (2.0f * a);
+		if (t < 0.0f || t > 1.0f) {
+			return false;
+		}
+		timeOfImpact = t;
+		return true;
+	}
+
+	void ContinuousCollisionSystem::buildGrid()
+	{
+		cellSize = std::max(4.0f * maxRadius, 0.01f);
+		gridWidth = std::max(1, static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / cellSize)));
+		gridHeight = std::max(1, static_cast<int>(std::ceil((boundsMax.y - boundsMin.y) / cellSize)));
+		size_t cellCount = static_cast<size_t>(gridWidth) * gridHeight;
+		size_t count = positions.size();
+
+		particleCells.resize(count);
+		cellStart.assign(cellCount + 1, 0);
+		for (size_t i = 0; i < count; i++) {
+			int x = std::min(std::max(static_cast<int>(std::floor((positions[i].x - boundsMin.x) / cellSize)), 0), gridWidth - 1);
+			int y = std::min(std::max(static_cast<int>(std::floor((positions[i].y - boundsMin.y) / cellSize)), 0), gridHeight - 1);
+			particleCells[i] = static_cast<uint32_t>(y * gridWidth + x);
+			cellStart[particleCells[i] + 1]++;
+		}
+		for (size_t c = 0; c < cellCount; c++) {
+			cellStart[c + 1] += cellStart[c];
+		}
+		cellParticles.resize(count);
+		std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+		for (size_t i = 0; i < count; i++) {
+			cellParticles[cursor[particleCells[i]]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	ContinuousCollisionSystem::Impact ContinuousCollisionSystem::findEarliestImpact(uint32_t particle, float dt) const
+	{
+		Impact earliest{};
+		glm::vec2 start = positions[particle];
+		glm::vec2 motion = velocities[particle] * dt;
+
+		auto testPair = [&](uint32_t other) {
+			if (other == particle) {
+				return;
+			}
+			glm::vec2 relativePosition = start - positions[other];
+			glm::vec2 relativeMotion = motion - velocities[other] * dt;
+			float t;
+			if (sweptCircleTimeOfImpact(relativePosition, relativeMotion, radii[particle] + radii[other], t) && t < earliest.timeOfImpact) {
+				earliest.other = other;
+				earliest.timeOfImpact = t;
+				// Normal from other to particle at the moment of impact
+				earliest.normal = glm::normalize(relativePosition + relativeMotion * t);
+				// Normal distance the pair may still close this step
+				earliest.gap = -glm::dot(relativeMotion, earliest.normal) * t;
+			}
+		};
+
+		// Sweep bounds, grown by everything a slow particle can reach during the step
+		float margin = radii[particle] + maxRadius + maxSlowMotion;
+		glm::vec2 lower = glm::min(start, start + motion) - glm::vec2(margin);
+		glm::vec2 upper = glm::max(start, start + motion) + glm::vec2(margin);
+		int x0 = std::max(static_cast<int>(std::floor((lower.x - boundsMin.x) / cellSize)), 0);
+		int y0 = std::max(static_cast<int>(std::floor((lower.y - boundsMin.y) / cellSize)), 0);
+		int x1 = std::min(static_cast<int>(std::floor((upper.x - boundsMin.x) / cellSize)), gridWidth - 1);
+		int y1 = std::min(static_cast<int>(std::floor((upper.y - boundsMin.y) / cellSize)), gridHeight - 1);
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				uint32_t cell = y * gridWidth + x;
+				for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+					testPair(cellParticles[k]);
+				}
+			}
+		}
+		if (fast.size() <= MAX_DIRECT_FAST_PAIRS) {
+			for (uint32_t other : fast) {
+				testPair(other);
+			}
+		}
+		return earliest;
+	}
+
+	bool ContinuousCollisionSystem::resolveImpact(uint32_t particle, const Impact& impact, float dt)
+	{
+		uint32_t other = impact.other;
+		float wa = inverseMasses[particle];
+		float wb = inverseMasses[other];
+		if (wa + wb <= 0.0f) {
+			return false;
+		}
+		// Velocities may have changed through an earlier contact of either particle, so the closing speed is
+		// taken from the current state and only the part exceeding the allowed gap is removed
+		float closingSpeed = -glm::dot(velocities[particle] - velocities[other], impact.normal);
+		float allowedSpeed = impact.gap / dt;
+		if (closingSpeed <= allowedSpeed) {
+			return false;
+		}
+		float correction = closingSpeed - allowedSpeed;
+		velocities[particle] += impact.normal * (correction * wa / (wa + wb));
+		velocities[other] -= impact.normal * (correction * wb / (wa + wb));
+		return true;
+	}
+
+	void ContinuousCollisionSystem::resolveBounds(uint32_t particle, float dt)
+	{
+		glm::vec2 lower = boundsMin + glm::vec2(radii[particle]);
+		glm::vec2 upper = boundsMax - glm::vec2(radii[particle]);
+		glm::vec2& velocity = velocities[particle];
+		glm::vec2 end = positions[particle] + velocity * dt;
+		for (int axis = 0; axis < 2; axis++) {
+			if (end[axis] < lower[axis]) {
+				velocity[axis] = -std::max(positions[particle][axis] - lower[axis], 0.0f) / dt;
+			}
+			else if (end[axis] > upper[axis]) {
+				velocity[axis] = std::max(upper[axis] - positions[particle][axis], 0.0f) / dt;
+			}
+		}
+	}
+
+	void ContinuousCollisionSystem::applySpeculativeContacts(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		fastCount = 0;
+		contactCount = 0;
+		if (!(dt > 0.0f)) {
+			return;
+		}
+
+		objectIndices.clear();
+		positions.clear();
+		velocities.clear();
+		radii.clear();
+		inverseMasses.clear();
+		fast.clear();
+		maxRadius = 0.0f;
+		maxSlowMotion = 0.0f;
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			const auto& object = gameObjects[i];
+			if (object.type != RocketGameObjectType::PARTICLE || !object.collisionApplied || object.constraintsApplied) {
+				continue;
+			}
+			uint32_t particle = static_cast<uint32_t>(positions.size());
+			objectIndices.push_back(i);
+			positions.push_back(object.transform2d.translation);
+			velocities.push_back(object.sleeping ? glm::vec2{ 0.0f } : object.velocity);
+			radii.push_back(object.radius);
+			// Sleeping particles act as static obstacles
+			inverseMasses.push_back(object.sleeping || object.mass <= 0.0f ? 0.0f : 1.0f / object.mass);
+			maxRadius = std::max(maxRadius, object.radius);
+
+			float motion = glm::length(velocities.back()) * dt;
+			if (motion > fastMotionFraction * object.radius) {
+				fast.push_back(particle);
+			}
+			else {
+				maxSlowMotion = std::max(maxSlowMotion, motion);
+			}
+		}
+		fastCount = fast.size();
+		if (fast.empty()) {
+			return;
+		}
+
+		buildGrid();
+		impacts.resize(fast.size());
+		std::vector<uint8_t> touched(positions.size(), 0);
+		// A contact deflects the particle, which can then hit something else later in the step. Passes
+		// repeat until no contact needs a correction, already resolved contacts come back with nothing to remove.
+		for (int pass = 0; pass < maxPasses; pass++) {
+			threadPool.parallelFor(fast.size(), [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					impacts[i] = findEarliestImpact(fast[i], dt);
+				}
+			}, 16);
+
+			// Contacts touch two particles each, applying them serially keeps this free of races. There are only
+			// as many as there are fast particles.
+			size_t passContacts = 0;
+			for (size_t i = 0; i < fast.size(); i++) {
+				if (impacts[i].other != UINT32_MAX && resolveImpact(fast[i], impacts[i], dt)) {
+					touched[impacts[i].other] = 1;
+					passContacts++;
+				}
+				resolveBounds(fast[i], dt);
+			}
+			contactCount += passContacts;
+			if (passContacts == 0) {
+				break;
+			}
+		}
+
+		for (uint32_t particle : fast) {
+			touched[particle] = 1;
+		}
+		for (uint32_t particle = 0; particle < positions.size(); particle++) {
+			if (touched[particle] && inverseMasses[particle] > 0.0f) {
+				gameObjects[objectIndices[particle]].velocity = velocities[particle];
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "rocket_thread_pool.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// Keeps fast particles from tunnelling through each other and the bounds when dt is large.
+	// Runs before the simulation step: for every particle that would move further than fastMotionFraction
+	// of its radius, a swept circle test finds the earliest time of impact within dt, and a speculative
+	// contact removes just enough approaching velocity along the impact normal that the pair ends the step
+	// touching instead of passing through. The regular collision pass then resolves the touching pair.
+	class ContinuousCollisionSystem {
+	public:
+		ContinuousCollisionSystem(RocketThreadPool& threadPool);
+
+		ContinuousCollisionSystem(const ContinuousCollisionSystem&) = delete;
+		ContinuousCollisionSystem& operator=(const ContinuousCollisionSystem&) = delete;
+
+		void applySpeculativeContacts(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		// Swept circle time of impact of b moving relative to a, both as offsets over [0, 1].
+		// Returns false if they do not touch within the interval.
+		static bool sweptCircleTimeOfImpact(glm::vec2 relativePosition, glm::vec2 relativeMotion, float radiusSum, float& timeOfImpact);
+
+		float fastMotionFraction = 0.5f;
+		int maxPasses = 4;
+		glm::vec2 boundsMin{ -1.0f, -1.0f };
+		glm::vec2 boundsMax{ 1.0f, 1.0f };
+
+		size_t fastParticles() const { return fastCount; }
+		size_t speculativeContacts() const { return contactCount; }
+	private:
+		struct Impact {
+			uint32_t other = UINT32_MAX;
+			float timeOfImpact = 1.0f;
+			glm::vec2 normal{ 0.0f };
+			float gap = 0.0f;
+		};
+
+		void buildGrid();
+		Impact findEarliestImpact(uint32_t particle, float dt) const;
+		bool resolveImpact(uint32_t particle, const Impact& impact, float dt);
+		void resolveBounds(uint32_t particle, float dt);
+
+		RocketThreadPool& threadPool;
+
+		std::vector<uint32_t> objectIndices;
+		std::vector<glm::vec2> positions;
+		std::vector<glm::vec2> velocities;
+		std::vector<float> radii;
+		std::vector<float> inverseMasses;
+		std::vector<uint32_t> fast;
+		std::vector<Impact> impacts;
+
+		// Start positions binned into a uniform grid, cell c holds cellParticles[cellStart[c], cellStart[c + 1])
+		float cellSize = 0.04f;
+		int gridWidth = 0;
+		int gridHeight = 0;
+		float maxRadius = 0.0f;
+		float maxSlowMotion = 0.0f;
+		std::vector<uint32_t> cellStart;
+		std::vector<uint32_t> cellParticles;
+		std::vector<uint32_t> particleCells;
+
+		size_t fastCount = 0;
+		size_t contactCount = 0;
+	};
+}
@@ -0,0 +1,197 @@
+#include "emitter_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rocket {
+	uint32_t EmitterSystem::addEmitter(const ParticleEmitter& emitter, std::vector<RocketGameObject>& gameObjects)
+	{
+		uint32_t id = nextEmitterId++;
+		size_t required = gameObjects.size() + emitter.capacity;
+		if (gameObjects.capacity() < required) {
+			gameObjects.reserve(std::max(required, 2 * gameObjects.capacity()));
+		}
+		for (uint32_t i = 0; i < emitter.capacity; i++) {
+			gameObjects.push_back(RocketGameObject::createGameObject());
+			RocketGameObject& object = gameObjects.back();
+			object.model = emitter.model;
+			object.emitter = id;
+			park(object);
+		}
+
+		EmitterState state;
+		state.id = id;
+		state.settings = emitter;
+		state.freeSlots.reserve(emitter.capacity);
+		emitters.push_back(std::move(state));
+		return id;
+	}
+
+	void EmitterSystem::removeEmitter(uint32_t emitterId, std::vector<RocketGameObject>& gameObjects)
+	{
+		gameObjects.erase(std::remove_if(gameObjects.begin(), gameObjects.end(), [&](const RocketGameObject& object) {
+			return object.emitter == emitterId;
+		}), gameObjects.end());
+		emitters.erase(std::remove_if(emitters.begin(), emitters.end(), [&](const EmitterState& emitter) {
+			return emitter.id == emitterId;
+		}), emitters.end());
+	}
+
+	ParticleEmitter* EmitterSystem::getEmitter(uint32_t emitterId)
+	{
+		EmitterState* emitter = findEmitter(emitterId);
+		return emitter ? &emitter->settings : nullptr;
+	}
+
+	void EmitterSystem::clear()
+	{
+		emitters.clear();
+		aliveCount = 0;
+		pooledCount = 0;
+		orphanCount = 0;
+		expiredOrphanCount = 0;
+	}
+
+	void EmitterSystem::adoptOrphans(const std::vector<RocketGameObject>& gameObjects)
+	{
+		orphanCount = 0;
+		for (const auto& object : gameObjects) {
+			if (object.emitter == RocketGameObject::ORPHAN_EMITTER && !object.parked()) {
+				orphanCount++;
+			}
+		}
+	}
+
+	// Orphans are parked when they expire and only erased on the next update, before any slot indices are taken
+	void EmitterSystem::removeExpiredOrphans(std::vector<RocketGameObject>& gameObjects)
+	{
+		gameObjects.erase(std::remove_if(gameObjects.begin(), gameObjects.end(), [](const RocketGameObject& object) {
+			return object.emitter == RocketGameObject::ORPHAN_EMITTER && object.parked();
+		}), gameObjects.end());
+		orphanCount -= expiredOrphanCount;
+		expiredOrphanCount = 0;
+	}
+
+	EmitterSystem::EmitterState* EmitterSystem::findEmitter(uint32_t emitterId)
+	{
+		for (auto& emitter : emitters) {
+			if (emitter.id == emitterId) {
+				return &emitter;
+			}
+		}
+		return nullptr;
+	}
+
+	// Parked objects keep their slot but take part in nothing and draw at zero size
+	void EmitterSystem::park(RocketGameObject& object)
+	{
+		object.type = RocketGameObjectType::NONE;
+		object.transform2d.scale = { 0.0f, 0.0f };
+		object.transform2d.rotation = 0.0f;
+		object.velocity = { 0.0f, 0.0f };
+		object.acceleration = { 0.0f, 0.0f };
+		object.gravityApplied = false;
+		object.collisionApplied = false;
+		object.sleeping = false;
+		object.age = 0.0f;
+	}
+
+	void EmitterSystem::updateEmitters(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		aliveCount = 0;
+		pooledCount = 0;
+		if (expiredOrphanCount > 0) {
+			removeExpiredOrphans(gameObjects);
+		}
+		if (emitters.empty() && orphanCount == 0) {
+			return;
+		}
+		for (auto& emitter : emitters) {
+			emitter.freeSlots.clear();
+		}
+
+		// Age the pooled particles and collect the parked slots of every emitter
+		EmitterState* emitter = nullptr;
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			RocketGameObject& object = gameObjects[i];
+			if (object.emitter == RocketGameObject::NO_EMITTER) {
+				continue;
+			}
+			if (object.emitter == RocketGameObject::ORPHAN_EMITTER) {
+				if (object.type == RocketGameObjectType::PARTICLE) {
+					object.age += dt;
+					if (object.age < object.lifetime) {
+						aliveCount++;
+					}
+					else {
+						park(object);
+						expiredOrphanCount++;
+					}
+				}
+				continue;
+			}
+			// Pools are created in one block, so the last emitter is almost always the right one
+			if (!emitter || emitter->id != object.emitter) {
+				emitter = findEmitter(object.emitter);
+				if (!emitter) {
+					continue;
+				}
+			}
+			pooledCount++;
+			if (object.type == RocketGameObjectType::PARTICLE) {
+				object.age += dt;
+				if (object.age < object.lifetime) {
+					object.color = glm::mix(emitter->settings.startColor, emitter->settings.endColor, object.age / object.lifetime);
+					aliveCount++;
+					continue;
+				}
+				park(object);
+			}
+			emitter->freeSlots.push_back(i);
+		}
+
+		for (auto& state : emitters) {
+			if (!state.settings.enabled) {
+				state.spawnAccumulator = 0.0f;
+				continue;
+			}
+			state.spawnAccumulator += state.settings.rate * dt;
+			uint32_t count = static_cast<uint32_t>(state.spawnAccumulator);
+			state.spawnAccumulator -= count;
+			// A full pool drops the surplus instead of saving it up for a burst later
+			count = std::min(count, static_cast<uint32_t>(state.freeSlots.size()));
+			emit(state, count, gameObjects);
+			aliveCount += count;
+		}
+	}
+
+	void EmitterSystem::emit(EmitterState& emitter, uint32_t count, std::vector<RocketGameObject>& gameObjects)
+	{
+		if (count == 0) {
+			return;
+		}
+		const ParticleEmitter& settings = emitter.settings;
+		// Both buffers only grow up to the largest burst, after that emitting allocates nothing
+		generateSpawnPositions(count, settings.shape, SpawnDistribution::UNIFORM, random, positions);
+		launchValues.resize(2 * static_cast<size_t>(count));
+		random.fillUniform(launchValues.data(), launchValues.size(), 0.0f, 1.0f);
+
+		for (uint32_t i = 0; i < count; i++) {
+			RocketGameObject& object = gameObjects[emitter.freeSlots[i]];
+			float angle = settings.direction + (launchValues[2 * i] - 0.5f) * settings.coneAngle;
+			float speed = settings.minSpeed + (settings.maxSpeed - settings.minSpeed) * launchValues[2 * i + 1];
+			object.type = RocketGameObjectType::PARTICLE;
+			object.transform2d.translation = positions[i];
+			object.transform2d.scale = { 1.0f, 1.0f };
+			object.velocity = speed * glm::vec2(std::cos(angle), std::sin(angle));
+			object.acceleration = settings.acceleration;
+			object.gravityApplied = settings.gravityApplied;
+			object.collisionApplied = settings.collisionApplied;
+			object.radius = settings.radius;
+			object.mass = 1.0f;
+			object.color = settings.startColor;
+			object.age = 0.0f;
+			object.lifetime = settings.lifetime;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "particle_spawner.hpp"
+#include "rocket_random.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rocket {
+	struct ParticleEmitter {
+		SpawnShape shape{};
+		// Particles per second, fractions carry over between frames
+		float rate = 100.0f;
+		// Launch direction in radians (0 is +x, y grows downwards) and the full width of the cone around it
+		float direction = -glm::half_pi<float>();
+		float coneAngle = 0.5f;
+		float minSpeed = 0.5f;
+		float maxSpeed = 1.0f;
+		float lifetime = 2.0f;
+		// Colour fades from startColor to endColor over the lifetime
+		glm::vec3 startColor{ 1.0f, 0.8f, 0.2f };
+		glm::vec3 endColor{ 0.6f, 0.1f, 0.0f };
+		// Collision radius, the model decides the drawn size
+		float radius = 0.01f;
+		glm::vec2 acceleration{ 0.0f, 3.0f };
+		bool gravityApplied = true;
+		bool collisionApplied = false;
+		// Most particles alive at once, the pool is created with the emitter and never grows
+		uint32_t capacity = 1000;
+		std::shared_ptr<RocketModel> model{};
+		bool enabled = true;
+	};
+
+	// Emitters with fixed size particle pools. addEmitter appends capacity parked game objects once; a
+	// particle that outlives its lifetime is parked again and its slot is the next one revived. A running
+	// emitter allocates nothing. Parked slots are type NONE, which the simulation systems ignore; the
+	// instanced and indirect render paths skip them through parked(), the simple path draws them at scale 0.
+	class EmitterSystem {
+	public:
+		EmitterSystem() = default;
+
+		EmitterSystem(const EmitterSystem&) = delete;
+		EmitterSystem& operator=(const EmitterSystem&) = delete;
+
+		uint32_t addEmitter(const ParticleEmitter& emitter, std::vector<RocketGameObject>& gameObjects);
+		// Removes the emitter and its pooled objects from gameObjects
+		void removeEmitter(uint32_t emitterId, std::vector<RocketGameObject>& gameObjects);
+		ParticleEmitter* getEmitter(uint32_t emitterId);
+		// Forgets all emitters, for when gameObjects was cleared
+		void clear();
+		// Takes over particles with emitter ORPHAN_EMITTER, such as ones restored from a snapshot. They are
+		// aged like pooled particles and removed from gameObjects once their lifetime is over.
+		void adoptOrphans(const std::vector<RocketGameObject>& gameObjects);
+		void setSeed(uint64_t seed) { random.setSeed(seed); }
+
+		void updateEmitters(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		size_t emitterCount() const { return emitters.size(); }
+		uint32_t emitterId(size_t emitterIndex) const { return emitters[emitterIndex].id; }
+		size_t aliveParticles() const { return aliveCount; }
+		size_t pooledParticles() const { return pooledCount; }
+	private:
+		struct EmitterState {
+			uint32_t id;
+			ParticleEmitter settings;
+			float spawnAccumulator = 0.0f;
+			// Object indices of the parked slots this frame, refilled every frame in the same storage
+			std::vector<uint32_t> freeSlots;
+		};
+
+		static void park(RocketGameObject& object);
+		void removeExpiredOrphans(std::vector<RocketGameObject>& gameObjects);
+		EmitterState* findEmitter(uint32_t emitterId);
+		void emit(EmitterState& emitter, uint32_t count, std::vector<RocketGameObject>& gameObjects);
+
+		std::vector<EmitterState> emitters;
+		uint32_t nextEmitterId = 0;
+		RocketRandom random{};
+		std::vector<glm::vec2> positions;
+		std::vector<float> launchValues;
+
+		size_t aliveCount = 0;
+		size_t pooledCount = 0;
+		size_t orphanCount = 0;
+		size_t expiredOrphanCount = 0;
+	};
+}
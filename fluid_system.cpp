@@ -0,0 +1,266 @@
+#include "fluid_system.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace rocket {
+	FluidSystem::FluidSystem(glm::vec2 gravity, RocketThreadPool& threadPool) : gravity{ gravity }, threadPool{ threadPool }
+	{
+	}
+
+	void FluidSystem::updateFluid(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		if (!(dt > 0.0f)) {
+			return;
+		}
+		gatherParticles(gameObjects);
+		if (positions.empty()) {
+			return;
+		}
+
+		// Pressure waves must not cross more than a fraction of the kernel per step, so the frame is split
+		int substeps = std::min(maxSubsteps, std::max(1, static_cast<int>(std::ceil(dt / maxTimeStep))));
+		float stepDt = std::min(dt, maxTimeStep * maxSubsteps) / substeps;
+		for (int step = 0; step < substeps; step++) {
+			sortByCell();
+			computeDensity();
+			computeAcceleration();
+			integrate(stepDt);
+		}
+		scatterParticles(gameObjects);
+	}
+
+	void FluidSystem::gatherParticles(std::vector<RocketGameObject>& gameObjects)
+	{
+		positions.clear();
+		velocities.clear();
+		radii.clear();
+		sleeping.clear();
+		objectIndices.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			const auto& object = gameObjects[i];
+			if (object.type != RocketGameObjectType::PARTICLE || object.constraintsApplied) {
+				continue;
+			}
+			positions.push_back(object.transform2d.translation);
+			velocities.push_back(object.velocity);
+			radii.push_back(object.radius);
+			sleeping.push_back(object.sleeping);
+			objectIndices.push_back(i);
+		}
+		accelerations.resize(positions.size());
+		densities.resize(positions.size());
+		pressures.resize(positions.size());
+	}
+
+	void FluidSystem::scatterParticles(std::vector<RocketGameObject>& gameObjects)
+	{
+		threadPool.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				auto& object = gameObjects[objectIndices[i]];
+				object.transform2d.translation = positions[i];
+				object.velocity = velocities[i];
+				object.acceleration = accelerations[i];
+			}
+		}, 4096);
+	}
+
+	glm::ivec2 FluidSystem::cellCoords(glm::vec2 position) const
+	{
+		int x = static_cast<int>(std::floor((position.x - boundsMin.x) / smoothingRadius));
+		int y = static_cast<int>(std::floor((position.y - boundsMin.y) / smoothingRadius));
+		return { std::min(std::max(x, 0), gridWidth - 1), std::min(std::max(y, 0), gridHeight - 1) };
+	}
+
+	template<typename T>
+	void FluidSystem::permute(std::vector<T>& values, std::vector<T>& scratch)
+	{
+		scratch.resize(values.size());
+		for (size_t i = 0; i < values.size(); i++) {
+			scratch[i] = values[sortedOrder[i]];
+		}
+		values.swap(scratch);
+	}
+
+	// Counting sort of the particle arrays by grid cell. Particles barely move between substeps, so the
+	// order stays coherent and the neighbour loops below read mostly contiguous memory.
+	void FluidSystem::sortByCell()
+	{
+		gridWidth = std::max(1, static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / smoothingRadius)));
+		gridHeight = std::max(1, static_cast<int>(std::ceil((boundsMax.y - boundsMin.y) / smoothingRadius)));
+		size_t cellCount = static_cast<size_t>(gridWidth) * gridHeight;
+		size_t count = positions.size();
+
+		particleCells.resize(count);
+		threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				glm::ivec2 cell = cellCoords(positions[i]);
+				particleCells[i] = static_cast<uint32_t>(cell.y * gridWidth + cell.x);
+			}
+		}, 4096);
+
+		cellStart.assign(cellCount + 1, 0);
+		for (size_t i = 0; i < count; i++) {
+			cellStart[particleCells[i] + 1]++;
+		}
+		for (size_t c = 0; c < cellCount; c++) {
+			cellStart[c + 1] += cellStart[c];
+		}
+
+		// Stable scatter using cellStart[c] as the write cursor of cell c, shifted back into place afterwards
+		sortedOrder.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			sortedOrder[cellStart[particleCells[i]]++] = static_cast<uint32_t>(i);
+		}
+		for (size_t c = cellCount; c > 0; c--) {
+			cellStart[c] = cellStart[c - 1];
+		}
+		cellStart[0] = 0;
+
+		permute(positions, scratchVec2);
+		permute(velocities, scratchVec2);
+		permute(radii, scratchFloat);
+		permute(sleeping, scratchFlags);
+		permute(objectIndices, scratchIndices);
+
+		cellAwake.assign(cellCount, 0);
+		for (size_t i = 0; i < count; i++) {
+			if (!sleeping[i]) {
+				cellAwake[particleCells[sortedOrder[i]]] = 1;
+			}
+		}
+		cellNearAwake.assign(cellCount, 0);
+		for (int y = 0; y < gridHeight; y++) {
+			for (int x = 0; x < gridWidth; x++) {
+				if (!cellAwake[y * gridWidth + x]) {
+					continue;
+				}
+				for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, gridHeight - 1); ny++) {
+					for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, gridWidth - 1); nx++) {
+						cellNearAwake[ny * gridWidth + nx] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	void FluidSystem::computeDensity()
+	{
+		const float h = smoothingRadius;
+		const float h2 = h * h;
+		// 2D poly6 kernel, W(r) = 4 / (pi h^8) * (h^2 - r^2)^3
+		const float poly6 = 4.0f / (glm::pi<float>() * std::pow(h, 8.0f));
+		std::atomic<uint64_t> neighbourTotal{ 0 };
+		std::atomic<uint64_t> activeTotal{ 0 };
+
+		threadPool.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+			uint64_t neighbours = 0;
+			uint64_t active = 0;
+			for (size_t i = begin; i < end; i++) {
+				glm::vec2 position = positions[i];
+				glm::ivec2 cell = cellCoords(position);
+				if (!cellNearAwake[cell.y * gridWidth + cell.x]) {
+					continue;
+				}
+				active++;
+				float density = 0.0f;
+				for (int y = std::max(cell.y - 1, 0); y <= std::min(cell.y + 1, gridHeight - 1); y++) {
+					// Cells of a row are adjacent in the sorted order, so three cells are one contiguous range
+					uint32_t rowStart = cellStart[y * gridWidth + std::max(cell.x - 1, 0)];
+					uint32_t rowEnd = cellStart[y * gridWidth + std::min(cell.x + 1, gridWidth - 1) + 1];
+					for (uint32_t j = rowStart; j < rowEnd; j++) {
+						glm::vec2 offset = position - positions[j];
+						float r2 = glm::dot(offset, offset);
+						if (r2 < h2) {
+							float diff = h2 - r2;
+							density += diff * diff * diff;
+							neighbours++;
+						}
+					}
+				}
+				densities[i] = particleMass * poly6 * density;
+				// Clamped at zero, a negative pressure would pull particles into clumps at the surface
+				pressures[i] = std::max(0.0f, stiffness * (densities[i] - restDensity));
+			}
+			neighbourTotal += neighbours;
+			activeTotal += active;
+		}, 512);
+
+		neighbourAverage = activeTotal > 0 ? static_cast<float>(neighbourTotal.load()) / static_cast<float>(activeTotal.load()) : 0.0f;
+	}
+
+	void FluidSystem::computeAcceleration()
+	{
+		const float h = smoothingRadius;
+		const float h2 = h * h;
+		// Gradient of the 2D spiky kernel and laplacian of the 2D viscosity kernel
+		const float spikyGradient = -30.0f / (glm::pi<float>() * std::pow(h, 5.0f));
+		const float viscosityLaplacian = 40.0f / (glm::pi<float>() * std::pow(h, 5.0f));
+
+		threadPool.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (sleeping[i]) {
+					accelerations[i] = glm::vec2{ 0.0f };
+					continue;
+				}
+				glm::vec2 position = positions[i];
+				glm::vec2 velocity = velocities[i];
+				float pressure = pressures[i];
+				glm::ivec2 cell = cellCoords(position);
+				glm::vec2 pressureForce{ 0.0f };
+				glm::vec2 viscosityForce{ 0.0f };
+				for (int y = std::max(cell.y - 1, 0); y <= std::min(cell.y + 1, gridHeight - 1); y++) {
+					uint32_t rowStart = cellStart[y * gridWidth + std::max(cell.x - 1, 0)];
+					uint32_t rowEnd = cellStart[y * gridWidth + std::min(cell.x + 1, gridWidth - 1) + 1];
+					for (uint32_t j = rowStart; j < rowEnd; j++) {
+						if (j == i) {
+							continue;
+						}
+						glm::vec2 offset = position - positions[j];
+						float r2 = glm::dot(offset, offset);
+						if (r2 >= h2) {
+							continue;
+						}
+						float r = std::sqrt(r2);
+						float q = h - r;
+						float invDensity = 1.0f / densities[j];
+						// Coincident particles get pushed apart along an arbitrary but deterministic axis
+						glm::vec2 direction = r > 1e-6f ? offset / r : glm::vec2(i < j ? -1.0f : 1.0f, 0.0f);
+						pressureForce -= direction * ((pressure + pressures[j]) * 0.5f * invDensity * spikyGradient * q * q);
+						viscosityForce += (velocities[j] - velocity) * (invDensity * viscosityLaplacian * q);
+					}
+				}
+				accelerations[i] = gravity + particleMass * (pressureForce + viscosity * viscosityForce) / densities[i];
+			}
+		}, 512);
+	}
+
+	void FluidSystem::integrate(float dt)
+	{
+		threadPool.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (sleeping[i]) {
+					continue;
+				}
+				glm::vec2 velocity = velocities[i] + accelerations[i] * dt;
+				glm::vec2 position = positions[i] + velocity * dt;
+				glm::vec2 lower = boundsMin + glm::vec2(radii[i]);
+				glm::vec2 upper = boundsMax - glm::vec2(radii[i]);
+				for (int axis = 0; axis < 2; axis++) {
+					if (position[axis] < lower[axis]) {
+						position[axis] = lower[axis];
+						velocity[axis] = -velocity[axis] * boundaryDamping;
+					}
+					else if (position[axis] > upper[axis]) {
+						position[axis] = upper[axis];
+						velocity[axis] = -velocity[axis] * boundaryDamping;
+					}
+				}
+				velocities[i] = velocity;
+				positions[i] = position;
+			}
+		}, 4096);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "rocket_thread_pool.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// Smoothed particle hydrodynamics for RocketGameObjectType::PARTICLE objects, an alternative to
+	// PhysicsSystem's rigid circle collisions. Particle state is copied into arrays that are sorted by
+	// grid cell every substep, so neighbours are contiguous in memory, and every pass runs on the thread pool.
+	// Sleeping particles are not moved, they only take part as neighbours of awake ones.
+	class FluidSystem {
+	public:
+		FluidSystem(glm::vec2 gravity, RocketThreadPool& threadPool);
+
+		FluidSystem(const FluidSystem&) = delete;
+		FluidSystem& operator=(const FluidSystem&) = delete;
+
+		void updateFluid(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		glm::vec2 gravity;
+		float smoothingRadius = 0.04f;
+		float particleMass = 1.0f;
+		// Density of particles resting one diameter (0.02) apart: mass / spacing^2
+		float restDensity = 2500.0f;
+		float stiffness = 100.0f;
+		float viscosity = 50.0f;
+		float maxTimeStep = 0.004f;
+		int maxSubsteps = 8;
+		float boundaryDamping = 0.3f;
+		glm::vec2 boundsMin{ -1.0f, -1.0f };
+		glm::vec2 boundsMax{ 1.0f, 1.0f };
+
+		size_t particleCount() const { return positions.size(); }
+		float averageNeighbours() const { return neighbourAverage; }
+	private:
+		void gatherParticles(std::vector<RocketGameObject>& gameObjects);
+		void scatterParticles(std::vector<RocketGameObject>& gameObjects);
+		void sortByCell();
+		void computeDensity();
+		void computeAcceleration();
+		void integrate(float dt);
+		glm::ivec2 cellCoords(glm::vec2 position) const;
+		template<typename T> void permute(std::vector<T>& values, std::vector<T>& scratch);
+
+		RocketThreadPool& threadPool;
+
+		// Particle arrays, in cell order after sortByCell()
+		std::vector<glm::vec2> positions;
+		std::vector<glm::vec2> velocities;
+		std::vector<glm::vec2> accelerations;
+		std::vector<float> radii;
+		std::vector<uint8_t> sleeping;
+		std::vector<float> densities;
+		std::vector<float> pressures;
+		std::vector<uint32_t> objectIndices;
+
+		// Uniform grid with cells of smoothingRadius, cellStart has one extra entry so a cell's
+		// particles are [cellStart[c], cellStart[c + 1])
+		int gridWidth = 0;
+		int gridHeight = 0;
+		std::vector<uint32_t> cellStart;
+		// Cells with an awake particle in their 3x3 neighbourhood, only their particles need a density
+		std::vector<uint8_t> cellAwake;
+		std::vector<uint8_t> cellNearAwake;
+		std::vector<uint32_t> particleCells;
+		std::vector<uint32_t> sortedOrder;
+		std::vector<glm::vec2> scratchVec2;
+		std::vector<float> scratchFloat;
+		std::vector<uint8_t> scratchFlags;
+		std::vector<uint32_t> scratchIndices;
+
+		float neighbourAverage = 0.0f;
+	};
+}
@@ -0,0 +1,284 @@
+#include "indirect_render_system.hpp"
+#include "rocket_model.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace rocket {
+	// Smallest buffer created, so an empty scene still has valid descriptors
+	static constexpr VkDeviceSize MIN_BUFFER_SIZE = 256;
+
+	struct BuildDrawsPush {
+		glm::vec2 viewMin;
+		glm::vec2 viewMax;
+		uint32_t objectCount;
+		uint32_t batchCount;
+	};
+
+	struct IndirectDrawPush {
+		glm::vec2 viewCenter;
+		glm::vec2 viewScale;
+		uint32_t firstInstance;
+	};
+
+	IndirectRenderSystem::IndirectRenderSystem(RocketDevice& device, RocketPipelineManager& pipelineManager, VkRenderPass renderPass)
+		: rocketDevice{ device }, pipelineManager{ pipelineManager }
+	{
+		createDescriptorSetLayout();
+		createDescriptorSets();
+		createPipelineLayouts();
+		createPipelines(renderPass);
+	}
+
+	IndirectRenderSystem::~IndirectRenderSystem()
+	{
+		for (auto& frame : frames) {
+			destroyFrameBuffer(rocketDevice, frame.instances);
+			destroyFrameBuffer(rocketDevice, frame.batches);
+			destroyFrameBuffer(rocketDevice, frame.draws);
+			destroyFrameBuffer(rocketDevice, frame.visible);
+			destroyFrameBuffer(rocketDevice, frame.readback);
+		}
+		computePipeline.reset();
+		vkDestroyDescriptorPool(rocketDevice.device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(rocketDevice.device(), graphicsPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(rocketDevice.device(), computePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(rocketDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void IndirectRenderSystem::createDescriptorSetLayout()
+	{
+		// instances, batches, draws, visible. The vertex shader reads instances through visible.
+		std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+		bindings[3].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(rocketDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create indirect draw descriptor set layout");
+		}
+	}
+
+	void IndirectRenderSystem::createDescriptorSets()
+	{
+		FrameDescriptorSets sets;
+		descriptorPool = createFrameDescriptorSets(rocketDevice, descriptorSetLayout, 4, sets);
+		for (size_t i = 0; i < frames.size(); i++) {
+			FrameResources& frame = frames[i];
+			frame.descriptorSet = sets[i];
+			reserve(frame.instances, MIN_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+			reserve(frame.batches, MIN_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+			reserve(frame.draws, MIN_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+			reserve(frame.visible, MIN_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false);
+			reserve(frame.readback, MIN_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+			updateDescriptorSet(frame);
+		}
+	}
+
+	void IndirectRenderSystem::createPipelineLayouts()
+	{
+		VkPushConstantRange computePushRange{};
+		computePushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePushRange.offset = 0;
+		computePushRange.size = sizeof(BuildDrawsPush);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &computePushRange;
+		if (vkCreatePipelineLayout(rocketDevice.device(), &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create build draws pipeline layout");
+		}
+
+		VkPushConstantRange graphicsPushRange{};
+		graphicsPushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		graphicsPushRange.offset = 0;
+		graphicsPushRange.size = sizeof(IndirectDrawPush);
+		pipelineLayoutInfo.pPushConstantRanges = &graphicsPushRange;
+		if (vkCreatePipelineLayout(rocketDevice.device(), &pipelineLayoutInfo, nullptr, &graphicsPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create indirect draw pipeline layout");
+		}
+	}
+
+	void IndirectRenderSystem::createPipelines(VkRenderPass renderPass)
+	{
+		auto computeShader = rocketDevice.getShaderCache().getModule(computeShaderPath);
+		computePipeline = std::make_unique<RocketComputePipeline>(rocketDevice, computeShader->getShaderModule(), computePipelineLayout);
+
+		PipelineConfigInfo pipelineConfig{};
+		RocketPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = graphicsPipelineLayout;
+		pipelineConfig.specializationConstants.set(SHADER_CONSTANT_INDIRECT, VK_TRUE);
+		pipelineConfig.specializationConstants.set(SHADER_CONSTANT_USE_VERTEX_COLOR, VK_FALSE);
+		graphicsPipeline = pipelineManager.getPipelineAsync(vertShaderPath, fragShaderPath, pipelineConfig);
+		pipelineConfig.specializationConstants.set(SHADER_CONSTANT_USE_VERTEX_COLOR, VK_TRUE);
+		vertexColorPipeline = pipelineManager.getPipelineAsync(vertShaderPath, fragShaderPath, pipelineConfig);
+	}
+
+	bool IndirectRenderSystem::reserve(FrameBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible)
+	{
+		return reserveFrameBuffer(rocketDevice, buffer, size, MIN_BUFFER_SIZE, usage, hostVisible);
+	}
+
+	void IndirectRenderSystem::updateDescriptorSet(FrameResources& frame)
+	{
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos{ {
+			{ frame.instances.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.batches.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.draws.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.visible.buffer, 0, VK_WHOLE_SIZE }
+		} };
+		std::array<VkWriteDescriptorSet, 4> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(rocketDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	void IndirectRenderSystem::prepare(VkCommandBuffer commandBuffer, std::vector<RocketGameObject>& gameObjects)
+	{
+		auto start = std::chrono::steady_clock::now();
+		FrameResources& frame = frames[frameIndex];
+		frameIndex = (frameIndex + 1) % frames.size();
+		currentFrame = &frame;
+
+		// The slot's previous frame has finished, its instance counts are final
+		const VkDrawIndexedIndirectCommand* finishedDraws = static_cast<const VkDrawIndexedIndirectCommand*>(frame.readback.mapped);
+		visibleCount = 0;
+		for (uint32_t batch = 0; batch < frame.readbackBatches; batch++) {
+			visibleCount += finishedDraws[batch].instanceCount;
+		}
+		frame.readbackBatches = 0;
+
+		bool recreated = reserve(frame.instances, sizeof(InstanceData) * gameObjects.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+
+		// Instance data and per model object counts, kept in firstInstance until the prefix sum below
+		batchModels.clear();
+		batchData.clear();
+		uint32_t lastBatch = 0;
+		InstanceData* instances = static_cast<InstanceData*>(frame.instances.mapped);
+		uint32_t written = 0;
+		for (auto& object : gameObjects) {
+			RocketModel* model = object.model.get();
+			if (model == nullptr || object.parked()) {
+				continue;
+			}
+			// Few models and long runs of the same one, a linear search from the last hit is enough
+			if (batchModels.empty() || batchModels[lastBatch] != model) {
+				auto it = std::find(batchModels.begin(), batchModels.end(), model);
+				if (it == batchModels.end()) {
+					batchModels.push_back(model);
+					const GeometryRange& range = model->getRange();
+					batchData.push_back({ range.indexCount, range.firstIndex, static_cast<int32_t>(range.firstVertex), 0, model->getBoundingRadius() });
+					it = batchModels.end() - 1;
+				}
+				lastBatch = static_cast<uint32_t>(it - batchModels.begin());
+			}
+			batchData[lastBatch].firstInstance++;
+
+			glm::mat2 transform = object.transform2d.mat2();
+			InstanceData& instance = instances[written++];
+			instance.transform = { transform[0][0], transform[0][1], transform[1][0], transform[1][1] };
+			instance.offset = object.transform2d.translation;
+			instance.color = packInstanceColor(object.color);
+			instance.batch = lastBatch;
+		}
+		objectCount = written;
+		uint32_t firstInstance = 0;
+		for (auto& batch : batchData) {
+			uint32_t count = batch.firstInstance;
+			batch.firstInstance = firstInstance;
+			firstInstance += count;
+		}
+
+		uint32_t batchCount = static_cast<uint32_t>(batchData.size());
+		recreated |= reserve(frame.batches, sizeof(IndirectBatch) * batchCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+		recreated |= reserve(frame.draws, sizeof(VkDrawIndexedIndirectCommand) * batchCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+		recreated |= reserve(frame.visible, sizeof(uint32_t) * objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false);
+		// Not in the descriptor set
+		reserve(frame.readback, sizeof(VkDrawIndexedIndirectCommand) * batchCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+		if (recreated) {
+			updateDescriptorSet(frame);
+		}
+		if (objectCount == 0) {
+			lastPrepareTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return;
+		}
+		std::memcpy(frame.batches.mapped, batchData.data(), sizeof(IndirectBatch) * batchCount);
+
+		// Instance counts start at zero, build_draws.comp counts them up and fills in the rest
+		vkCmdFillBuffer(commandBuffer, frame.draws.buffer, 0, sizeof(VkDrawIndexedIndirectCommand) * batchCount, 0);
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+		computePipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+		BuildDrawsPush push{ viewCenter - viewHalfExtent, viewCenter + viewHalfExtent, written, batchCount };
+		vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+		vkCmdDispatch(commandBuffer, RocketComputePipeline::groupCount(std::max(written, batchCount), WORKGROUP_SIZE), 1, 1);
+
+		VkMemoryBarrier drawBarrier{};
+		drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copy{ 0, 0, sizeof(VkDrawIndexedIndirectCommand) * batchCount };
+		vkCmdCopyBuffer(commandBuffer, frame.draws.buffer, frame.readback.buffer, 1, &copy);
+		VkMemoryBarrier readbackBarrier{};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
+		frame.readbackBatches = batchCount;
+
+		lastPrepareTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void IndirectRenderSystem::render(VkCommandBuffer commandBuffer)
+	{
+		assert(currentFrame != nullptr && "prepare() has to be recorded before render()");
+		if (objectCount == 0 || !(useVertexColor ? vertexColorPipeline : graphicsPipeline).bind(commandBuffer)) {
+			return;
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout, 0, 1, &currentFrame->descriptorSet, 0, nullptr);
+		RocketGeometryArena* boundArena = nullptr;
+		for (uint32_t batch = 0; batch < batchModels.size(); batch++) {
+			if (&batchModels[batch]->getArena() != boundArena) {
+				boundArena = &batchModels[batch]->getArena();
+				boundArena->bind(commandBuffer);
+			}
+			IndirectDrawPush push{ viewCenter, 1.0f / viewHalfExtent, batchData[batch].firstInstance };
+			vkCmdPushConstants(commandBuffer, graphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+			vkCmdDrawIndexedIndirect(commandBuffer, currentFrame->draws.buffer, batch * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+}
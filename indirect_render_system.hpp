@@ -0,0 +1,111 @@
+#pragma once
+#include "instanced_render_system.hpp"
+#include "rocket_compute_pipeline.hpp"
+#include "rocket_device.hpp"
+#include "rocket_frame_buffers.hpp"
+#include "rocket_game_object.hpp"
+#include "rocket_pipeline_manager.hpp"
+#include "rocket_swap_chain.hpp"
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocket {
+	// Per model draw batch, as build_draws.comp reads it
+	struct IndirectBatch {
+		// The model's range of the geometry arena
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		// Start of the batch's range in the visible index buffer
+		uint32_t firstInstance;
+		// The model's bounding radius, scaled per object for culling
+		float boundingRadius;
+		uint32_t padding = 0;
+	};
+
+	// GPU driven drawing. The CPU writes each object's InstanceData (the simulation runs on the CPU) and
+	// one IndirectBatch per model. prepare() then records a compute pass that compacts the object indices
+	// of every batch into the visible buffer and writes the VkDrawIndexedIndirectCommands, so the CPU never
+	// builds per object draw commands. render() binds the geometry arena once and issues one
+	// vkCmdDrawIndexedIndirect per model.
+	// The same pass culls: an object whose bounding circle lies entirely outside the view rectangle
+	// never gets a slot, so a zoomed in view only costs vertex work for what is on screen.
+	// Objects are drawn grouped by model, in the order each model first appears in gameObjects.
+	class IndirectRenderSystem {
+	public:
+		IndirectRenderSystem(RocketDevice& device, RocketPipelineManager& pipelineManager, VkRenderPass renderPass);
+		~IndirectRenderSystem();
+
+		IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+		IndirectRenderSystem& operator=(const IndirectRenderSystem&) = delete;
+
+		// Records the compute pass, outside the render pass. Call once for every frame that is submitted.
+		void prepare(VkCommandBuffer commandBuffer, std::vector<RocketGameObject>& gameObjects);
+		// Inside the render pass, after prepare()
+		void render(VkCommandBuffer commandBuffer);
+
+		// World rectangle mapped to the screen
+		glm::vec2 viewCenter{ 0.0f };
+		glm::vec2 viewHalfExtent{ 1.0f };
+
+		size_t batches() const { return batchModels.size(); }
+		size_t objects() const { return objectCount; }
+		// Objects that survived culling, read back from the frame that last used this frame's buffers
+		size_t visibleObjects() const { return visibleCount; }
+		double prepareMilliseconds() const { return lastPrepareTime; }
+
+		// Draw the models' vertex colours instead of each object's colour
+		bool useVertexColor = false;
+
+		// The instanced shaders, specialized with SHADER_CONSTANT_INDIRECT
+		std::string vertShaderPath = "shaders/instanced_shader.vert.spv";
+		std::string fragShaderPath = "shaders/instanced_shader.frag.spv";
+		std::string computeShaderPath = "shaders/build_draws.comp.spv";
+	private:
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+		// Buffers of one frame in flight
+		struct FrameResources {
+			FrameBuffer instances;
+			FrameBuffer batches;
+			FrameBuffer draws;
+			FrameBuffer visible;
+			// Host copy of the draw commands, for the visible count once the frame has finished
+			FrameBuffer readback;
+			uint32_t readbackBatches = 0;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		void createDescriptorSetLayout();
+		void createDescriptorSets();
+		void createPipelineLayouts();
+		void createPipelines(VkRenderPass renderPass);
+		bool reserve(FrameBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible);
+		void updateDescriptorSet(FrameResources& frame);
+
+		RocketDevice& rocketDevice;
+		RocketPipelineManager& pipelineManager;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout graphicsPipelineLayout = VK_NULL_HANDLE;
+		std::unique_ptr<RocketComputePipeline> computePipeline;
+		RocketPipelineFuture graphicsPipeline;
+		RocketPipelineFuture vertexColorPipeline;
+		std::array<FrameResources, RocketSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+		size_t frameIndex = 0;
+		FrameResources* currentFrame = nullptr;
+
+		// This frame's models and batches, rebuilt by prepare()
+		std::vector<RocketModel*> batchModels;
+		std::vector<IndirectBatch> batchData;
+		size_t objectCount = 0;
+		size_t visibleCount = 0;
+		double lastPrepareTime = 0.0;
+	};
+}
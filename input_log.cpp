@@ -0,0 +1,110 @@
+#include "input_log.hpp"
+#include "broadphase.hpp"
+#include "rocket_utils.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace rocket {
+	static constexpr uint32_t INPUT_LOG_MAGIC = 0x474C4952; // "RILG"
+	static constexpr uint32_t INPUT_LOG_VERSION = 3;
+
+	void InputLog::begin(uint64_t seed, const SimulationSettings& settings)
+	{
+		clear();
+		randomSeed = seed;
+		simulationSettings = settings;
+	}
+
+	void InputLog::clear()
+	{
+		frames.clear();
+		commands.clear();
+		pendingCommands = 0;
+	}
+
+	void InputLog::addCommand(const InputCommand& command)
+	{
+		commands.push_back(command);
+		pendingCommands++;
+	}
+
+	void InputLog::endFrame(float dt, uint64_t stateHash)
+	{
+		Frame frame{};
+		frame.dt = dt;
+		frame.firstCommand = static_cast<uint32_t>(commands.size() - pendingCommands);
+		frame.commandCount = pendingCommands;
+		frame.stateHash = stateHash;
+		frames.push_back(frame);
+		pendingCommands = 0;
+	}
+
+	void InputLog::save(const std::string& path) const
+	{
+		std::ofstream file{ path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+		uint32_t header[4] = { INPUT_LOG_MAGIC, INPUT_LOG_VERSION, static_cast<uint32_t>(frames.size()), static_cast<uint32_t>(commands.size() - pendingCommands) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(&randomSeed), sizeof(randomSeed));
+		file.write(reinterpret_cast<const char*>(&simulationSettings), sizeof(simulationSettings));
+		file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(Frame));
+		file.write(reinterpret_cast<const char*>(commands.data()), header[3] * sizeof(InputCommand));
+		if (!file) {
+			throw std::runtime_error("Failed to write input log: " + path);
+		}
+	}
+
+	void InputLog::load(const std::string& path)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+		uint32_t header[4];
+		if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != INPUT_LOG_MAGIC) {
+			throw std::runtime_error("Not an input log: " + path);
+		}
+		if (header[1] != INPUT_LOG_VERSION) {
+			throw std::runtime_error("Unsupported input log version in " + path);
+		}
+		uint64_t seed = 0;
+		SimulationSettings settings{};
+		std::vector<Frame> loadedFrames(header[2]);
+		std::vector<InputCommand> loadedCommands(header[3]);
+		file.read(reinterpret_cast<char*>(&seed), sizeof(seed));
+		file.read(reinterpret_cast<char*>(&settings), sizeof(settings));
+		file.read(reinterpret_cast<char*>(loadedFrames.data()), loadedFrames.size() * sizeof(Frame));
+		if (!file.read(reinterpret_cast<char*>(loadedCommands.data()), loadedCommands.size() * sizeof(InputCommand))) {
+			throw std::runtime_error("Truncated input log: " + path);
+		}
+		if (settings.broadphase > static_cast<uint32_t>(BroadphaseType::DYNAMIC_TREE)) {
+			throw std::runtime_error("Corrupt input log: " + path);
+		}
+		for (const auto& frame : loadedFrames) {
+			if (frame.firstCommand > loadedCommands.size() || frame.commandCount > loadedCommands.size() - frame.firstCommand) {
+				throw std::runtime_error("Corrupt input log: " + path);
+			}
+		}
+		randomSeed = seed;
+		simulationSettings = settings;
+		frames = std::move(loadedFrames);
+		commands = std::move(loadedCommands);
+		pendingCommands = 0;
+	}
+
+	uint64_t hashSimulationState(const std::vector<RocketGameObject>& gameObjects)
+	{
+		uint64_t hash = hashBytes(nullptr, 0);
+		for (const auto& object : gameObjects) {
+			hash = hashBytes(&object.type, sizeof(object.type), hash);
+			hash = hashBytes(&object.transform2d.translation, sizeof(object.transform2d.translation), hash);
+			hash = hashBytes(&object.transform2d.rotation, sizeof(object.transform2d.rotation), hash);
+			hash = hashBytes(&object.velocity, sizeof(object.velocity), hash);
+			hash = hashBytes(&object.angularVelocity, sizeof(object.angularVelocity), hash);
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "rocket_game_object.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rocket {
+	enum class InputCommandType : uint32_t {
+		// Spawn count particles in a box around position
+		SPAWN,
+		// Move the particle under position to position
+		DRAG,
+		CLEAR
+	};
+
+	struct InputCommand {
+		InputCommandType type;
+		uint32_t count = 0;
+		glm::vec2 position{ 0.0f };
+	};
+
+	// The options stepSimulation reads, as they were when a recording started, including the rigid body,
+	// continuous collision and world collider tunables and whether the demo level is loaded. Written to
+	// the log as bytes, so only fixed size fields; flags are 0 or 1, broadphase is a BroadphaseType.
+	struct SimulationSettings {
+		uint32_t fluidMode;
+		uint32_t sleepEnabled;
+		uint32_t continuousCollision;
+		uint32_t reorderEnabled;
+		int32_t reorderInterval;
+		float reorderCellSize;
+		int32_t constraintSubsteps;
+		int32_t constraintIterations;
+		float smoothingRadius;
+		float restDensity;
+		float stiffness;
+		float viscosity;
+		int32_t fluidMaxSubsteps;
+		float sleepSpeed;
+		float wakeSpeed;
+		float timeToSleep;
+		int32_t rigidVelocityIterations;
+		int32_t rigidRelaxIterations;
+		float rigidFriction;
+		float baumgarte;
+		float linearSlop;
+		float maxCorrectionSpeed;
+		float rigidMaxTimeStep;
+		int32_t rigidMaxSubsteps;
+		uint32_t broadphase;
+		float fastMotionFraction;
+		int32_t continuousMaxPasses;
+		uint32_t demoLevel;
+		uint32_t worldDistanceField;
+		float worldRestitution;
+		float worldFriction;
+	};
+
+	static_assert(sizeof(SimulationSettings) == 124, "simulation settings layout changed, bump INPUT_LOG_VERSION");
+	static_assert(std::is_trivially_copyable<SimulationSettings>::value, "simulation settings are copied as bytes");
+
+	// Everything that changed the simulation, frame by frame: the commands applied before each step,
+	// the step's dt and a hash of the state after it. Starting from a cleared scene with the same seed
+	// and settings, replaying the commands with the recorded dts has to reproduce every hash. Settings
+	// changed while recording are not logged, the replay diverges from there.
+	class InputLog {
+	public:
+		struct Frame {
+			float dt;
+			uint32_t firstCommand;
+			uint32_t commandCount;
+			uint32_t padding = 0;
+			uint64_t stateHash;
+		};
+
+		void begin(uint64_t seed, const SimulationSettings& settings);
+		void clear();
+		// Commands belong to the next frame that ends
+		void addCommand(const InputCommand& command);
+		void endFrame(float dt, uint64_t stateHash);
+
+		uint64_t seed() const { return randomSeed; }
+		const SimulationSettings& settings() const { return simulationSettings; }
+		size_t frameCount() const { return frames.size(); }
+		const Frame& frame(size_t frameIndex) const { return frames[frameIndex]; }
+		const InputCommand* frameCommands(size_t frameIndex) const { return commands.data() + frames[frameIndex].firstCommand; }
+
+		// Binary file, throws std::runtime_error on failure
+		void save(const std::string& path) const;
+		void load(const std::string& path);
+	private:
+		uint64_t randomSeed = 0;
+		SimulationSettings simulationSettings{};
+		std::vector<Frame> frames;
+		std::vector<InputCommand> commands;
+		uint32_t pendingCommands = 0;
+	};
+
+	// FNV-1a over the type, position, rotation, velocity and angular velocity of every game object, in order. Ids are left
+	// out, they depend on how many objects were created before.
+	uint64_t hashSimulationState(const std::vector<RocketGameObject>& gameObjects);
+}
@@ -0,0 +1,179 @@
+#include "instanced_render_system.hpp"
+#include "rocket_model.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+namespace rocket {
+	static constexpr size_t MIN_INSTANCE_CAPACITY = 1024;
+	// RenderQueue pipeline id, this system has a single pipeline
+	static constexpr uint32_t INSTANCED_PIPELINE = 0;
+
+	InstancedRenderSystem::InstancedRenderSystem(RocketDevice& device, RocketPipelineManager& pipelineManager, VkRenderPass renderPass)
+		: rocketDevice{ device }, pipelineManager{ pipelineManager }
+	{
+		createDescriptorSetLayout();
+		createDescriptorSets();
+		createPipelineLayout();
+		createPipeline(renderPass);
+		for (auto& frame : frames) {
+			reserve(frame, MIN_INSTANCE_CAPACITY);
+		}
+	}
+
+	InstancedRenderSystem::~InstancedRenderSystem()
+	{
+		for (auto& frame : frames) {
+			destroyFrameBuffer(rocketDevice, frame.instances);
+		}
+		// Destroying the pool frees its descriptor sets
+		vkDestroyDescriptorPool(rocketDevice.device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(rocketDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(rocketDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void InstancedRenderSystem::createDescriptorSetLayout()
+	{
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(rocketDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create instance descriptor set layout");
+		}
+	}
+
+	void InstancedRenderSystem::createDescriptorSets()
+	{
+		FrameDescriptorSets sets;
+		descriptorPool = createFrameDescriptorSets(rocketDevice, descriptorSetLayout, 1, sets);
+		for (size_t i = 0; i < frames.size(); i++) {
+			frames[i].descriptorSet = sets[i];
+		}
+	}
+
+	void InstancedRenderSystem::createPipelineLayout()
+	{
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		// No push constants, firstInstance of each draw is the offset into the instance buffer
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+		if (vkCreatePipelineLayout(rocketDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create instanced pipeline layout");
+		}
+	}
+
+	void InstancedRenderSystem::createPipeline(VkRenderPass renderPass)
+	{
+		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+		PipelineConfigInfo pipelineConfig{};
+		RocketPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = pipelineLayout;
+		// Through the manager so shader edits are hot reloaded like the other pipelines
+		pipelineConfig.specializationConstants.set(SHADER_CONSTANT_USE_VERTEX_COLOR, VK_FALSE);
+		pipeline = pipelineManager.getPipelineAsync(vertShaderPath, fragShaderPath, pipelineConfig);
+		pipelineConfig.specializationConstants.set(SHADER_CONSTANT_USE_VERTEX_COLOR, VK_TRUE);
+		vertexColorPipeline = pipelineManager.getPipelineAsync(vertShaderPath, fragShaderPath, pipelineConfig);
+	}
+
+	void InstancedRenderSystem::reserve(FrameResources& frame, size_t count)
+	{
+		// Host visible and mapped, every frame writes straight into it
+		if (!reserveFrameBuffer(rocketDevice, frame.instances, sizeof(InstanceData) * count, sizeof(InstanceData) * MIN_INSTANCE_CAPACITY,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true)) {
+			return;
+		}
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = frame.instances.buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = frame.instances.size;
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = frame.descriptorSet;
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(rocketDevice.device(), 1, &write, 0, nullptr);
+	}
+
+	uint32_t packInstanceColor(glm::vec3 color)
+	{
+		if (color.x > 1.0f || color.y > 1.0f || color.z > 1.0f) {
+			color /= 255.0f;
+		}
+		auto channel = [](float value) {
+			return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+		};
+		return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (255u << 24);
+	}
+
+	void InstancedRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer, std::vector<RocketGameObject>& gameObjects)
+	{
+		auto start = std::chrono::steady_clock::now();
+		drawCount = 0;
+		instanceCount = 0;
+		FrameResources& frame = frames[frameIndex];
+		frameIndex = (frameIndex + 1) % frames.size();
+
+		if (!(useVertexColor ? vertexColorPipeline : pipeline).bind(commandBuffer)) {
+			return;
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+
+		renderQueue.clear();
+		runCount = 0;
+		RocketModel* previousModel = nullptr;
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			RocketModel* model = gameObjects[i].model.get();
+			if (model == nullptr || gameObjects[i].parked()) {
+				continue;
+			}
+			if (model != previousModel) {
+				runCount++;
+				previousModel = model;
+			}
+			renderQueue.add(INSTANCED_PIPELINE, model, i);
+		}
+		renderQueue.sort();
+
+		// Instance data in queue order, so each bucket's objects are one contiguous range
+		reserve(frame, renderQueue.size());
+		const std::vector<uint32_t>& order = renderQueue.order();
+		InstanceData* instances = static_cast<InstanceData*>(frame.instances.mapped);
+		for (size_t i = 0; i < order.size(); i++) {
+			Transform2dComponent& transform2d = gameObjects[order[i]].transform2d;
+			glm::mat2 transform = transform2d.mat2();
+			InstanceData& instance = instances[i];
+			instance.transform = { transform[0][0], transform[0][1], transform[1][0], transform[1][1] };
+			instance.offset = transform2d.translation;
+			instance.color = packInstanceColor(gameObjects[order[i]].color);
+			instance.batch = 0;
+		}
+		RocketGeometryArena* boundArena = nullptr;
+		for (const auto& bucket : renderQueue.buckets()) {
+			if (&bucket.model->getArena() != boundArena) {
+				boundArena = &bucket.model->getArena();
+				boundArena->bind(commandBuffer);
+			}
+			bucket.model->draw(commandBuffer, bucket.count, bucket.first);
+			drawCount++;
+		}
+
+		instanceCount = order.size();
+		lastRecordTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
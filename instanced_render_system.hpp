@@ -0,0 +1,90 @@
+#pragma once
+#include "rocket_device.hpp"
+#include "rocket_game_object.hpp"
+#include "rocket_pipeline_manager.hpp"
+#include "render_queue.hpp"
+#include "rocket_frame_buffers.hpp"
+#include "rocket_swap_chain.hpp"
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocket {
+	// One object as instanced_shader.vert reads it (std430), 32 bytes
+	struct InstanceData {
+		// Columns of Transform2dComponent::mat2()
+		glm::vec4 transform;
+		glm::vec2 offset;
+		// RGBA8 from packInstanceColor
+		uint32_t color;
+		// Draw batch of the object's model, only read by IndirectRenderSystem
+		uint32_t batch;
+	};
+
+	// Colours with any component above 1 are taken as 0 to 255, like the particles' { 40, 40, 40 }, and
+	// divided by 255 first. Components then clamped to [0, 1], x in the lowest byte as unpackUnorm4x8 expects
+	uint32_t packInstanceColor(glm::vec3 color);
+
+	// Draws game objects from a storage buffer of InstanceData instead of one push constant block per
+	// object. Objects go through a RenderQueue, so every object that shares a model is written next to
+	// the others in the frame's buffer and goes out as a single instanced draw, with firstInstance
+	// pointing at its objects' data. Models share the geometry arena, so it is bound once per frame.
+	// Models are drawn in the order they first appear in gameObjects, objects of one model in
+	// gameObjects order.
+	class InstancedRenderSystem {
+	public:
+		InstancedRenderSystem(RocketDevice& device, RocketPipelineManager& pipelineManager, VkRenderPass renderPass);
+		~InstancedRenderSystem();
+
+		InstancedRenderSystem(const InstancedRenderSystem&) = delete;
+		InstancedRenderSystem& operator=(const InstancedRenderSystem&) = delete;
+
+		// Call once for every frame that is submitted
+		void renderGameObjects(VkCommandBuffer commandBuffer, std::vector<RocketGameObject>& gameObjects);
+
+		size_t drawCalls() const { return drawCount; }
+		// Model runs in gameObjects order, the binds drawing without the queue would have cost
+		size_t unsortedRuns() const { return runCount; }
+		size_t instances() const { return instanceCount; }
+		double recordMilliseconds() const { return lastRecordTime; }
+
+		// Draw the models' vertex colours instead of each object's colour
+		bool useVertexColor = false;
+
+		std::string vertShaderPath = "shaders/instanced_shader.vert.spv";
+		std::string fragShaderPath = "shaders/instanced_shader.frag.spv";
+	private:
+		// Instance buffer of one frame in flight
+		struct FrameResources {
+			FrameBuffer instances;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		void createDescriptorSetLayout();
+		void createDescriptorSets();
+		void createPipelineLayout();
+		void createPipeline(VkRenderPass renderPass);
+		void reserve(FrameResources& frame, size_t count);
+
+		RocketDevice& rocketDevice;
+		RocketPipelineManager& pipelineManager;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		RocketPipelineFuture pipeline;
+		// Same shaders, specialized with SHADER_CONSTANT_USE_VERTEX_COLOR
+		RocketPipelineFuture vertexColorPipeline;
+		std::array<FrameResources, RocketSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+		size_t frameIndex = 0;
+
+		RenderQueue renderQueue;
+		size_t drawCount = 0;
+		size_t runCount = 0;
+		size_t instanceCount = 0;
+		double lastRecordTime = 0.0;
+	};
+}
@@ -1,12 +1,31 @@
 #include "tutorial_app.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-	rocket::TutorialApp app{};
+int main(int argc, char** argv) {
+	// Rocket --cook-mesh model.obj writes model.obj.rmesh ahead of time, without opening a window
+	if (argc >= 3 && std::strcmp(argv[1], "--cook-mesh") == 0) {
+		try {
+			rocket::cookMesh(argv[2]);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
 
 	try {
+		// Rocket --replay input.rlog steps a recorded session without rendering and checks its state hashes
+		if (argc >= 3 && std::strcmp(argv[1], "--replay") == 0) {
+			rocket::TutorialApp app{};
+			return app.replay(argv[2]);
+		}
+		// Rocket --demo-level starts in the world collider demo level instead of the empty scene
+		bool demoLevel = argc >= 2 && std::strcmp(argv[1], "--demo-level") == 0;
+		rocket::TutorialApp app{ demoLevel };
 		app.run();
 	}
 	catch (const std::exception& e) {
@@ -14,4 +33,4 @@ int main() {
 		return EXIT_FAILURE;
 	}
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,156 @@
+#include "particle_reorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace rocket {
+	// Keeps the probe loop from being optimised away
+	static volatile float probeSink = 0.0f;
+
+	// Spreads the low 16 bits of x to the even bits
+	static uint32_t partBy1(uint32_t x)
+	{
+		x &= 0x0000FFFF;
+		x = (x | (x << 8)) & 0x00FF00FF;
+		x = (x | (x << 4)) & 0x0F0F0F0F;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+
+	uint32_t ParticleReorder::mortonCode(uint32_t x, uint32_t y)
+	{
+		return partBy1(x) | (partBy1(y) << 1);
+	}
+
+	void ParticleReorder::update(std::vector<RocketGameObject>& gameObjects)
+	{
+		if (++framesSinceReorder < reorderInterval) {
+			return;
+		}
+		reorder(gameObjects, probeEveryReorder);
+	}
+
+	uint32_t ParticleReorder::indexOf(id_t id) const
+	{
+		auto it = std::lower_bound(sortedIds.begin(), sortedIds.end(), id);
+		return it != sortedIds.end() && *it == id ? sortedIdIndices[it - sortedIds.begin()] : UINT32_MAX;
+	}
+
+	// LSD radix sort of keys and values by 8 bit digits, skipping the digits above the largest key
+	void ParticleReorder::radixSort()
+	{
+		uint32_t maxKey = *std::max_element(keys.begin(), keys.end());
+		scratchKeys.resize(keys.size());
+		scratchValues.resize(values.size());
+		for (uint32_t shift = 0; shift < 32 && (maxKey >> shift) != 0; shift += 8) {
+			uint32_t offsets[257] = {};
+			for (uint32_t key : keys) {
+				offsets[((key >> shift) & 0xFF) + 1]++;
+			}
+			for (int digit = 1; digit < 257; digit++) {
+				offsets[digit] += offsets[digit - 1];
+			}
+			for (size_t i = 0; i < keys.size(); i++) {
+				uint32_t destination = offsets[(keys[i] >> shift) & 0xFF]++;
+				scratchKeys[destination] = keys[i];
+				scratchValues[destination] = values[i];
+			}
+			keys.swap(scratchKeys);
+			values.swap(scratchValues);
+		}
+	}
+
+	// Reads every particle and the next few in Morton order, the access pattern of a cell by cell neighbour search
+	double ParticleReorder::probeNeighbours(const std::vector<RocketGameObject>& gameObjects, const std::vector<uint32_t>& order) const
+	{
+		const size_t neighbours = 8;
+		auto start = std::chrono::steady_clock::now();
+		float sum = 0.0f;
+		for (size_t i = 0; i < order.size(); i++) {
+			const auto& particle = gameObjects[order[i]];
+			for (size_t j = i + 1; j < std::min(order.size(), i + 1 + neighbours); j++) {
+				const auto& other = gameObjects[order[j]];
+				glm::vec2 offset = other.transform2d.translation - particle.transform2d.translation;
+				sum += glm::dot(offset, offset) * (other.radius + particle.radius) + glm::dot(other.velocity, particle.velocity);
+			}
+		}
+		probeSink = sum;
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void ParticleReorder::reorder(std::vector<RocketGameObject>& gameObjects, bool probe)
+	{
+		auto start = std::chrono::steady_clock::now();
+		framesSinceReorder = 0;
+
+		keys.clear();
+		values.clear();
+		particleSlots.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			const auto& object = gameObjects[i];
+			if (object.type != RocketGameObjectType::PARTICLE) {
+				continue;
+			}
+			particleSlots.push_back(i);
+			// Clamped as floats, 16 bits per axis is far more cells than the window holds
+			glm::vec2 cell = glm::floor((object.transform2d.translation - boundsMin) / cellSize);
+			uint32_t x = static_cast<uint32_t>(glm::clamp(cell.x, 0.0f, 65535.0f));
+			uint32_t y = static_cast<uint32_t>(glm::clamp(cell.y, 0.0f, 65535.0f));
+			keys.push_back(mortonCode(x, y));
+			values.push_back(i);
+		}
+
+		double probeTime = 0.0;
+		if (!keys.empty()) {
+			radixSort();
+
+			double gap = 0.0;
+			for (size_t i = 1; i < values.size(); i++) {
+				gap += std::abs(static_cast<int64_t>(values[i]) - static_cast<int64_t>(values[i - 1]));
+			}
+			lastIndexGap = values.size() > 1 ? static_cast<float>(gap / (values.size() - 1)) : 0.0f;
+			if (probe) {
+				lastProbeBefore = probeNeighbours(gameObjects, values);
+				lastProbeAfter = lastProbeBefore;
+				probeTime = lastProbeBefore;
+			}
+		}
+
+		// Skipped when nothing moved far enough to change the order since the last reorder
+		if (!keys.empty() && !std::is_sorted(values.begin(), values.end())) {
+			// The particles in Morton order go back into the particle slots, other objects stay put.
+			// scratchObjects stays allocated between reorders.
+			scratchObjects.clear();
+			scratchObjects.reserve(values.size());
+			for (uint32_t index : values) {
+				scratchObjects.push_back(std::move(gameObjects[index]));
+			}
+			for (size_t i = 0; i < particleSlots.size(); i++) {
+				gameObjects[particleSlots[i]] = std::move(scratchObjects[i]);
+			}
+			scratchObjects.clear();
+
+			if (probe) {
+				lastProbeAfter = probeNeighbours(gameObjects, particleSlots);
+				probeTime += lastProbeAfter;
+			}
+		}
+
+		keys.clear();
+		values.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			keys.push_back(gameObjects[i].getId());
+			values.push_back(i);
+		}
+		if (!keys.empty()) {
+			radixSort();
+		}
+		sortedIds.swap(keys);
+		sortedIdIndices.swap(values);
+		reorders++;
+		lastReorderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() - probeTime;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "rocket_game_object.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// Every reorderInterval frames, sorts the particles in gameObjects by the Morton (Z-order) code of
+	// their grid cell with a radix sort. Particles close in space end up close in memory, so the systems
+	// that gather neighbours cell by cell touch far fewer cache lines. Only the slots that already hold
+	// particles are rewritten, every other object keeps its index.
+	// Systems look objects up by id every frame, so they follow the new order on their own; indexOf gives
+	// the same lookup without a search.
+	class ParticleReorder {
+	public:
+		using id_t = RocketGameObject::id_t;
+
+		ParticleReorder() = default;
+
+		ParticleReorder(const ParticleReorder&) = delete;
+		ParticleReorder& operator=(const ParticleReorder&) = delete;
+
+		// Counts frames and reorders when due, probing only if probeEveryReorder is set
+		void update(std::vector<RocketGameObject>& gameObjects);
+		// With probe, times a neighbour walk before and after. That costs about as much as the reorder itself.
+		void reorder(std::vector<RocketGameObject>& gameObjects, bool probe = false);
+		// Starts counting towards the next reorder from zero
+		void restartSchedule() { framesSinceReorder = 0; }
+		// Index of the object with id as of the last reorder, UINT32_MAX if it was not there
+		uint32_t indexOf(id_t id) const;
+
+		static uint32_t mortonCode(uint32_t x, uint32_t y);
+
+		int reorderInterval = 60;
+		float cellSize = 0.02f;
+		glm::vec2 boundsMin{ -1.0f, -1.0f };
+		bool probeEveryReorder = false;
+
+		size_t reorderCount() const { return reorders; }
+		// Mean distance in gameObjects between particles that are neighbours in Morton order, measured just
+		// before the last reorder. It is 1 right after a reorder and grows as particles move and spawn.
+		float indexGapBefore() const { return lastIndexGap; }
+		// A neighbour walk in Morton order over gameObjects, timed before and after the last probed reorder
+		double probeMillisecondsBefore() const { return lastProbeBefore; }
+		double probeMillisecondsAfter() const { return lastProbeAfter; }
+		double reorderMilliseconds() const { return lastReorderTime; }
+	private:
+		void radixSort();
+		double probeNeighbours(const std::vector<RocketGameObject>& gameObjects, const std::vector<uint32_t>& order) const;
+
+		int framesSinceReorder = 0;
+		// Morton code and object index of each particle, sorted by code
+		std::vector<uint32_t> keys;
+		std::vector<uint32_t> values;
+		std::vector<uint32_t> scratchKeys;
+		std::vector<uint32_t> scratchValues;
+		// Indices of the particles in gameObjects, ascending, filled in Morton order by the reorder
+		std::vector<uint32_t> particleSlots;
+		std::vector<RocketGameObject> scratchObjects;
+		// Ids sorted with the same radix sort and their indices, searched by indexOf. Cheaper to rebuild
+		// than a hash map with hundreds of thousands of entries.
+		std::vector<id_t> sortedIds;
+		std::vector<uint32_t> sortedIdIndices;
+
+		size_t reorders = 0;
+		float lastIndexGap = 0.0f;
+		double lastProbeBefore = 0.0;
+		double lastProbeAfter = 0.0;
+		double lastReorderTime = 0.0;
+	};
+}
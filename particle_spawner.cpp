@@ -0,0 +1,109 @@
+#include "particle_spawner.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace rocket {
+	static void generateUniform(size_t count, const SpawnShape& shape, RocketRandom& random, std::vector<glm::vec2>& positions)
+	{
+		// glm::vec2 is two tightly packed floats, fill x and y in one batch
+		float* values = &positions[0].x;
+		if (shape.type == SpawnShapeType::BOX) {
+			random.fillUniform(values, 2 * count, -1.0f, 1.0f);
+			for (auto& position : positions) {
+				position = shape.center + position * shape.halfExtents;
+			}
+			return;
+		}
+		// Disc: square root of a uniform radius fraction keeps the density even
+		random.fillUniform(values, 2 * count, 0.0f, 1.0f);
+		float radius = shape.halfExtents.x;
+		for (auto& position : positions) {
+			float r = radius * std::sqrt(position.x);
+			float angle = glm::two_pi<float>() * position.y;
+			position = shape.center + r * glm::vec2(std::cos(angle), std::sin(angle));
+		}
+	}
+
+	static void generateGaussian(size_t count, const SpawnShape& shape, RocketRandom& random, std::vector<glm::vec2>& positions)
+	{
+		float* values = &positions[0].x;
+		random.fillUniform(values, 2 * count, 0.0f, 1.0f);
+		glm::vec2 sigma = shape.halfExtents / 3.0f;
+		for (auto& position : positions) {
+			// Box-Muller, 1 - u keeps the logarithm away from zero
+			float r = std::sqrt(-2.0f * std::log(1.0f - position.x));
+			float angle = glm::two_pi<float>() * position.y;
+			glm::vec2 offset = r * glm::vec2(std::cos(angle), std::sin(angle)) * sigma;
+			if (shape.type == SpawnShapeType::BOX) {
+				offset = glm::clamp(offset, -shape.halfExtents, shape.halfExtents);
+			}
+			else {
+				float length = glm::length(offset);
+				if (length > shape.halfExtents.x) {
+					offset *= shape.halfExtents.x / length;
+				}
+			}
+			position = shape.center + offset;
+		}
+	}
+
+	static void generateGrid(size_t count, const SpawnShape& shape, std::vector<glm::vec2>& positions)
+	{
+		glm::vec2 size = 2.0f * shape.halfExtents;
+		if (shape.type == SpawnShapeType::BOX) {
+			int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(count * size.x / std::max(size.y, 1e-6f)))));
+			int rows = static_cast<int>((count + columns - 1) / columns);
+			glm::vec2 spacing = size / glm::vec2(columns, rows);
+			glm::vec2 first = shape.center - shape.halfExtents + 0.5f * spacing;
+			for (size_t i = 0; i < count; i++) {
+				positions[i] = first + spacing * glm::vec2(static_cast<float>(i % columns), static_cast<float>(i / columns));
+			}
+			return;
+		}
+
+		// Disc: square lattice with the spacing that fits count points in its area, tightened until enough land inside
+		float radius = shape.halfExtents.x;
+		if (radius <= 0.0f) {
+			std::fill(positions.begin(), positions.end(), shape.center);
+			return;
+		}
+		float spacing = std::sqrt(glm::pi<float>() * radius * radius / count);
+		while (true) {
+			size_t written = 0;
+			int steps = static_cast<int>(radius / spacing);
+			for (int y = -steps; y <= steps && written < count; y++) {
+				for (int x = -steps; x <= steps && written < count; x++) {
+					glm::vec2 offset{ x * spacing, y * spacing };
+					if (glm::dot(offset, offset) <= radius * radius) {
+						positions[written++] = shape.center + offset;
+					}
+				}
+			}
+			if (written == count) {
+				return;
+			}
+			spacing *= 0.97f;
+		}
+	}
+
+	void generateSpawnPositions(size_t count, const SpawnShape& shape, SpawnDistribution distribution, RocketRandom& random, std::vector<glm::vec2>& positions)
+	{
+		positions.resize(count);
+		if (count == 0) {
+			return;
+		}
+		switch (distribution) {
+		case SpawnDistribution::UNIFORM:
+			generateUniform(count, shape, random, positions);
+			break;
+		case SpawnDistribution::GAUSSIAN:
+			generateGaussian(count, shape, random, positions);
+			break;
+		case SpawnDistribution::GRID:
+			generateGrid(count, shape, positions);
+			break;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "rocket_random.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace rocket {
+	enum class SpawnShapeType {
+		BOX,
+		DISC
+	};
+
+	struct SpawnShape {
+		SpawnShapeType type = SpawnShapeType::BOX;
+		glm::vec2 center{ 0.0f };
+		// Half size of a box, a disc uses x as its radius
+		glm::vec2 halfExtents{ 0.1f };
+
+		static SpawnShape box(glm::vec2 center, glm::vec2 halfExtents) { return { SpawnShapeType::BOX, center, halfExtents }; }
+		static SpawnShape disc(glm::vec2 center, float radius) { return { SpawnShapeType::DISC, center, glm::vec2(radius) }; }
+	};
+
+	enum class SpawnDistribution {
+		UNIFORM,
+		// Denser towards the centre, standard deviation a third of the extent, clamped into the shape
+		GAUSSIAN,
+		// Evenly spaced lattice filling the shape, no overlaps to push apart on the first step
+		GRID
+	};
+
+	// Fills positions with count points inside shape
+	void generateSpawnPositions(size_t count, const SpawnShape& shape, SpawnDistribution distribution, RocketRandom& random, std::vector<glm::vec2>& positions);
+}
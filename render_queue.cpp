@@ -0,0 +1,77 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+
+namespace rocket {
+	void RenderQueue::clear()
+	{
+		keys.clear();
+		models.clear();
+		lastModel = 0;
+		sortedIndices.clear();
+		sortedBuckets.clear();
+	}
+
+	uint32_t RenderQueue::modelId(RocketModel* model)
+	{
+		// Few models and long runs of the same one, a linear search from the last hit is enough
+		if (!models.empty() && models[lastModel] == model) {
+			return lastModel;
+		}
+		auto it = std::find(models.begin(), models.end(), model);
+		if (it == models.end()) {
+			models.push_back(model);
+			it = models.end() - 1;
+		}
+		lastModel = static_cast<uint32_t>(it - models.begin());
+		return lastModel;
+	}
+
+	void RenderQueue::add(uint32_t pipeline, RocketModel* model, uint32_t objectIndex)
+	{
+		keys.push_back(makeKey(pipeline, modelId(model), objectIndex));
+	}
+
+	void RenderQueue::sort()
+	{
+		size_t count = keys.size();
+		sortedIndices.resize(count);
+		sortedBuckets.clear();
+		if (count == 0) {
+			return;
+		}
+
+		// Entries are added in object order and LSD passes are stable, so only the high half needs sorting.
+		// A byte that is the same in every key (usually all but the low model byte) costs one counting pass.
+		scratchKeys.resize(count);
+		for (int shift = 32; shift < 64; shift += 8) {
+			size_t offsets[256] = {};
+			for (uint64_t key : keys) {
+				offsets[(key >> shift) & 0xFF]++;
+			}
+			if (offsets[(keys[0] >> shift) & 0xFF] == count) {
+				continue;
+			}
+			size_t total = 0;
+			for (size_t& offset : offsets) {
+				size_t bucketSize = offset;
+				offset = total;
+				total += bucketSize;
+			}
+			for (uint64_t key : keys) {
+				scratchKeys[offsets[(key >> shift) & 0xFF]++] = key;
+			}
+			keys.swap(scratchKeys);
+		}
+
+		for (uint32_t i = 0; i < count; i++) {
+			uint64_t key = keys[i];
+			sortedIndices[i] = static_cast<uint32_t>(key);
+			uint32_t state = static_cast<uint32_t>(key >> 32);
+			if (sortedBuckets.empty() || static_cast<uint32_t>(keys[sortedBuckets.back().first] >> 32) != state) {
+				sortedBuckets.push_back({ state >> 24, models[state & 0xFFFFFF], i, 0 });
+			}
+			sortedBuckets.back().count++;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "rocket_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// Groups draws by state before they are recorded. Every entry gets a 64 bit sort key:
+	//   bits 56-63 pipeline, bits 32-55 model, bits 0-31 object index
+	// A radix sort brings equal pipeline and model together, keeping the objects of a bucket in their
+	// original order, and each bucket is then bound once and drawn with one instanced draw.
+	// Pipelines are small ids chosen by the render system, models are numbered in order of first use.
+	class RenderQueue {
+	public:
+		struct Bucket {
+			uint32_t pipeline;
+			RocketModel* model;
+			// Range in order()
+			uint32_t first;
+			uint32_t count;
+		};
+
+		RenderQueue() = default;
+
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue& operator=(const RenderQueue&) = delete;
+
+		void clear();
+		void add(uint32_t pipeline, RocketModel* model, uint32_t objectIndex);
+		void sort();
+
+		size_t size() const { return keys.size(); }
+		// Object indices in draw order, valid after sort()
+		const std::vector<uint32_t>& order() const { return sortedIndices; }
+		const std::vector<Bucket>& buckets() const { return sortedBuckets; }
+
+		static uint64_t makeKey(uint32_t pipeline, uint32_t model, uint32_t objectIndex)
+		{
+			return (static_cast<uint64_t>(pipeline & 0xFF) << 56) | (static_cast<uint64_t>(model & 0xFFFFFF) << 32) | objectIndex;
+		}
+	private:
+		uint32_t modelId(RocketModel* model);
+
+		std::vector<uint64_t> keys;
+		std::vector<uint64_t> scratchKeys;
+		std::vector<RocketModel*> models;
+		uint32_t lastModel = 0;
+		std::vector<uint32_t> sortedIndices;
+		std::vector<Bucket> sortedBuckets;
+	};
+}
@@ -0,0 +1,547 @@
+#include "rigid_body_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace rocket {
+	static float cross2d(glm::vec2 a, glm::vec2 b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	// Angular velocity crossed with an offset, the velocity of that point around the centre of mass
+	static glm::vec2 cross2d(float w, glm::vec2 r)
+	{
+		return { -w * r.y, w * r.x };
+	}
+
+	static uint64_t pairKey(RocketGameObject::id_t a, RocketGameObject::id_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	// Keeps the part of the segment on the negative side of dot(normal, x) = offset
+	static int clipSegment(glm::vec2 out[2], const glm::vec2 in[2], glm::vec2 normal, float offset)
+	{
+		int count = 0;
+		float distance0 = glm::dot(normal, in[0]) - offset;
+		float distance1 = glm::dot(normal, in[1]) - offset;
+		if (distance0 <= 0.0f) {
+			out[count++] = in[0];
+		}
+		if (distance1 <= 0.0f) {
+			out[count++] = in[1];
+		}
+		if (distance0 * distance1 < 0.0f) {
+			out[count++] = in[0] + (in[1] - in[0]) * (distance0 / (distance0 - distance1));
+		}
+		return count;
+	}
+
+	ConvexPolygon ConvexPolygon::create(std::vector<glm::vec2> vertices)
+	{
+		assert(vertices.size() >= 3 && "convex polygon needs at least 3 vertices");
+		float doubleArea = 0.0f;
+		glm::vec2 centroid{ 0.0f };
+		for (size_t i = 0; i < vertices.size(); i++) {
+			glm::vec2 a = vertices[i];
+			glm::vec2 b = vertices[(i + 1) % vertices.size()];
+			float c = cross2d(a, b);
+			doubleArea += c;
+			centroid += (a + b) * c;
+		}
+		centroid /= 3.0f * doubleArea;
+		if (doubleArea < 0.0f) {
+			std::reverse(vertices.begin(), vertices.end());
+			doubleArea = -doubleArea;
+		}
+
+		ConvexPolygon polygon;
+		for (auto& vertex : vertices) {
+			vertex -= centroid;
+		}
+		float inertiaSum = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			glm::vec2 a = vertices[i];
+			glm::vec2 b = vertices[(i + 1) % vertices.size()];
+			glm::vec2 edge = b - a;
+			polygon.normals.push_back(glm::normalize(glm::vec2(edge.y, -edge.x)));
+			inertiaSum += cross2d(a, b) * (glm::dot(a, a) + glm::dot(a, b) + glm::dot(b, b));
+		}
+		polygon.vertices = std::move(vertices);
+		polygon.area = 0.5f * doubleArea;
+		polygon.unitInertia = inertiaSum / (6.0f * doubleArea);
+		return polygon;
+	}
+
+	ConvexPolygon ConvexPolygon::createBox(glm::vec2 halfExtents)
+	{
+		return create({
+			{ -halfExtents.x, -halfExtents.y },
+			{ halfExtents.x, -halfExtents.y },
+			{ halfExtents.x, halfExtents.y },
+			{ -halfExtents.x, halfExtents.y } });
+	}
+
+	RigidBodySystem::RigidBodySystem(glm::vec2 gravity) : gravity{ gravity }
+	{
+	}
+
+	uint32_t RigidBodySystem::addShape(ConvexPolygon shape)
+	{
+		shapes.push_back(std::move(shape));
+		return static_cast<uint32_t>(shapes.size() - 1);
+	}
+
+	void RigidBodySystem::addBody(const RocketGameObject& object, uint32_t shape)
+	{
+		assert(object.type == RocketGameObjectType::RIGID_BODY && "rigid bodies need a RIGID_BODY game object");
+		assert(shape < shapes.size() && "unknown rigid body shape");
+		bodyIds.push_back(object.getId());
+		bodyShapes.push_back(shape);
+	}
+
+	std::unordered_map<RigidBodySystem::id_t, uint32_t> RigidBodySystem::shapesById() const
+	{
+		std::unordered_map<id_t, uint32_t> result;
+		result.reserve(bodyIds.size());
+		for (size_t i = 0; i < bodyIds.size(); i++) {
+			result[bodyIds[i]] = bodyShapes[i];
+		}
+		return result;
+	}
+
+	void RigidBodySystem::clear()
+	{
+		bodyIds.clear();
+		bodyShapes.clear();
+		pairs.clear();
+		manifolds.clear();
+		previousManifolds.clear();
+		previousManifoldIndex.clear();
+		activeContacts = 0;
+	}
+
+	void RigidBodySystem::setBroadphase(BroadphaseType type)
+	{
+		if (type != broadphase->type()) {
+			broadphase = Broadphase::create(type);
+		}
+	}
+
+	void RigidBodySystem::removeMissingBodies()
+	{
+		uint32_t kept = 0;
+		for (uint32_t slot = 0; slot < bodyIds.size(); slot++) {
+			if (objectIndexById.count(bodyIds[slot])) {
+				bodyIds[kept] = bodyIds[slot];
+				bodyShapes[kept] = bodyShapes[slot];
+				kept++;
+			}
+		}
+		bodyIds.resize(kept);
+		bodyShapes.resize(kept);
+		previousManifolds.clear();
+		previousManifoldIndex.clear();
+	}
+
+	bool RigidBodySystem::gatherBodies(std::vector<RocketGameObject>& gameObjects)
+	{
+		objectIndexById.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			if (gameObjects[i].type == RocketGameObjectType::RIGID_BODY) {
+				objectIndexById.emplace(gameObjects[i].getId(), i);
+			}
+		}
+		for (id_t id : bodyIds) {
+			if (!objectIndexById.count(id)) {
+				removeMissingBodies();
+				break;
+			}
+		}
+		if (bodyIds.empty()) {
+			return false;
+		}
+
+		size_t count = bodyIds.size();
+		objectIndices.resize(count);
+		positions.resize(count);
+		rotations.resize(count);
+		velocities.resize(count);
+		angularVelocities.resize(count);
+		inverseMasses.resize(count);
+		inverseInertias.resize(count);
+		worldVertexStart.resize(count + 1);
+		bounds.resize(count);
+		worldVertexStart[0] = 0;
+		for (size_t slot = 0; slot < count; slot++) {
+			uint32_t index = objectIndexById[bodyIds[slot]];
+			const auto& object = gameObjects[index];
+			const auto& shape = shapes[bodyShapes[slot]];
+			objectIndices[slot] = index;
+			positions[slot] = object.transform2d.translation;
+			rotations[slot] = object.transform2d.rotation;
+			velocities[slot] = object.velocity;
+			angularVelocities[slot] = object.angularVelocity;
+			inverseMasses[slot] = object.mass > 0.0f ? 1.0f / object.mass : 0.0f;
+			inverseInertias[slot] = object.mass > 0.0f ? 1.0f / (object.mass * shape.unitInertia) : 0.0f;
+			worldVertexStart[slot + 1] = worldVertexStart[slot] + static_cast<uint32_t>(shape.vertices.size());
+		}
+		worldVertices.resize(worldVertexStart[count]);
+		worldNormals.resize(worldVertexStart[count]);
+		return true;
+	}
+
+	void RigidBodySystem::updateBounds()
+	{
+		for (size_t slot = 0; slot < bodyIds.size(); slot++) {
+			const auto& shape = shapes[bodyShapes[slot]];
+			float c = std::cos(rotations[slot]);
+			float s = std::sin(rotations[slot]);
+			glm::vec2 lower{ positions[slot] };
+			glm::vec2 upper{ positions[slot] };
+			uint32_t start = worldVertexStart[slot];
+			for (size_t i = 0; i < shape.vertices.size(); i++) {
+				glm::vec2 v = shape.vertices[i];
+				glm::vec2 n = shape.normals[i];
+				glm::vec2 world = positions[slot] + glm::vec2(c * v.x - s * v.y, s * v.x + c * v.y);
+				worldVertices[start + i] = world;
+				worldNormals[start + i] = glm::vec2(c * n.x - s * n.y, s * n.x + c * n.y);
+				lower = glm::min(lower, world);
+				upper = glm::max(upper, world);
+			}
+			// Contacts are kept up to linearSlop apart, grow the bounds so those pairs stay in the broadphase
+			bounds[slot] = { lower - glm::vec2(linearSlop), upper + glm::vec2(linearSlop) };
+		}
+	}
+
+	void RigidBodySystem::findPairs()
+	{
+		// Bodies that disappeared change the body count, which makes the broadphase rebuild
+		broadphase->update(bounds);
+		pairs.clear();
+		broadphase->findPairs(pairs);
+		pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](const std::pair<uint32_t, uint32_t>& pair) {
+			return inverseMasses[pair.first] == 0.0f && inverseMasses[pair.second] == 0.0f;
+		}), pairs.end());
+	}
+
+	// Largest separation of b along the edge normals of a, edge receives the normal it was found on
+	float RigidBodySystem::findMaxSeparation(uint32_t a, uint32_t b, int& edge) const
+	{
+		float maxSeparation = -FLT_MAX;
+		for (uint32_t i = worldVertexStart[a]; i < worldVertexStart[a + 1]; i++) {
+			glm::vec2 normal = worldNormals[i];
+			glm::vec2 vertex = worldVertices[i];
+			float separation = FLT_MAX;
+			for (uint32_t j = worldVertexStart[b]; j < worldVertexStart[b + 1]; j++) {
+				separation = std::min(separation, glm::dot(normal, worldVertices[j] - vertex));
+			}
+			if (separation > maxSeparation) {
+				maxSeparation = separation;
+				edge = static_cast<int>(i - worldVertexStart[a]);
+			}
+		}
+		return maxSeparation;
+	}
+
+	bool RigidBodySystem::collide(uint32_t a, uint32_t b, Manifold& manifold) const
+	{
+		int edgeA = 0;
+		float separationA = findMaxSeparation(a, b, edgeA);
+		if (separationA > linearSlop) {
+			return false;
+		}
+		int edgeB = 0;
+		float separationB = findMaxSeparation(b, a, edgeB);
+		if (separationB > linearSlop) {
+			return false;
+		}
+
+		// Prefer a as the reference so the choice does not flicker between nearly equal axes
+		bool flip = separationB > separationA + 0.1f * linearSlop;
+		uint32_t reference = flip ? b : a;
+		uint32_t incident = flip ? a : b;
+		int referenceEdge = flip ? edgeB : edgeA;
+
+		uint32_t referenceStart = worldVertexStart[reference];
+		uint32_t referenceCount = worldVertexStart[reference + 1] - referenceStart;
+		glm::vec2 normal = worldNormals[referenceStart + referenceEdge];
+		glm::vec2 v11 = worldVertices[referenceStart + referenceEdge];
+		glm::vec2 v12 = worldVertices[referenceStart + (referenceEdge + 1) % referenceCount];
+
+		// Incident edge is the one facing the reference normal the most
+		uint32_t incidentStart = worldVertexStart[incident];
+		uint32_t incidentCount = worldVertexStart[incident + 1] - incidentStart;
+		int incidentEdge = 0;
+		float minDot = FLT_MAX;
+		for (uint32_t i = 0; i < incidentCount; i++) {
+			float d = glm::dot(normal, worldNormals[incidentStart + i]);
+			if (d < minDot) {
+				minDot = d;
+				incidentEdge = static_cast<int>(i);
+			}
+		}
+		glm::vec2 incidentSegment[2] = {
+			worldVertices[incidentStart + incidentEdge],
+			worldVertices[incidentStart + (incidentEdge + 1) % incidentCount] };
+
+		// Clip the incident edge to the side planes of the reference edge
+		glm::vec2 tangent = glm::normalize(v12 - v11);
+		glm::vec2 clipped1[2];
+		glm::vec2 clipped2[2];
+		if (clipSegment(clipped1, incidentSegment, -tangent, -glm::dot(tangent, v11)) < 2) {
+			return false;
+		}
+		if (clipSegment(clipped2, clipped1, tangent, glm::dot(tangent, v12)) < 2) {
+			return false;
+		}
+
+		manifold.a = a;
+		manifold.b = b;
+		manifold.normal = flip ? -normal : normal;
+		manifold.pointCount = 0;
+		float referenceOffset = glm::dot(normal, v11);
+		for (int i = 0; i < 2; i++) {
+			float separation = glm::dot(normal, clipped2[i]) - referenceOffset;
+			if (separation > linearSlop) {
+				continue;
+			}
+			ContactPoint& point = manifold.points[manifold.pointCount++];
+			point = {};
+			point.position = clipped2[i];
+			point.separation = separation;
+			point.featureId = static_cast<uint32_t>(referenceEdge) | (static_cast<uint32_t>(incidentEdge) << 8) |
+				(static_cast<uint32_t>(i) << 16) | (static_cast<uint32_t>(flip) << 24);
+		}
+		return manifold.pointCount > 0;
+	}
+
+	void RigidBodySystem::solveContacts(int iterations, bool useBias)
+	{
+		for (int iteration = 0; iteration < iterations; iteration++) {
+			for (auto& manifold : manifolds) {
+				uint32_t a = manifold.a;
+				uint32_t b = manifold.b;
+				glm::vec2 normal = manifold.normal;
+				glm::vec2 tangent{ normal.y, -normal.x };
+				float mA = inverseMasses[a], iA = inverseInertias[a];
+				float mB = inverseMasses[b], iB = inverseInertias[b];
+				for (int i = 0; i < manifold.pointCount; i++) {
+					ContactPoint& point = manifold.points[i];
+
+					glm::vec2 relative = velocities[b] + cross2d(angularVelocities[b], point.rB) - velocities[a] - cross2d(angularVelocities[a], point.rA);
+					float lambda = -point.tangentMass * glm::dot(relative, tangent);
+					float maxFriction = friction * point.normalImpulse;
+					float tangentImpulse = glm::clamp(point.tangentImpulse + lambda, -maxFriction, maxFriction);
+					lambda = tangentImpulse - point.tangentImpulse;
+					point.tangentImpulse = tangentImpulse;
+					glm::vec2 impulse = tangent * lambda;
+					velocities[a] -= impulse * mA;
+					angularVelocities[a] -= iA * cross2d(point.rA, impulse);
+					velocities[b] += impulse * mB;
+					angularVelocities[b] += iB * cross2d(point.rB, impulse);
+				}
+
+				if (manifold.blockSolve) {
+					solveBlock(manifold, useBias);
+					continue;
+				}
+				for (int i = 0; i < manifold.pointCount; i++) {
+					ContactPoint& point = manifold.points[i];
+					glm::vec2 relative = velocities[b] + cross2d(angularVelocities[b], point.rB) - velocities[a] - cross2d(angularVelocities[a], point.rA);
+					float bias = useBias ? point.bias : std::min(point.bias, 0.0f);
+					float lambda = point.normalMass * (bias - glm::dot(relative, normal));
+					float normalImpulse = std::max(point.normalImpulse + lambda, 0.0f);
+					lambda = normalImpulse - point.normalImpulse;
+					point.normalImpulse = normalImpulse;
+					glm::vec2 impulse = normal * lambda;
+					velocities[a] -= impulse * mA;
+					angularVelocities[a] -= iA * cross2d(point.rA, impulse);
+					velocities[b] += impulse * mB;
+					angularVelocities[b] += iB * cross2d(point.rB, impulse);
+				}
+			}
+		}
+	}
+
+	// Solves both normal impulses of a two point manifold together (2x2 mixed linear complementarity
+	// problem by enumerating the four cases). Solving them one after the other always favours the first
+	// point, which makes tall stacks lean over time.
+	void RigidBodySystem::solveBlock(Manifold& manifold, bool useBias)
+	{
+		uint32_t a = manifold.a;
+		uint32_t b = manifold.b;
+		glm::vec2 normal = manifold.normal;
+		float mA = inverseMasses[a], iA = inverseInertias[a];
+		float mB = inverseMasses[b], iB = inverseInertias[b];
+		ContactPoint& p1 = manifold.points[0];
+		ContactPoint& p2 = manifold.points[1];
+
+		glm::vec2 dv1 = velocities[b] + cross2d(angularVelocities[b], p1.rB) - velocities[a] - cross2d(angularVelocities[a], p1.rA);
+		glm::vec2 dv2 = velocities[b] + cross2d(angularVelocities[b], p2.rB) - velocities[a] - cross2d(angularVelocities[a], p2.rA);
+		float bias1 = useBias ? p1.bias : std::min(p1.bias, 0.0f);
+		float bias2 = useBias ? p2.bias : std::min(p2.bias, 0.0f);
+		float oldX1 = p1.normalImpulse;
+		float oldX2 = p2.normalImpulse;
+		// b = vn - bias - K * x_old, the new impulses x solve K x + b = vn_new with x >= 0, vn_new >= 0
+		float b1 = glm::dot(dv1, normal) - bias1 - (manifold.k11 * oldX1 + manifold.k12 * oldX2);
+		float b2 = glm::dot(dv2, normal) - bias2 - (manifold.k12 * oldX1 + manifold.k22 * oldX2);
+
+		float x1 = 0.0f;
+		float x2 = 0.0f;
+		float determinant = manifold.k11 * manifold.k22 - manifold.k12 * manifold.k12;
+		// Both points pushing
+		x1 = -(manifold.k22 * b1 - manifold.k12 * b2) / determinant;
+		x2 = -(manifold.k11 * b2 - manifold.k12 * b1) / determinant;
+		if (x1 < 0.0f || x2 < 0.0f) {
+			// Only the first point pushing, the second separating
+			x1 = -b1 / manifold.k11;
+			x2 = 0.0f;
+			if (x1 < 0.0f || manifold.k12 * x1 + b2 < 0.0f) {
+				// Only the second point pushing
+				x1 = 0.0f;
+				x2 = -b2 / manifold.k22;
+				if (x2 < 0.0f || manifold.k12 * x2 + b1 < 0.0f) {
+					// Both separating
+					x1 = 0.0f;
+					x2 = 0.0f;
+					if (b1 < 0.0f || b2 < 0.0f) {
+						// No case holds, which only happens with inconsistent input, keep the old impulses
+						return;
+					}
+				}
+			}
+		}
+
+		glm::vec2 impulse1 = normal * (x1 - oldX1);
+		glm::vec2 impulse2 = normal * (x2 - oldX2);
+		p1.normalImpulse = x1;
+		p2.normalImpulse = x2;
+		velocities[a] -= (impulse1 + impulse2) * mA;
+		angularVelocities[a] -= iA * (cross2d(p1.rA, impulse1) + cross2d(p2.rA, impulse2));
+		velocities[b] += (impulse1 + impulse2) * mB;
+		angularVelocities[b] += iB * (cross2d(p1.rB, impulse1) + cross2d(p2.rB, impulse2));
+	}
+
+	void RigidBodySystem::step(float dt)
+	{
+		size_t count = bodyIds.size();
+		for (size_t slot = 0; slot < count; slot++) {
+			if (inverseMasses[slot] > 0.0f) {
+				velocities[slot] += gravity * dt;
+			}
+		}
+
+		updateBounds();
+		findPairs();
+
+		// Narrowphase, matching contacts to last step's by feature id to warm start them
+		manifolds.clear();
+		for (const auto& pair : pairs) {
+			Manifold manifold;
+			if (!collide(pair.first, pair.second, manifold)) {
+				continue;
+			}
+			auto previous = previousManifoldIndex.find(pairKey(bodyIds[pair.first], bodyIds[pair.second]));
+			if (previous != previousManifoldIndex.end()) {
+				const Manifold& old = previousManifolds[previous->second];
+				for (int i = 0; i < manifold.pointCount; i++) {
+					for (int j = 0; j < old.pointCount; j++) {
+						if (old.points[j].featureId == manifold.points[i].featureId) {
+							manifold.points[i].normalImpulse = old.points[j].normalImpulse;
+							manifold.points[i].tangentImpulse = old.points[j].tangentImpulse;
+						}
+					}
+				}
+			}
+			manifolds.push_back(manifold);
+		}
+
+		activeContacts = 0;
+		for (auto& manifold : manifolds) {
+			uint32_t a = manifold.a;
+			uint32_t b = manifold.b;
+			glm::vec2 normal = manifold.normal;
+			glm::vec2 tangent{ normal.y, -normal.x };
+			float mA = inverseMasses[a], iA = inverseInertias[a];
+			float mB = inverseMasses[b], iB = inverseInertias[b];
+			for (int i = 0; i < manifold.pointCount; i++) {
+				ContactPoint& point = manifold.points[i];
+				point.rA = point.position - positions[a];
+				point.rB = point.position - positions[b];
+				float rnA = cross2d(point.rA, normal);
+				float rnB = cross2d(point.rB, normal);
+				point.normalMass = 1.0f / (mA + mB + iA * rnA * rnA + iB * rnB * rnB);
+				float rtA = cross2d(point.rA, tangent);
+				float rtB = cross2d(point.rB, tangent);
+				point.tangentMass = 1.0f / (mA + mB + iA * rtA * rtA + iB * rtB * rtB);
+				// Speculative contacts may close their gap this step, overlapping ones are pushed apart
+				point.bias = point.separation > 0.0f
+					? -point.separation / dt
+					: std::min(baumgarte / dt * std::max(0.0f, -point.separation - linearSlop), maxCorrectionSpeed);
+
+				glm::vec2 impulse = normal * point.normalImpulse + tangent * point.tangentImpulse;
+				velocities[a] -= impulse * mA;
+				angularVelocities[a] -= iA * cross2d(point.rA, impulse);
+				velocities[b] += impulse * mB;
+				angularVelocities[b] += iB * cross2d(point.rB, impulse);
+				activeContacts++;
+			}
+
+			manifold.blockSolve = false;
+			if (manifold.pointCount == 2) {
+				const ContactPoint& p1 = manifold.points[0];
+				const ContactPoint& p2 = manifold.points[1];
+				float rn1A = cross2d(p1.rA, normal);
+				float rn1B = cross2d(p1.rB, normal);
+				float rn2A = cross2d(p2.rA, normal);
+				float rn2B = cross2d(p2.rB, normal);
+				manifold.k11 = mA + mB + iA * rn1A * rn1A + iB * rn1B * rn1B;
+				manifold.k22 = mA + mB + iA * rn2A * rn2A + iB * rn2B * rn2B;
+				manifold.k12 = mA + mB + iA * rn1A * rn2A + iB * rn1B * rn2B;
+				// Nearly parallel rows (points almost on top of each other) fall back to one point at a time
+				const float maxConditionNumber = 1000.0f;
+				manifold.blockSolve = manifold.k11 * manifold.k11 < maxConditionNumber * (manifold.k11 * manifold.k22 - manifold.k12 * manifold.k12);
+			}
+		}
+
+		// Biased iterations push overlapping bodies apart. The push would stay in the velocities and make deep
+		// stacks jitter, so after moving the bodies the relax iterations solve again without bias.
+		solveContacts(velocityIterations, true);
+		for (size_t slot = 0; slot < count; slot++) {
+			positions[slot] += velocities[slot] * dt;
+			rotations[slot] += angularVelocities[slot] * dt;
+		}
+		solveContacts(relaxIterations, false);
+
+		previousManifolds.swap(manifolds);
+		previousManifoldIndex.clear();
+		for (uint32_t i = 0; i < previousManifolds.size(); i++) {
+			const Manifold& manifold = previousManifolds[i];
+			previousManifoldIndex.emplace(pairKey(bodyIds[manifold.a], bodyIds[manifold.b]), i);
+		}
+	}
+
+	void RigidBodySystem::updateRigidBodies(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		if (!(dt > 0.0f) || !gatherBodies(gameObjects)) {
+			return;
+		}
+		int substeps = std::min(maxSubsteps, std::max(1, static_cast<int>(std::ceil(dt / maxTimeStep))));
+		float stepDt = std::min(dt, maxTimeStep * maxSubsteps) / substeps;
+		for (int i = 0; i < substeps; i++) {
+			step(stepDt);
+		}
+
+		for (size_t slot = 0; slot < bodyIds.size(); slot++) {
+			auto& object = gameObjects[objectIndices[slot]];
+			object.transform2d.translation = positions[slot];
+			object.transform2d.rotation = rotations[slot];
+			object.velocity = velocities[slot];
+			object.angularVelocity = angularVelocities[slot];
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "broadphase.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+	// Convex polygon in body space, counter clockwise and centred on its centroid
+	struct ConvexPolygon {
+		std::vector<glm::vec2> vertices;
+		std::vector<glm::vec2> normals;
+		float area = 0.0f;
+		// Rotational inertia of the shape for unit mass
+		float unitInertia = 0.0f;
+
+		static ConvexPolygon create(std::vector<glm::vec2> vertices);
+		static ConvexPolygon createBox(glm::vec2 halfExtents);
+	};
+
+	// Rigid bodies for RIGID_BODY game objects: convex polygon shapes with rotation and angular velocity,
+	// a pluggable broadphase (sort and sweep by default), separating axis narrowphase with clipped two point
+	// manifolds and a sequential impulse solver that warm starts from last frame's impulses and solves
+	// the two normal impulses of a manifold as one block.
+	// Objects with mass 0 are static.
+	class RigidBodySystem {
+	public:
+		using id_t = RocketGameObject::id_t;
+
+		RigidBodySystem(glm::vec2 gravity);
+
+		RigidBodySystem(const RigidBodySystem&) = delete;
+		RigidBodySystem& operator=(const RigidBodySystem&) = delete;
+
+		uint32_t addShape(ConvexPolygon shape);
+		const ConvexPolygon& getShape(uint32_t shape) const { return shapes[shape]; }
+		size_t shapeCount() const { return shapes.size(); }
+		// Uses the object's translation, rotation, mass and velocity as the initial state
+		void addBody(const RocketGameObject& object, uint32_t shape);
+		void clear();
+		void setBroadphase(BroadphaseType type);
+		BroadphaseType broadphaseType() const { return broadphase->type(); }
+
+		void updateRigidBodies(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		glm::vec2 gravity;
+		int velocityIterations = 8;
+		int relaxIterations = 4;
+		float friction = 0.5f;
+		// Fraction of the overlap beyond linearSlop removed per step
+		float baumgarte = 0.2f;
+		float linearSlop = 0.0002f;
+		float maxCorrectionSpeed = 0.2f;
+		// Boxes are small next to gravity in clip space units, stacks need steps well below a frame
+		float maxTimeStep = 1.0f / 480.0f;
+		int maxSubsteps = 8;
+
+		size_t bodyCount() const { return bodyIds.size(); }
+		// Shape of every body by game object id, for saving bodies along with their objects
+		std::unordered_map<id_t, uint32_t> shapesById() const;
+		size_t pairCount() const { return pairs.size(); }
+		size_t contactCount() const { return activeContacts; }
+	private:
+		struct ContactPoint {
+			glm::vec2 position;
+			float separation;
+			// Reference edge, incident edge and which polygon was the reference, stable while the
+			// bodies keep touching the same way, used to find the impulse from the last step
+			uint32_t featureId;
+			float normalImpulse;
+			float tangentImpulse;
+			glm::vec2 rA;
+			glm::vec2 rB;
+			float normalMass;
+			float tangentMass;
+			float bias;
+		};
+
+		struct Manifold {
+			uint32_t a;
+			uint32_t b;
+			glm::vec2 normal;
+			int pointCount;
+			ContactPoint points[2];
+			// Normal mass matrix of a two point manifold, solved as one 2x2 problem when well conditioned
+			float k11;
+			float k12;
+			float k22;
+			bool blockSolve;
+		};
+
+		bool gatherBodies(std::vector<RocketGameObject>& gameObjects);
+		void removeMissingBodies();
+		void updateBounds();
+		void findPairs();
+		bool collide(uint32_t a, uint32_t b, Manifold& manifold) const;
+		float findMaxSeparation(uint32_t a, uint32_t b, int& edge) const;
+		void solveContacts(int iterations, bool useBias);
+		void solveBlock(Manifold& manifold, bool useBias);
+		void step(float dt);
+
+		std::vector<ConvexPolygon> shapes;
+
+		// Body arrays, indexed by body slot
+		std::vector<id_t> bodyIds;
+		std::vector<uint32_t> bodyShapes;
+		std::vector<uint32_t> objectIndices;
+		std::vector<glm::vec2> positions;
+		std::vector<float> rotations;
+		std::vector<glm::vec2> velocities;
+		std::vector<float> angularVelocities;
+		std::vector<float> inverseMasses;
+		std::vector<float> inverseInertias;
+		// Shape vertices transformed to world space, rebuilt every step
+		std::vector<uint32_t> worldVertexStart;
+		std::vector<glm::vec2> worldVertices;
+		std::vector<glm::vec2> worldNormals;
+		// Body slots are the broadphase proxies
+		std::vector<Aabb> bounds;
+		std::unique_ptr<Broadphase> broadphase = Broadphase::create(BroadphaseType::SORT_AND_SWEEP);
+		std::vector<std::pair<uint32_t, uint32_t>> pairs;
+
+		std::vector<Manifold> manifolds;
+		std::unordered_map<uint64_t, uint32_t> previousManifoldIndex;
+		std::vector<Manifold> previousManifolds;
+
+		std::unordered_map<id_t, uint32_t> objectIndexById;
+		size_t activeContacts = 0;
+	};
+}
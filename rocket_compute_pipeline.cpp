@@ -0,0 +1,38 @@
+#include "rocket_compute_pipeline.hpp"
+
+#include <stdexcept>
+
+namespace rocket {
+	RocketComputePipeline::RocketComputePipeline(RocketDevice& device,
+		VkShaderModule computeShaderModule,
+		VkPipelineLayout pipelineLayout,
+		VkPipelineCache pipelineCache) : rocketDevice{ device }
+	{
+		VkPipelineShaderStageCreateInfo stageInfo{};
+		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		stageInfo.module = computeShaderModule;
+		stageInfo.pName = "main";
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = stageInfo;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = -1;
+
+		if (vkCreateComputePipelines(rocketDevice.device(), pipelineCache, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create compute pipeline!");
+		}
+	}
+
+	RocketComputePipeline::~RocketComputePipeline()
+	{
+		vkDestroyPipeline(rocketDevice.device(), computePipeline, nullptr);
+	}
+
+	void RocketComputePipeline::bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	}
+}
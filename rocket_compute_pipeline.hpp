@@ -0,0 +1,26 @@
+#pragma once
+#include "rocket_device.hpp"
+
+#include <cstdint>
+
+namespace rocket {
+	class RocketComputePipeline {
+	public:
+		// The shader module is only needed while linking and may be destroyed once the constructor returns
+		RocketComputePipeline(RocketDevice& device,
+			VkShaderModule computeShaderModule,
+			VkPipelineLayout pipelineLayout,
+			VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		~RocketComputePipeline();
+
+		RocketComputePipeline(const RocketComputePipeline&) = delete;
+		RocketComputePipeline& operator=(const RocketComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+		// Workgroups needed for one invocation per item
+		static uint32_t groupCount(uint32_t itemCount, uint32_t groupSize) { return (itemCount + groupSize - 1) / groupSize; }
+	private:
+		RocketDevice& rocketDevice;
+		VkPipeline computePipeline;
+	};
+}
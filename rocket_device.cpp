@@ -1,6 +1,8 @@
 #include "rocket_device.hpp"
+#include "rocket_shader_cache.hpp"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -56,9 +58,12 @@ namespace rocket {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        shaderCache = std::make_unique<RocketShaderCache>(*this);
     }
 
     RocketDevice::~RocketDevice() {
+        flushDeletions();
+        shaderCache.reset();
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -81,7 +86,7 @@ namespace rocket {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -155,15 +160,41 @@ namespace rocket {
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+        // Vulkan 1.2 features are only chained when the device reports 1.2, otherwise
+        // frame synchronization falls back to fences
+        VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+        supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceVulkan12Features enabledFeatures12{};
+        enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        bool supportsVulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+        if (supportsVulkan12) {
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &supportedFeatures12;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+            timelineSemaphoreSupported = supportedFeatures12.timelineSemaphore == VK_TRUE;
+            enabledFeatures12.timelineSemaphore = supportedFeatures12.timelineSemaphore;
+        }
+        std::cout << "timeline semaphores: " << (timelineSemaphoreSupported ? "supported" : "not supported") << std::endl;
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = supportsVulkan12 ? &enabledFeatures12 : nullptr;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        memoryBudgetSupported = properties.apiVersion >= VK_API_VERSION_1_1 &&
+            isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetSupported) {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -181,6 +212,17 @@ namespace rocket {
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        memoryStats.budgetExtension = memoryBudgetSupported;
+        memoryStats.heaps.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            memoryStats.heaps[i].size = memoryProperties.memoryHeaps[i].size;
+            memoryStats.heaps[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+        heapWarned.assign(memoryProperties.memoryHeapCount, false);
+        queryMemoryBudget();
+        std::cout << "memory budget extension: " << (memoryBudgetSupported ? "supported" : "not supported") << std::endl;
     }
 
     void RocketDevice::createCommandPool() {
@@ -321,6 +363,21 @@ namespace rocket {
         return requiredExtensions.empty();
     }
 
+    bool RocketDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilyIndices RocketDevice::findQueueFamilies(VkPhysicalDevice device) {
         QueueFamilyIndices indices;
 
@@ -413,7 +470,8 @@ namespace rocket {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        VkDeviceMemory& bufferMemory,
+        MemoryCategory category) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -427,12 +485,7 @@ namespace rocket {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        if (allocateMemory(memRequirements, properties, category, bufferMemory) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate vertex buffer memory!");
         }
 
@@ -472,6 +525,32 @@ namespace rocket {
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
 
+    void RocketDevice::submitSingleTimeCommands(VkCommandBuffer commandBuffer, std::function<void()> onComplete) {
+        vkEndCommandBuffer(commandBuffer);
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+            onComplete();
+            throw std::runtime_error("failed to create upload fence!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence) != VK_SUCCESS) {
+            vkDestroyFence(device_, fence, nullptr);
+            vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+            onComplete();
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+        pendingSubmissions.push_back({ fence, commandBuffer, std::move(onComplete) });
+    }
+
     void RocketDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
@@ -515,7 +594,8 @@ namespace rocket {
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) {
+        VkDeviceMemory& imageMemory,
+        MemoryCategory category) {
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -523,17 +603,168 @@ namespace rocket {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
+        if (allocateMemory(memRequirements, properties, category, imageMemory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+
+        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    }
+
+    VkResult RocketDevice::allocateMemory(
+        const VkMemoryRequirements& memRequirements,
+        VkMemoryPropertyFlags properties,
+        MemoryCategory category,
+        VkDeviceMemory& memory) {
         VkMemoryAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         allocInfo.allocationSize = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
+        VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+        if (result != VK_SUCCESS) {
+            return result;
         }
 
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
-            throw std::runtime_error("failed to bind image memory!");
+        std::lock_guard<std::mutex> lock{ memoryMutex };
+        uint32_t heapIndex = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+        allocations[memory] = Allocation{ memRequirements.size, heapIndex, category };
+
+        auto& categoryStats = memoryStats.categories[static_cast<size_t>(category)];
+        categoryStats.bytes += memRequirements.size;
+        categoryStats.peakBytes = std::max(categoryStats.peakBytes, categoryStats.bytes);
+        categoryStats.allocationCount++;
+
+        auto& heapStats = memoryStats.heaps[heapIndex];
+        heapStats.trackedBytes += memRequirements.size;
+        heapStats.peakTrackedBytes = std::max(heapStats.peakTrackedBytes, heapStats.trackedBytes);
+        heapStats.usage += memRequirements.size;
+        heapStats.peakUsage = std::max(heapStats.peakUsage, heapStats.usage);
+        checkMemoryBudget(heapIndex);
+        return result;
+    }
+
+    void RocketDevice::freeMemory(VkDeviceMemory memory) {
+        if (memory == VK_NULL_HANDLE) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{ memoryMutex };
+            auto it = allocations.find(memory);
+            if (it != allocations.end()) {
+                auto& categoryStats = memoryStats.categories[static_cast<size_t>(it->second.category)];
+                categoryStats.bytes -= it->second.size;
+                categoryStats.allocationCount--;
+                auto& heapStats = memoryStats.heaps[it->second.heapIndex];
+                heapStats.trackedBytes -= it->second.size;
+                heapStats.usage -= std::min(heapStats.usage, it->second.size);
+                allocations.erase(it);
+            }
+        }
+        vkFreeMemory(device_, memory, nullptr);
+    }
+
+    MemoryStats RocketDevice::getMemoryStats() {
+        std::lock_guard<std::mutex> lock{ memoryMutex };
+        return memoryStats;
+    }
+
+    void RocketDevice::deferDeletion(std::function<void()> destroyFn) {
+        deletionQueue.emplace_back(recordingFrameValue, std::move(destroyFn));
+    }
+
+    void RocketDevice::retireFrames(uint64_t completedFrame, uint64_t recordingFrame) {
+        // frame values only grow, so the queue is in completion order
+        while (!deletionQueue.empty() && deletionQueue.front().first <= completedFrame) {
+            auto destroyFn = std::move(deletionQueue.front().second);
+            deletionQueue.pop_front();
+            destroyFn();
+        }
+        recordingFrameValue = recordingFrame;
+        while (!pendingSubmissions.empty() && vkGetFenceStatus(device_, pendingSubmissions.front().fence) == VK_SUCCESS) {
+            retireSubmission();
+        }
+
+        std::lock_guard<std::mutex> lock{ memoryMutex };
+        queryMemoryBudget();
+    }
+
+    void RocketDevice::flushDeletions() {
+        if (deletionQueue.empty() && pendingSubmissions.empty()) {
+            return;
+        }
+        vkDeviceWaitIdle(device_);
+        while (!pendingSubmissions.empty()) {
+            retireSubmission();
+        }
+        while (!deletionQueue.empty()) {
+            auto destroyFn = std::move(deletionQueue.front().second);
+            deletionQueue.pop_front();
+            destroyFn();
+        }
+    }
+
+    void RocketDevice::retireSubmission() {
+        PendingSubmission submission = std::move(pendingSubmissions.front());
+        pendingSubmissions.pop_front();
+        vkDestroyFence(device_, submission.fence, nullptr);
+        vkFreeCommandBuffers(device_, commandPool, 1, &submission.commandBuffer);
+        submission.onComplete();
+    }
+
+    const char* RocketDevice::memoryCategoryName(MemoryCategory category) {
+        switch (category) {
+        case MemoryCategory::VERTEX: return "Vertex";
+        case MemoryCategory::INDEX: return "Index";
+        case MemoryCategory::STORAGE: return "Storage";
+        case MemoryCategory::DEPTH: return "Depth";
+        case MemoryCategory::STAGING: return "Staging";
+        default: return "Other";
+        }
+    }
+
+    // Called with memoryMutex held
+    void RocketDevice::queryMemoryBudget() {
+        if (memoryBudgetSupported) {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+            VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+            memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            memoryProperties2.pNext = &budgetProperties;
+            vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+
+            for (size_t i = 0; i < memoryStats.heaps.size(); i++) {
+                memoryStats.heaps[i].budget = budgetProperties.heapBudget[i];
+                memoryStats.heaps[i].usage = budgetProperties.heapUsage[i];
+            }
+        }
+        else {
+            for (auto& heap : memoryStats.heaps) {
+                heap.budget = heap.size;
+                heap.usage = heap.trackedBytes;
+            }
+        }
+        for (auto& heap : memoryStats.heaps) {
+            heap.peakUsage = std::max(heap.peakUsage, heap.usage);
+        }
+    }
+
+    // Called with memoryMutex held, uses the budget of the last query
+    void RocketDevice::checkMemoryBudget(uint32_t heapIndex) {
+        const auto& heap = memoryStats.heaps[heapIndex];
+        if (heap.budget == 0) {
+            return;
+        }
+
+        float usedFraction = static_cast<float>(heap.usage) / static_cast<float>(heap.budget);
+        if (usedFraction > memoryWarningThreshold && !heapWarned[heapIndex]) {
+            std::cerr << "warning: memory heap " << heapIndex << " at " << static_cast<int>(usedFraction * 100.0f)
+                << "% of budget (" << heap.usage / (1024 * 1024) << " MB of " << heap.budget / (1024 * 1024) << " MB)" << std::endl;
+            heapWarned[heapIndex] = true;
+        }
+        else if (usedFraction < memoryWarningThreshold - 0.05f) {
+            heapWarned[heapIndex] = false; // warn again if usage climbs back
         }
     }
 
@@ -3,7 +3,13 @@
 #
 
 // std lib headers
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <imgui_impl_vulkan.h>
 
@@ -18,12 +24,50 @@ static void check_vk_result(VkResult err)
 
 namespace rocket {
 
+    class RocketShaderCache;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    enum class MemoryCategory {
+        VERTEX,
+        INDEX,
+        STORAGE,
+        DEPTH,
+        STAGING,
+        OTHER,
+        COUNT
+    };
+
+    struct MemoryCategoryStats {
+        VkDeviceSize bytes = 0;
+        VkDeviceSize peakBytes = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    struct MemoryHeapStats {
+        VkDeviceSize size = 0;
+        bool deviceLocal = false;
+        // budget and usage come from VK_EXT_memory_budget and include allocations made outside of
+        // RocketDevice (driver, ImGui backend). Without the extension they fall back to heap size and tracked bytes.
+        // They are queried once per frame, usage is the last query adjusted by the tracked
+        // allocations and frees since.
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        VkDeviceSize peakUsage = 0;
+        VkDeviceSize trackedBytes = 0;
+        VkDeviceSize peakTrackedBytes = 0;
+    };
+
+    struct MemoryStats {
+        bool budgetExtension = false;
+        std::vector<MemoryHeapStats> heaps;
+        std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::COUNT)> categories{};
+    };
+
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
@@ -55,6 +99,10 @@ namespace rocket {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        bool supportsTimelineSemaphores() { return timelineSemaphoreSupported; }
+        bool supportsMemoryBudget() { return memoryBudgetSupported; }
+        // Shared by every pipeline created on this device, destroyed before the device
+        RocketShaderCache& getShaderCache() { return *shaderCache; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -68,9 +116,15 @@ namespace rocket {
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory);
+            VkDeviceMemory& bufferMemory,
+            MemoryCategory category = MemoryCategory::OTHER);
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+        // Submits like endSingleTimeCommands but with a fence instead of waiting for the queue. The command
+        // buffer is freed and onComplete runs from retireFrames once the fence has signalled, or from
+        // flushDeletions, or right away if the submission fails. Later submissions to the graphics queue
+        // are ordered after it, record a barrier if they read what it writes.
+        void submitSingleTimeCommands(VkCommandBuffer commandBuffer, std::function<void()> onComplete);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void copyBufferToImage(
             VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -79,7 +133,24 @@ namespace rocket {
             const VkImageCreateInfo& imageInfo,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory);
+            VkDeviceMemory& imageMemory,
+            MemoryCategory category = MemoryCategory::OTHER);
+
+        // Memory allocated by createBuffer/createImageWithInfo must be released here to keep accounting correct
+        void freeMemory(VkDeviceMemory memory);
+        MemoryStats getMemoryStats();
+        static const char* memoryCategoryName(MemoryCategory category);
+
+        // Destruction deferred until the GPU has finished every frame that may use the object. destroyFn runs
+        // once the frame being recorded when it was queued has completed, see RocketSwapChain.
+        void deferDeletion(std::function<void()> destroyFn);
+        // Runs the deletions of frames up to completedFrame, later ones are tagged with recordingFrame.
+        // Also retires finished submitSingleTimeCommands and refreshes the memory budget, once per frame.
+        void retireFrames(uint64_t completedFrame, uint64_t recordingFrame);
+        // Waits for the device and runs every pending deletion and submission, for owners that are shutting down
+        void flushDeletions();
+        // Fraction of a heap's budget above which a warning is printed
+        float memoryWarningThreshold = 0.9f;
 
         void initDeviceImgui(size_t imageCount, ImGui_ImplVulkan_InitInfo& initInfo);
 
@@ -92,6 +163,8 @@ namespace rocket {
         void pickPhysicalDevice();
         void createLogicalDevice();
         void createCommandPool();
+        // Frees the oldest pending submission's fence and command buffer and runs its onComplete
+        void retireSubmission();
 
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
@@ -102,6 +175,14 @@ namespace rocket {
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+        bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
+        VkResult allocateMemory(
+            const VkMemoryRequirements& memRequirements,
+            VkMemoryPropertyFlags properties,
+            MemoryCategory category,
+            VkDeviceMemory& memory);
+        void queryMemoryBudget();
+        void checkMemoryBudget(uint32_t heapIndex);
 
         VkInstance instance;
         VkDebugUtilsMessengerEXT debugMessenger;
@@ -114,6 +195,29 @@ namespace rocket {
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        bool timelineSemaphoreSupported = false;
+        bool memoryBudgetSupported = false;
+
+        struct Allocation {
+            VkDeviceSize size;
+            uint32_t heapIndex;
+            MemoryCategory category;
+        };
+        std::mutex memoryMutex;
+        std::unordered_map<VkDeviceMemory, Allocation> allocations;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        MemoryStats memoryStats;
+        std::vector<bool> heapWarned;
+        std::deque<std::pair<uint64_t, std::function<void()>>> deletionQueue;
+        uint64_t recordingFrameValue = 0;
+        struct PendingSubmission {
+            VkFence fence;
+            VkCommandBuffer commandBuffer;
+            std::function<void()> onComplete;
+        };
+        // In submission order, one queue signals their fences in that order too
+        std::deque<PendingSubmission> pendingSubmissions;
+        std::unique_ptr<RocketShaderCache> shaderCache;
 
 
 
@@ -0,0 +1,68 @@
+#include "rocket_frame_buffers.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rocket {
+	bool reserveFrameBuffer(RocketDevice& device, FrameBuffer& buffer, VkDeviceSize size, VkDeviceSize minSize,
+		VkBufferUsageFlags usage, bool hostVisible)
+	{
+		if (size <= buffer.size) {
+			return false;
+		}
+		VkDeviceSize newSize = std::max({ size, 2 * buffer.size, minSize });
+		destroyFrameBuffer(device, buffer);
+		VkMemoryPropertyFlags properties = hostVisible
+			? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			: VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		device.createBuffer(newSize, usage, properties, buffer.buffer, buffer.memory, MemoryCategory::STORAGE);
+		buffer.size = newSize;
+		if (hostVisible && vkMapMemory(device.device(), buffer.memory, 0, buffer.size, 0, &buffer.mapped) != VK_SUCCESS) {
+			buffer.mapped = nullptr;
+			destroyFrameBuffer(device, buffer);
+			throw std::runtime_error("Failed to map frame buffer memory");
+		}
+		return true;
+	}
+
+	void destroyFrameBuffer(RocketDevice& device, FrameBuffer& buffer)
+	{
+		if (buffer.buffer == VK_NULL_HANDLE) {
+			return;
+		}
+		if (buffer.mapped != nullptr) {
+			vkUnmapMemory(device.device(), buffer.memory);
+		}
+		vkDestroyBuffer(device.device(), buffer.buffer, nullptr);
+		device.freeMemory(buffer.memory);
+		buffer = FrameBuffer{};
+	}
+
+	VkDescriptorPool createFrameDescriptorSets(RocketDevice& device, VkDescriptorSetLayout layout, uint32_t storageBuffers,
+		FrameDescriptorSets& sets)
+	{
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(storageBuffers * sets.size()) };
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = static_cast<uint32_t>(sets.size());
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		VkDescriptorPool descriptorPool;
+		if (vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create frame descriptor pool");
+		}
+
+		std::array<VkDescriptorSetLayout, RocketSwapChain::MAX_FRAMES_IN_FLIGHT> layouts;
+		layouts.fill(layout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		allocInfo.pSetLayouts = layouts.data();
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, sets.data()) != VK_SUCCESS) {
+			vkDestroyDescriptorPool(device.device(), descriptorPool, nullptr);
+			throw std::runtime_error("Failed to allocate frame descriptor sets");
+		}
+		return descriptorPool;
+	}
+}
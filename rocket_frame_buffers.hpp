@@ -0,0 +1,34 @@
+#pragma once
+#include "rocket_device.hpp"
+#include "rocket_swap_chain.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace rocket {
+	// A buffer the render systems rewrite every frame, one per frame in flight. Frames are submitted in
+	// turn, so when a slot comes round again the renderer has already waited for the frame that last read
+	// it, and its buffers can be rewritten or grown in place.
+	struct FrameBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		// Only for host visible buffers, they stay mapped
+		void* mapped = nullptr;
+		VkDeviceSize size = 0;
+	};
+
+	using FrameDescriptorSets = std::array<VkDescriptorSet, RocketSwapChain::MAX_FRAMES_IN_FLIGHT>;
+
+	// Grows buffer to at least size bytes, at least doubling and never below minSize. Returns true if it
+	// was recreated, descriptors pointing at it have to be written again. Throws std::runtime_error if a
+	// host visible buffer can't be mapped.
+	bool reserveFrameBuffer(RocketDevice& device, FrameBuffer& buffer, VkDeviceSize size, VkDeviceSize minSize,
+		VkBufferUsageFlags usage, bool hostVisible);
+	void destroyFrameBuffer(RocketDevice& device, FrameBuffer& buffer);
+
+	// One set of layout per frame in flight, each with storageBuffers storage buffer descriptors. They come
+	// from a pool of their own, so they don't depend on the ImGui pool that is destroyed when run() ends.
+	// Destroying the returned pool frees the sets.
+	VkDescriptorPool createFrameDescriptorSets(RocketDevice& device, VkDescriptorSetLayout layout, uint32_t storageBuffers,
+		FrameDescriptorSets& sets);
+}
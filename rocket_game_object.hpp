@@ -3,31 +3,44 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <memory>	
+#include <cstdint>
 
 namespace rocket {
 	enum class RocketGameObjectType {
 		NONE,
-		PARTICLE
+		PARTICLE,
+		RIGID_BODY
 	};
 
 	struct Transform2dComponent {
 		glm::vec2 translation{};
 		glm::vec2 scale{ 1.f, 1.f };
-		float rotation;
+		float rotation = 0.0f;
+		// Rotation times scale, rebuilt only when rotation or scale differ from the values it was built
+		// from. TransformSystem rebuilds the changed ones in one batch before rendering.
 		glm::mat2 mat2() {
-			const float s = glm::sin(rotation);
-			const float c = glm::cos(rotation);
-			glm::mat2 scaleMat{
-				{scale.x, 0.0f},
-				{ 0.0f, scale.y}
-			};
-			glm::mat2 rotationMat{
-				{c, s},
-				{-s, c}
-			};
-			return rotationMat * scaleMat;
+			if (dirty()) {
+				setMatrix(glm::sin(rotation), glm::cos(rotation));
+			}
+			return matrix;
 		};
 
+		bool dirty() const { return rotation != matrixRotation || scale != matrixScale; }
+		// s and c are the sine and cosine of rotation
+		void setMatrix(float s, float c) {
+			matrix = glm::mat2{
+				{ c * scale.x, s * scale.x },
+				{ -s * scale.y, c * scale.y }
+			};
+			matrixRotation = rotation;
+			matrixScale = scale;
+		}
+
+	private:
+		// Matches the defaults above, so untouched transforms never need any trigonometry
+		glm::mat2 matrix{ 1.0f };
+		float matrixRotation = 0.0f;
+		glm::vec2 matrixScale{ 1.f, 1.f };
 	};
 
 	class RocketGameObject {
@@ -54,11 +67,26 @@ namespace rocket {
 		Transform2dComponent transform2d{};
 		bool gravityApplied = false;
 		bool collisionApplied = false;
+		// Integrated only by ConstraintSolver, which undoes PhysicsSystem's step for the object (holdParticles)
+		bool constraintsApplied = false;
+		// Set by SleepSystem for settled objects, simulation systems skip integrating and colliding them
+		bool sleeping = false;
 		float radius = 0.0f;
 		RocketGameObjectType type = RocketGameObjectType::NONE;
 		float mass = 0.0f;
 		glm::vec2 velocity = glm::zero<glm::vec2>();
 		glm::vec2 acceleration = glm::zero<glm::vec2>();
+		float angularVelocity = 0.0f;
+		// Set for particles pooled by an EmitterSystem emitter: seconds since spawn, how long they live
+		// and the emitter's id (NO_EMITTER for everything else, ORPHAN_EMITTER once the emitter is gone)
+		static constexpr uint32_t NO_EMITTER = UINT32_MAX;
+		static constexpr uint32_t ORPHAN_EMITTER = UINT32_MAX - 1;
+		float age = 0.0f;
+		float lifetime = 0.0f;
+		uint32_t emitter = NO_EMITTER;
+
+		// A pooled emitter slot with no live particle in it
+		bool parked() const { return emitter != NO_EMITTER && type == RocketGameObjectType::NONE; }
 
 	private:
 		RocketGameObject(id_t objId) : id{ objId } {}
@@ -0,0 +1,332 @@
+#include "rocket_geometry_arena.hpp"
+#include "rocket_model.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace rocket {
+	static constexpr VkDeviceSize VERTEX_SIZE = sizeof(RocketModel::Vertex);
+	static constexpr VkDeviceSize INDEX_SIZE = sizeof(uint32_t);
+
+	// Uploads are not waited for, later submissions on the queue see the copies through this barrier:
+	// frames drawing from the arena and relocations copying out of it
+	static void recordCopyBarrier(VkCommandBuffer commandBuffer)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	RangeAllocator::RangeAllocator(uint32_t capacity)
+	{
+		reset(capacity, 0);
+	}
+
+	uint32_t RangeAllocator::allocate(uint32_t count)
+	{
+		if (count == 0) {
+			return 0;
+		}
+		for (size_t i = 0; i < ranges.size(); i++) {
+			Range& range = ranges[i];
+			if (range.count < count) {
+				continue;
+			}
+			uint32_t offset = range.offset;
+			range.offset += count;
+			range.count -= count;
+			if (range.count == 0) {
+				ranges.erase(ranges.begin() + i);
+			}
+			usedCount += count;
+			return offset;
+		}
+		return INVALID_OFFSET;
+	}
+
+	void RangeAllocator::free(uint32_t offset, uint32_t count)
+	{
+		if (count == 0) {
+			return;
+		}
+		assert(offset + count <= capacityCount && "Freed range is outside the allocator");
+		auto next = std::lower_bound(ranges.begin(), ranges.end(), offset,
+			[](const Range& range, uint32_t value) { return range.offset < value; });
+		assert((next == ranges.end() || offset + count <= next->offset) && "Freed range overlaps free space");
+		bool joinsPrevious = next != ranges.begin() && (next - 1)->offset + (next - 1)->count == offset;
+		bool joinsNext = next != ranges.end() && offset + count == next->offset;
+		if (joinsPrevious && joinsNext) {
+			(next - 1)->count += count + next->count;
+			ranges.erase(next);
+		}
+		else if (joinsPrevious) {
+			(next - 1)->count += count;
+		}
+		else if (joinsNext) {
+			next->offset = offset;
+			next->count += count;
+		}
+		else {
+			ranges.insert(next, { offset, count });
+		}
+		usedCount -= count;
+	}
+
+	void RangeAllocator::reset(uint32_t newCapacity, uint32_t used)
+	{
+		assert(used <= newCapacity && "More in use than the capacity");
+		capacityCount = newCapacity;
+		usedCount = used;
+		ranges.clear();
+		if (used < newCapacity) {
+			ranges.push_back({ used, newCapacity - used });
+		}
+	}
+
+	size_t RangeAllocator::gaps() const
+	{
+		bool freeTail = !ranges.empty() && ranges.back().offset + ranges.back().count == capacityCount;
+		return ranges.size() - (freeTail ? 1 : 0);
+	}
+
+	RocketGeometryArena::RocketGeometryArena(RocketDevice& device, uint32_t vertexCapacity, uint32_t indexCapacity)
+		: rocketDevice{ device }, vertexRanges{ vertexCapacity }, indexRanges{ indexCapacity }
+	{
+		createBuffers(vertexCapacity, indexCapacity, vertexBuffer, vertexMemory, indexBuffer, indexMemory);
+	}
+
+	RocketGeometryArena::~RocketGeometryArena()
+	{
+		// Pending releases refer to this arena, run them while it still exists
+		rocketDevice.flushDeletions();
+		vkDestroyBuffer(rocketDevice.device(), vertexBuffer, nullptr);
+		rocketDevice.freeMemory(vertexMemory);
+		vkDestroyBuffer(rocketDevice.device(), indexBuffer, nullptr);
+		rocketDevice.freeMemory(indexMemory);
+	}
+
+	void RocketGeometryArena::createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, VkBuffer& newVertexBuffer, VkDeviceMemory& newVertexMemory,
+		VkBuffer& newIndexBuffer, VkDeviceMemory& newIndexMemory)
+	{
+		// Transfer source as well, relocate() copies out of the old buffers
+		rocketDevice.createBuffer(VERTEX_SIZE * std::max(vertexCapacity, 1u),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			newVertexBuffer,
+			newVertexMemory,
+			MemoryCategory::VERTEX);
+		rocketDevice.createBuffer(INDEX_SIZE * std::max(indexCapacity, 1u),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			newIndexBuffer,
+			newIndexMemory,
+			MemoryCategory::INDEX);
+	}
+
+	GeometryHandle RocketGeometryArena::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+	{
+		uint32_t firstVertex = vertexRanges.allocate(vertexCount);
+		uint32_t firstIndex = indexRanges.allocate(indexCount);
+		if (firstVertex == RangeAllocator::INVALID_OFFSET || firstIndex == RangeAllocator::INVALID_OFFSET) {
+			if (firstVertex != RangeAllocator::INVALID_OFFSET) {
+				vertexRanges.free(firstVertex, vertexCount);
+			}
+			if (firstIndex != RangeAllocator::INVALID_OFFSET) {
+				indexRanges.free(firstIndex, indexCount);
+			}
+			// Packing the live ranges leaves the free space in one piece at the end, growing geometrically keeps
+			// the number of relocations logarithmic in the final size
+			uint32_t newVertexCapacity = std::max(vertexRanges.capacity(), vertexRanges.used() + vertexCount);
+			uint32_t newIndexCapacity = std::max(indexRanges.capacity(), indexRanges.used() + indexCount);
+			if (newVertexCapacity > vertexRanges.capacity()) {
+				newVertexCapacity = std::max(newVertexCapacity, 2 * vertexRanges.capacity());
+			}
+			if (newIndexCapacity > indexRanges.capacity()) {
+				newIndexCapacity = std::max(newIndexCapacity, 2 * indexRanges.capacity());
+			}
+			relocate(newVertexCapacity, newIndexCapacity);
+			firstVertex = vertexRanges.allocate(vertexCount);
+			firstIndex = indexRanges.allocate(indexCount);
+			assert(firstVertex != RangeAllocator::INVALID_OFFSET && firstIndex != RangeAllocator::INVALID_OFFSET && "Relocation left too little space");
+		}
+
+		GeometryHandle handle;
+		if (freeHandles.empty()) {
+			handle = static_cast<GeometryHandle>(allocations.size());
+			allocations.emplace_back();
+		}
+		else {
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		allocations[handle].range = { firstVertex, vertexCount, firstIndex, indexCount };
+		allocations[handle].live = true;
+
+		VkDeviceSize vertexBytes = VERTEX_SIZE * vertexCount;
+		VkDeviceSize indexBytes = INDEX_SIZE * indexCount;
+		if (vertexBytes + indexBytes == 0) {
+			return handle;
+		}
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingMemory;
+		rocketDevice.createBuffer(vertexBytes + indexBytes,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer,
+			stagingMemory,
+			MemoryCategory::STAGING);
+		void* data;
+		if (vkMapMemory(rocketDevice.device(), stagingMemory, 0, vertexBytes + indexBytes, 0, &data) != VK_SUCCESS) {
+			vkDestroyBuffer(rocketDevice.device(), stagingBuffer, nullptr);
+			rocketDevice.freeMemory(stagingMemory);
+			free(handle);
+			throw std::runtime_error("Failed to map geometry staging memory");
+		}
+		if (vertexBytes > 0) {
+			std::memcpy(data, vertices, static_cast<size_t>(vertexBytes));
+		}
+		if (indexBytes > 0) {
+			std::memcpy(static_cast<char*>(data) + vertexBytes, indices, static_cast<size_t>(indexBytes));
+		}
+		vkUnmapMemory(rocketDevice.device(), stagingMemory);
+
+		// The range is either fresh or was released after every frame that drew from it, no need to wait
+		VkCommandBuffer commandBuffer = rocketDevice.beginSingleTimeCommands();
+		if (vertexBytes > 0) {
+			VkBufferCopy vertexCopy{ 0, VERTEX_SIZE * firstVertex, vertexBytes };
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, vertexBuffer, 1, &vertexCopy);
+		}
+		if (indexBytes > 0) {
+			VkBufferCopy indexCopy{ vertexBytes, INDEX_SIZE * firstIndex, indexBytes };
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &indexCopy);
+		}
+		recordCopyBarrier(commandBuffer);
+		rocketDevice.submitSingleTimeCommands(commandBuffer, [&device = rocketDevice, stagingBuffer, stagingMemory]() {
+			vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
+			device.freeMemory(stagingMemory);
+		});
+		return handle;
+	}
+
+	void RocketGeometryArena::free(GeometryHandle handle)
+	{
+		assert(handle < allocations.size() && allocations[handle].live && "Freeing a geometry handle that is not allocated");
+		allocations[handle].live = false;
+		size_t relocation = relocationCount;
+		rocketDevice.deferDeletion([this, handle, relocation]() { release(handle, relocation); });
+	}
+
+	void RocketGeometryArena::release(GeometryHandle handle, size_t relocation)
+	{
+		Allocation& allocation = allocations[handle];
+		// A relocation since free() only kept the live ranges, this one's space is free already
+		if (relocation == relocationCount) {
+			vertexRanges.free(allocation.range.firstVertex, allocation.range.vertexCount);
+			indexRanges.free(allocation.range.firstIndex, allocation.range.indexCount);
+		}
+		allocation = Allocation{};
+		freeHandles.push_back(handle);
+	}
+
+	void RocketGeometryArena::bind(VkCommandBuffer commandBuffer)
+	{
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void RocketGeometryArena::compact()
+	{
+		if (gaps() == 0) {
+			return;
+		}
+		relocate(vertexRanges.capacity(), indexRanges.capacity());
+	}
+
+	void RocketGeometryArena::relocate(uint32_t newVertexCapacity, uint32_t newIndexCapacity)
+	{
+		VkBuffer newVertexBuffer;
+		VkDeviceMemory newVertexMemory;
+		VkBuffer newIndexBuffer;
+		VkDeviceMemory newIndexMemory;
+		createBuffers(newVertexCapacity, newIndexCapacity, newVertexBuffer, newVertexMemory, newIndexBuffer, newIndexMemory);
+
+		// Live allocations in vertex order keep their relative placement, neighbours merge into one copy
+		std::vector<GeometryHandle> order;
+		for (GeometryHandle handle = 0; handle < allocations.size(); handle++) {
+			if (allocations[handle].live) {
+				order.push_back(handle);
+			}
+		}
+		std::vector<VkBufferCopy> vertexCopies;
+		std::vector<VkBufferCopy> indexCopies;
+		auto addCopy = [](std::vector<VkBufferCopy>& copies, VkDeviceSize src, VkDeviceSize dst, VkDeviceSize size) {
+			if (size == 0) {
+				return;
+			}
+			if (!copies.empty() && copies.back().srcOffset + copies.back().size == src && copies.back().dstOffset + copies.back().size == dst) {
+				copies.back().size += size;
+				return;
+			}
+			copies.push_back({ src, dst, size });
+		};
+
+		std::sort(order.begin(), order.end(), [&](GeometryHandle a, GeometryHandle b) {
+			return allocations[a].range.firstVertex < allocations[b].range.firstVertex;
+		});
+		uint32_t packedVertices = 0;
+		for (GeometryHandle handle : order) {
+			GeometryRange& range = allocations[handle].range;
+			addCopy(vertexCopies, VERTEX_SIZE * range.firstVertex, VERTEX_SIZE * packedVertices, VERTEX_SIZE * range.vertexCount);
+			range.firstVertex = range.vertexCount > 0 ? packedVertices : 0;
+			packedVertices += range.vertexCount;
+		}
+		std::sort(order.begin(), order.end(), [&](GeometryHandle a, GeometryHandle b) {
+			return allocations[a].range.firstIndex < allocations[b].range.firstIndex;
+		});
+		uint32_t packedIndices = 0;
+		for (GeometryHandle handle : order) {
+			GeometryRange& range = allocations[handle].range;
+			addCopy(indexCopies, INDEX_SIZE * range.firstIndex, INDEX_SIZE * packedIndices, INDEX_SIZE * range.indexCount);
+			range.firstIndex = range.indexCount > 0 ? packedIndices : 0;
+			packedIndices += range.indexCount;
+		}
+
+		auto destroyOldBuffers = [&device = rocketDevice, vertexBuffer = vertexBuffer, vertexMemory = vertexMemory,
+			indexBuffer = indexBuffer, indexMemory = indexMemory]() {
+			vkDestroyBuffer(device.device(), vertexBuffer, nullptr);
+			device.freeMemory(vertexMemory);
+			vkDestroyBuffer(device.device(), indexBuffer, nullptr);
+			device.freeMemory(indexMemory);
+		};
+		if (!vertexCopies.empty() || !indexCopies.empty()) {
+			VkCommandBuffer commandBuffer = rocketDevice.beginSingleTimeCommands();
+			if (!vertexCopies.empty()) {
+				vkCmdCopyBuffer(commandBuffer, vertexBuffer, newVertexBuffer, static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+			}
+			if (!indexCopies.empty()) {
+				vkCmdCopyBuffer(commandBuffer, indexBuffer, newIndexBuffer, static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+			}
+			recordCopyBarrier(commandBuffer);
+			// The fence of a submission also covers everything submitted before it, so once the copy is done
+			// the frames in flight that read the old buffers are too
+			rocketDevice.submitSingleTimeCommands(commandBuffer, destroyOldBuffers);
+		}
+		else {
+			// Frames in flight may still read the old buffers
+			rocketDevice.deferDeletion(destroyOldBuffers);
+		}
+		vertexBuffer = newVertexBuffer;
+		vertexMemory = newVertexMemory;
+		indexBuffer = newIndexBuffer;
+		indexMemory = newIndexMemory;
+		vertexRanges.reset(newVertexCapacity, packedVertices);
+		indexRanges.reset(newIndexCapacity, packedIndices);
+		relocationCount++;
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "rocket_device.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// First fit allocator over [0, capacity) in elements, it only does the bookkeeping. Free ranges are kept
+	// sorted by offset and merged with their neighbours when freed.
+	class RangeAllocator {
+	public:
+		static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+		RangeAllocator(uint32_t capacity = 0);
+
+		// INVALID_OFFSET when no free range is large enough. A count of zero gets offset 0 and takes nothing.
+		uint32_t allocate(uint32_t count);
+		void free(uint32_t offset, uint32_t count);
+		// State after the allocations were packed to the front: [0, used) taken, the rest free
+		void reset(uint32_t newCapacity, uint32_t used);
+
+		uint32_t capacity() const { return capacityCount; }
+		uint32_t used() const { return usedCount; }
+		// Free ranges with allocations after them, the ones packing to the front closes
+		size_t gaps() const;
+	private:
+		struct Range {
+			uint32_t offset;
+			uint32_t count;
+		};
+
+		std::vector<Range> ranges;
+		uint32_t capacityCount = 0;
+		uint32_t usedCount = 0;
+	};
+
+	// Where an allocation lives in the arena, in vertices and indices. Indices are relative to firstVertex,
+	// which goes into the draw's vertexOffset.
+	struct GeometryRange {
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+	};
+
+	using GeometryHandle = uint32_t;
+
+	// One device local vertex buffer and one index buffer shared by every model. Models hold a handle to a
+	// range of both, so a frame binds the arena once and only changes firstIndex and vertexOffset between
+	// draws. Freed ranges are reused by later allocations; compact() packs the live ranges to the front.
+	// An allocation that does not fit grows the buffers, moving the live ranges the same way as compact().
+	// Handles stay valid across growth and compaction, look ranges up at draw time instead of keeping them.
+	// Uploads and relocation copies are submitted with RocketDevice::submitSingleTimeCommands, which
+	// doesn't wait for the queue; staging and replaced buffers are destroyed once their copy's fence has
+	// signalled. Freed ranges go through RocketDevice::deferDeletion, so nothing a frame in flight draws
+	// from is overwritten or destroyed. The arena itself never waits for the GPU.
+	class RocketGeometryArena {
+	public:
+		static constexpr GeometryHandle INVALID_HANDLE = UINT32_MAX;
+
+		RocketGeometryArena(RocketDevice& device, uint32_t vertexCapacity = 1 << 16, uint32_t indexCapacity = 1 << 18);
+		~RocketGeometryArena();
+
+		RocketGeometryArena(const RocketGeometryArena&) = delete;
+		RocketGeometryArena& operator=(const RocketGeometryArena&) = delete;
+
+		// Copies vertexCount RocketModel::Vertex and indexCount indices into the arena with one staged upload.
+		// Not while a frame is being recorded, growing the buffers replaces the ones it has bound.
+		GeometryHandle allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+		// The range is handed out again once the frames that may still draw from it have finished
+		void free(GeometryHandle handle);
+		const GeometryRange& range(GeometryHandle handle) const { return allocations[handle].range; }
+
+		// Binds the vertex and index buffer, once per command buffer is enough for every model
+		void bind(VkCommandBuffer commandBuffer);
+
+		// Moves every live range to the front of new buffers of the same capacity. Same rules as allocate.
+		void compact();
+
+		uint32_t vertexCapacity() const { return vertexRanges.capacity(); }
+		uint32_t vertexCount() const { return vertexRanges.used(); }
+		uint32_t indexCapacity() const { return indexRanges.capacity(); }
+		uint32_t indexCount() const { return indexRanges.used(); }
+		size_t allocationCount() const { return allocations.size() - freeHandles.size(); }
+		// Free ranges between allocations in both buffers, compact() closes them
+		size_t gaps() const { return vertexRanges.gaps() + indexRanges.gaps(); }
+		size_t relocations() const { return relocationCount; }
+	private:
+		struct Allocation {
+			GeometryRange range;
+			bool live = false;
+		};
+
+		void createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, VkBuffer& vertexBuffer, VkDeviceMemory& vertexMemory,
+			VkBuffer& indexBuffer, VkDeviceMemory& indexMemory);
+		// Copies the live ranges packed into buffers of the new capacities and replaces the old buffers
+		void relocate(uint32_t newVertexCapacity, uint32_t newIndexCapacity);
+		// Deferred end of free(), relocation is relocationCount when the handle was freed
+		void release(GeometryHandle handle, size_t relocation);
+
+		RocketDevice& rocketDevice;
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+		RangeAllocator vertexRanges;
+		RangeAllocator indexRanges;
+		std::vector<Allocation> allocations;
+		std::vector<GeometryHandle> freeHandles;
+		size_t relocationCount = 0;
+	};
+}
@@ -0,0 +1,103 @@
+#include "rocket_mapped_file.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rocket {
+#ifdef _WIN32
+	RocketMappedFile::RocketMappedFile(const std::string& filepath)
+	{
+		fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			fileHandle = nullptr;
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+
+		LARGE_INTEGER size;
+		GetFileSizeEx(fileHandle, &size);
+		fileSize = static_cast<size_t>(size.QuadPart);
+		if (fileSize == 0) {
+			return; // Empty files cannot be mapped
+		}
+
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle != nullptr) {
+			mappedData = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (mappedData == nullptr) {
+			if (mappingHandle != nullptr) {
+				CloseHandle(mappingHandle);
+				mappingHandle = nullptr;
+			}
+			CloseHandle(fileHandle);
+			fileHandle = nullptr;
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+	}
+
+	RocketMappedFile::~RocketMappedFile()
+	{
+		if (mappedData != nullptr) {
+			UnmapViewOfFile(mappedData);
+			mappedData = nullptr;
+		}
+		if (mappingHandle != nullptr) {
+			CloseHandle(mappingHandle);
+			mappingHandle = nullptr;
+		}
+		if (fileHandle != nullptr) {
+			CloseHandle(fileHandle);
+			fileHandle = nullptr;
+		}
+	}
+#else
+	RocketMappedFile::RocketMappedFile(const std::string& filepath)
+	{
+		fileDescriptor = open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0) {
+			close(fileDescriptor);
+			fileDescriptor = -1;
+			throw std::runtime_error("Failed to read file size: " + filepath);
+		}
+		fileSize = static_cast<size_t>(fileStat.st_size);
+		if (fileSize == 0) {
+			return; // Empty files cannot be mapped
+		}
+
+		void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED) {
+			close(fileDescriptor);
+			fileDescriptor = -1;
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+		mappedData = static_cast<const char*>(mapping);
+	}
+
+	RocketMappedFile::~RocketMappedFile()
+	{
+		if (mappedData != nullptr) {
+			munmap(const_cast<char*>(mappedData), fileSize);
+			mappedData = nullptr;
+		}
+		if (fileDescriptor >= 0) {
+			close(fileDescriptor);
+			fileDescriptor = -1;
+		}
+	}
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace rocket {
+	// Read only memory mapping of a whole file. The contents are paged in on first access
+	// instead of being copied into a buffer.
+	class RocketMappedFile {
+	public:
+		RocketMappedFile(const std::string& filepath);
+		~RocketMappedFile();
+
+		RocketMappedFile(const RocketMappedFile&) = delete;
+		RocketMappedFile& operator=(const RocketMappedFile&) = delete;
+
+		const char* data() const { return mappedData; }
+		size_t size() const { return fileSize; }
+	private:
+		const char* mappedData = nullptr;
+		size_t fileSize = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+}
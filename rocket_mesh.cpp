@@ -0,0 +1,275 @@
+#include "rocket_mesh.hpp"
+#include "rocket_utils.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rocket {
+	static const char MESH_MAGIC[8] = { 'R', 'K', 'T', 'M', 'E', 'S', 'H', '\0' };
+
+	namespace {
+		// Cursor over one line of the source, the mapped text is not null terminated
+		struct ObjLine {
+			const char* position;
+			const char* end;
+
+			void skipSpaces()
+			{
+				while (position < end && (*position == ' ' || *position == '\t')) {
+					position++;
+				}
+			}
+
+			bool readFloat(float& value)
+			{
+				skipSpaces();
+				auto result = std::from_chars(position, end, value);
+				if (result.ec != std::errc()) {
+					return false;
+				}
+				position = result.ptr;
+				return true;
+			}
+
+			// Next whitespace separated token, empty at the end of the line
+			std::pair<const char*, const char*> readToken()
+			{
+				skipSpaces();
+				const char* start = position;
+				while (position < end && *position != ' ' && *position != '\t') {
+					position++;
+				}
+				return { start, position };
+			}
+		};
+
+		struct VertexKey {
+			RocketModel::Vertex vertex;
+
+			bool operator==(const VertexKey& other) const { return std::memcmp(&vertex, &other.vertex, sizeof(vertex)) == 0; }
+		};
+
+		struct VertexKeyHash {
+			size_t operator()(const VertexKey& key) const { return static_cast<size_t>(hashBytes(&key.vertex, sizeof(key.vertex))); }
+		};
+	}
+
+	MeshData parseObj(const char* text, size_t size, const std::string& name)
+	{
+		std::vector<RocketModel::Vertex> positions;
+		// OBJ position index to output vertex, filled on first use so unused positions are dropped
+		std::vector<uint32_t> remap;
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> uniqueVertices;
+		std::vector<uint32_t> face;
+		MeshData mesh;
+
+		const char* end = text + size;
+		size_t lineNumber = 0;
+		for (const char* lineStart = text; lineStart < end;) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart));
+			if (lineEnd == nullptr) {
+				lineEnd = end;
+			}
+			ObjLine line{ lineStart, lineEnd > lineStart && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd };
+			lineStart = lineEnd + 1;
+			lineNumber++;
+
+			auto keyword = line.readToken();
+			size_t keywordLength = keyword.second - keyword.first;
+			if (keywordLength == 1 && keyword.first[0] == 'v') {
+				float values[6];
+				int count = 0;
+				while (count < 6 && line.readFloat(values[count])) {
+					count++;
+				}
+				if (count < 3) {
+					throw std::runtime_error("Invalid vertex in " + name + " line " + std::to_string(lineNumber));
+				}
+				// x y z w has no colour, x y z r g b does
+				glm::vec3 color = count == 6 ? glm::vec3(values[3], values[4], values[5]) : glm::vec3(1.0f);
+				// 0 - y rather than -y, so a zero stays +0 and merges with other zeros
+				positions.push_back({ { values[0], 0.0f - values[1] }, color });
+				remap.push_back(UINT32_MAX);
+			}
+			else if (keywordLength == 1 && keyword.first[0] == 'f') {
+				face.clear();
+				for (auto token = line.readToken(); token.first != token.second; token = line.readToken()) {
+					// v, v/vt, v//vn or v/vt/vn, only the position index matters
+					long index = 0;
+					auto result = std::from_chars(token.first, token.second, index);
+					if (result.ec != std::errc() || index == 0) {
+						throw std::runtime_error("Invalid face in " + name + " line " + std::to_string(lineNumber));
+					}
+					// Negative indices count back from the latest vertex
+					long position = index > 0 ? index - 1 : static_cast<long>(positions.size()) + index;
+					if (position < 0 || position >= static_cast<long>(positions.size())) {
+						throw std::runtime_error("Face index out of range in " + name + " line " + std::to_string(lineNumber));
+					}
+					uint32_t& vertexIndex = remap[position];
+					if (vertexIndex == UINT32_MAX) {
+						auto inserted = uniqueVertices.emplace(VertexKey{ positions[position] }, static_cast<uint32_t>(mesh.vertices.size()));
+						if (inserted.second) {
+							mesh.vertices.push_back(positions[position]);
+						}
+						vertexIndex = inserted.first->second;
+					}
+					face.push_back(vertexIndex);
+				}
+				if (face.size() < 3) {
+					throw std::runtime_error("Face with less than 3 vertices in " + name + " line " + std::to_string(lineNumber));
+				}
+				for (size_t i = 1; i + 1 < face.size(); i++) {
+					mesh.indices.insert(mesh.indices.end(), { face[0], face[i], face[i + 1] });
+				}
+			}
+			// Normals, texture coordinates, groups and materials do not apply to flat coloured 2D models
+		}
+		if (mesh.indices.empty()) {
+			throw std::runtime_error("No faces in " + name);
+		}
+
+		mesh.boundsMin = mesh.boundsMax = mesh.vertices[0].position;
+		for (const auto& vertex : mesh.vertices) {
+			mesh.boundsMin = glm::min(mesh.boundsMin, vertex.position);
+			mesh.boundsMax = glm::max(mesh.boundsMax, vertex.position);
+			mesh.boundingRadius = std::max(mesh.boundingRadius, glm::length(vertex.position));
+		}
+		return mesh;
+	}
+
+	void writeMeshFile(const std::string& filepath, const MeshData& mesh, uint64_t sourceHash, uint64_t sourceSize)
+	{
+		MeshHeader header{};
+		std::memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+		header.version = MESH_VERSION;
+		header.headerSize = sizeof(MeshHeader);
+		header.vertexSize = sizeof(RocketModel::Vertex);
+		header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		header.boundingRadius = mesh.boundingRadius;
+		header.boundsMin[0] = mesh.boundsMin.x;
+		header.boundsMin[1] = mesh.boundsMin.y;
+		header.boundsMax[0] = mesh.boundsMax.x;
+		header.boundsMax[1] = mesh.boundsMax.y;
+		header.vertexOffset = sizeof(MeshHeader);
+		header.indexOffset = header.vertexOffset + sizeof(RocketModel::Vertex) * mesh.vertices.size();
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceSize;
+
+		// Written next to the target and renamed over it, a load never maps a partial file
+		std::string tempPath = filepath + ".tmp";
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(mesh.vertices.data()), sizeof(RocketModel::Vertex) * mesh.vertices.size());
+			file.write(reinterpret_cast<const char*>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+			file.close();
+			if (!file) {
+				std::error_code removeError;
+				std::filesystem::remove(tempPath, removeError);
+				throw std::runtime_error("Failed to write mesh file: " + tempPath);
+			}
+		}
+		std::error_code renameError;
+		std::filesystem::rename(tempPath, filepath, renameError);
+		if (renameError) {
+			std::error_code removeError;
+			std::filesystem::remove(tempPath, removeError);
+			throw std::runtime_error("Failed to replace " + filepath + ": " + renameError.message());
+		}
+	}
+
+	RocketMeshFile::RocketMeshFile(const std::string& filepath) : file{ filepath }
+	{
+		if (file.size() < sizeof(MeshHeader)) {
+			throw std::runtime_error("Not a mesh file: " + filepath);
+		}
+		header = reinterpret_cast<const MeshHeader*>(file.data());
+		if (std::memcmp(header->magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0) {
+			throw std::runtime_error("Not a mesh file: " + filepath);
+		}
+		if (header->version != MESH_VERSION || header->headerSize != sizeof(MeshHeader) || header->vertexSize != sizeof(RocketModel::Vertex)) {
+			throw std::runtime_error("Unsupported mesh version " + std::to_string(header->version) + " in " + filepath);
+		}
+		if (header->vertexOffset % alignof(RocketModel::Vertex) != 0 || header->indexOffset % alignof(uint32_t) != 0 ||
+			header->vertexOffset > file.size() || header->indexOffset > file.size() ||
+			header->vertexCount > (file.size() - header->vertexOffset) / sizeof(RocketModel::Vertex) ||
+			header->indexCount > (file.size() - header->indexOffset) / sizeof(uint32_t)) {
+			throw std::runtime_error("Truncated mesh file: " + filepath);
+		}
+		// Mapped memory is page aligned, so the arrays are as aligned as their offsets
+		vertexData = reinterpret_cast<const RocketModel::Vertex*>(file.data() + header->vertexOffset);
+		indexData = reinterpret_cast<const uint32_t*>(file.data() + header->indexOffset);
+		// An index past the vertices would read another model's range of the arena
+		uint32_t largestIndex = 0;
+		for (uint32_t i = 0; i < header->indexCount; i++) {
+			largestIndex = std::max(largestIndex, indexData[i]);
+		}
+		if (header->vertexCount < 3 || header->indexCount < 3 || header->indexCount % 3 != 0 || largestIndex >= header->vertexCount) {
+			throw std::runtime_error("Corrupt mesh file: " + filepath);
+		}
+	}
+
+	std::string cookedMeshPath(const std::string& sourcePath)
+	{
+		return sourcePath + ".rmesh";
+	}
+
+	void cookMesh(const std::string& sourcePath)
+	{
+		RocketMappedFile source{ sourcePath };
+		MeshData mesh = parseObj(source.data(), source.size(), sourcePath);
+		writeMeshFile(cookedMeshPath(sourcePath), mesh, hashBytes(source.data(), source.size()), source.size());
+	}
+
+	std::shared_ptr<RocketModel> loadMesh(RocketGeometryArena& arena, const std::string& sourcePath, MeshLoadInfo* info)
+	{
+		auto start = std::chrono::steady_clock::now();
+		RocketMappedFile source{ sourcePath };
+		uint64_t sourceHash = hashBytes(source.data(), source.size());
+		std::string cookedPath = cookedMeshPath(sourcePath);
+
+		std::shared_ptr<RocketModel> model;
+		bool cached = false;
+		std::error_code existsError;
+		if (std::filesystem::exists(cookedPath, existsError)) {
+			try {
+				RocketMeshFile cooked{ cookedPath };
+				if (cooked.cookedFrom(sourceHash, source.size())) {
+					const MeshHeader& header = cooked.getHeader();
+					model = std::make_shared<RocketModel>(arena, cooked.vertices(), header.vertexCount, cooked.indices(), header.indexCount, header.boundingRadius);
+					cached = true;
+				}
+			}
+			catch (const std::runtime_error&) {
+				// Unreadable or from an older version, cooked again below
+			}
+		}
+		if (model == nullptr) {
+			MeshData mesh = parseObj(source.data(), source.size(), sourcePath);
+			try {
+				writeMeshFile(cookedPath, mesh, sourceHash, source.size());
+			}
+			catch (const std::runtime_error& e) {
+				std::cerr << e.what() << std::endl;
+			}
+			model = std::make_shared<RocketModel>(arena, mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()),
+				mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()), mesh.boundingRadius);
+		}
+
+		if (info != nullptr) {
+			info->cached = cached;
+			info->vertexCount = model->getVertexCount();
+			info->indexCount = model->getIndexCount();
+			info->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return model;
+	}
+}
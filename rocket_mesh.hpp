@@ -0,0 +1,90 @@
+#pragma once
+#include "rocket_geometry_arena.hpp"
+#include "rocket_mapped_file.hpp"
+#include "rocket_model.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rocket {
+	// Cooked mesh file: a 80 byte header, the vertices as RocketModel::Vertex and then the indices, little
+	// endian. Everything is ready for upload, so a mapped file goes to the arena without any parsing.
+	// Bump MESH_VERSION whenever the header or RocketModel::Vertex changes.
+	static constexpr uint32_t MESH_VERSION = 1;
+
+	struct MeshHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t vertexSize;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		float boundingRadius;
+		float boundsMin[2];
+		float boundsMax[2];
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		// FNV-1a and size of the source file the mesh was cooked from, a mismatch means it is stale
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+	};
+
+	static_assert(sizeof(MeshHeader) == 80, "mesh header layout changed, bump MESH_VERSION");
+	static_assert(sizeof(RocketModel::Vertex) == 20, "vertex layout changed, bump MESH_VERSION");
+	static_assert(std::is_trivially_copyable<RocketModel::Vertex>::value, "mesh vertices are copied as bytes");
+
+	struct MeshData {
+		std::vector<RocketModel::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		float boundingRadius = 0.0f;
+		glm::vec2 boundsMin{ 0.0f };
+		glm::vec2 boundsMax{ 0.0f };
+	};
+
+	// Triangles of a Wavefront OBJ. Only positions are used, x and y with y negated (OBJ y points up,
+	// ours down), plus vertex colours when a v line has six values; faces are fanned into triangles.
+	// Identical vertices are merged. Throws std::runtime_error for malformed files, name is for messages.
+	MeshData parseObj(const char* text, size_t size, const std::string& name);
+	void writeMeshFile(const std::string& filepath, const MeshData& mesh, uint64_t sourceHash, uint64_t sourceSize);
+
+	// A mapped mesh file. The constructor checks the header and every index, vertices() and indices()
+	// point into the mapping. Throws std::runtime_error for missing, truncated or incompatible files.
+	class RocketMeshFile {
+	public:
+		RocketMeshFile(const std::string& filepath);
+
+		RocketMeshFile(const RocketMeshFile&) = delete;
+		RocketMeshFile& operator=(const RocketMeshFile&) = delete;
+
+		bool cookedFrom(uint64_t sourceHash, uint64_t sourceSize) const { return header->sourceHash == sourceHash && header->sourceSize == sourceSize; }
+		const MeshHeader& getHeader() const { return *header; }
+		const RocketModel::Vertex* vertices() const { return vertexData; }
+		const uint32_t* indices() const { return indexData; }
+	private:
+		RocketMappedFile file;
+		const MeshHeader* header = nullptr;
+		const RocketModel::Vertex* vertexData = nullptr;
+		const uint32_t* indexData = nullptr;
+	};
+
+	struct MeshLoadInfo {
+		// False when the source had to be parsed and the cooked file was written
+		bool cached = false;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		double milliseconds = 0.0;
+	};
+
+	// Cooked file of a source mesh, next to it
+	std::string cookedMeshPath(const std::string& sourcePath);
+	// Parses the source and writes its cooked file, for cooking ahead of time
+	void cookMesh(const std::string& sourcePath);
+	// Model of an OBJ file. The source is only hashed: a cooked file with the same hash is mapped and
+	// uploaded in one staged copy. Otherwise the source is parsed and the cooked file rewritten for the next
+	// load; a cooked file that cannot be written is reported on std::cerr and the model is still returned.
+	std::shared_ptr<RocketModel> loadMesh(RocketGeometryArena& arena, const std::string& sourcePath, MeshLoadInfo* info = nullptr);
+}
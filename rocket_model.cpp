@@ -1,49 +1,52 @@
 #include "rocket_model.hpp"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <numeric>
 
 namespace rocket {
-	RocketModel::RocketModel(RocketDevice& device, const std::vector<Vertex>& vertices) : rocketDevice {device}
+	RocketModel::RocketModel(RocketGeometryArena& arena, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) : arena{ arena }
 	{
-		createVertexBuffers(vertices);
+		uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
+		for (const auto& vertex : vertices) {
+			boundingRadius = std::max(boundingRadius, glm::length(vertex.position));
+		}
+		if (!indices.empty()) {
+			geometry = arena.allocate(vertices.data(), vertexCount, indices.data(), static_cast<uint32_t>(indices.size()));
+			return;
+		}
+		std::vector<uint32_t> sequence(vertexCount);
+		std::iota(sequence.begin(), sequence.end(), 0u);
+		geometry = arena.allocate(vertices.data(), vertexCount, sequence.data(), vertexCount);
+	}
+
+	RocketModel::RocketModel(RocketGeometryArena& arena, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, float boundingRadius)
+		: arena{ arena }, boundingRadius{ boundingRadius }
+	{
+		assert(vertexCount >= 3 && indexCount >= 3 && "Vertex and index count must be at least 3");
+		geometry = arena.allocate(vertices, vertexCount, indices, indexCount);
 	}
 
 	RocketModel::~RocketModel()
 	{
-		vkDestroyBuffer(rocketDevice.device(), vertexBuffer, nullptr);
-		vkFreeMemory(rocketDevice.device(), vertexBufferMemory, nullptr);
+		arena.free(geometry);
 	}
 
 	void RocketModel::bind(VkCommandBuffer commandBuffer)
 	{
-		VkBuffer buffers[] = {vertexBuffer};
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets); // Record command to bind vertex buffer
-
+		arena.bind(commandBuffer);
 	}
 
 	void RocketModel::draw(VkCommandBuffer commandBuffer)
 	{
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
-
+		draw(commandBuffer, 1, 0);
 	}
 
-	void RocketModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	void RocketModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-
-		rocketDevice.createBuffer(bufferSize, 
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // memory can be seen by CPU and GPU
-			vertexBuffer, 
-			vertexBufferMemory);
-
-		void* data;
-		vkMapMemory(rocketDevice.device(), vertexBufferMemory, 0, bufferSize, 0, &data); // copy data to CPU
-		memcpy(data, vertices.data(), static_cast<size_t>(bufferSize)); // automatically copy it to GPU
-		vkUnmapMemory(rocketDevice.device(), vertexBufferMemory); // remove data from CPU
+		const GeometryRange& range = getRange();
+		vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex, static_cast<int32_t>(range.firstVertex), firstInstance);
 	}
 
 	std::vector<VkVertexInputBindingDescription> RocketModel::Vertex::getBindingDescriptions()
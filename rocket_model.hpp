@@ -1,11 +1,14 @@
 #pragma once
 #include "rocket_device.hpp"
+#include "rocket_geometry_arena.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
 namespace rocket {
+	// A view of one range of a RocketGeometryArena, freed when the model is destroyed. Every draw is
+	// indexed; models built without indices get the sequence 0..n-1.
 	class RocketModel {
 	public:
 
@@ -17,20 +20,29 @@ namespace rocket {
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 		};
-		RocketModel(RocketDevice &device, const std::vector<Vertex>& vertices);
+		RocketModel(RocketGeometryArena& arena, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices = {});
+		// Geometry that is already indexed and measured, such as a mapped mesh file
+		RocketModel(RocketGeometryArena& arena, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, float boundingRadius);
 		~RocketModel();
 
 		RocketModel(const RocketModel&) = delete;
 		void operator=(const RocketModel&) = delete;
 
+		// Binds the whole arena, models of the same arena need no bind between their draws
 		void bind(VkCommandBuffer commandBuffer);
 		void draw(VkCommandBuffer commandBuffer);
+		// Draws instanceCount copies, gl_InstanceIndex runs from firstInstance
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
+		RocketGeometryArena& getArena() const { return arena; }
+		// Current place in the arena, it moves when the arena is compacted or grows
+		const GeometryRange& getRange() const { return arena.range(geometry); }
+		uint32_t getVertexCount() const { return getRange().vertexCount; }
+		uint32_t getIndexCount() const { return getRange().indexCount; }
+		// Distance of the farthest vertex from the model origin
+		float getBoundingRadius() const { return boundingRadius; }
 	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-
-		RocketDevice &rocketDevice;
-		VkBuffer vertexBuffer;
-		VkDeviceMemory vertexBufferMemory;
-		uint32_t vertexCount;
+		RocketGeometryArena& arena;
+		GeometryHandle geometry = RocketGeometryArena::INVALID_HANDLE;
+		float boundingRadius = 0.0f;
 	};
 }
\ No newline at end of file
@@ -1,27 +1,41 @@
 #include "rocket_pipeline.hpp"
 #include "rocket_model.hpp"
-#include <fstream>
-#include <iostream>
 #include <cassert>
+#include <stdexcept>
 namespace rocket {
 
 
 
-	RocketPipeline::RocketPipeline(RocketDevice& device, 
-		const std::string& vertFilePath, 
-		const std::string& fragFilePath, 
-		const PipelineConfigInfo pipelineConfigInfo): rocketDevice{device}
+	RocketPipeline::RocketPipeline(RocketDevice& device,
+		VkShaderModule vertShaderModule,
+		VkShaderModule fragShaderModule,
+		const PipelineConfigInfo pipelineConfigInfo,
+		VkPipelineCache pipelineCache) : rocketDevice{ device }
 	{
-		createGraphicsPipeline(vertFilePath, fragFilePath, pipelineConfigInfo);
-		std::cout << "Graphics pipeline created." << std::endl;
+		createGraphicsPipeline(vertShaderModule, fragShaderModule, pipelineConfigInfo, pipelineCache);
 	}
 
 	RocketPipeline::~RocketPipeline() {
-		vkDestroyShaderModule(rocketDevice.device(), fragShaderModule, nullptr);
-		vkDestroyShaderModule(rocketDevice.device(), vertShaderModule, nullptr);
 		vkDestroyPipeline(rocketDevice.device(), graphicsPipeline, nullptr);
 	}
 
+	void SpecializationConstants::set(uint32_t constantId, uint32_t value)
+	{
+		for (const auto& entry : entries) {
+			if (entry.constantID == constantId) {
+				data[entry.offset / sizeof(uint32_t)] = value;
+				return;
+			}
+		}
+		// All constants are 32 bit (bool, int, uint and float in GLSL)
+		VkSpecializationMapEntry entry{};
+		entry.constantID = constantId;
+		entry.offset = static_cast<uint32_t>(data.size() * sizeof(uint32_t));
+		entry.size = sizeof(uint32_t);
+		entries.push_back(entry);
+		data.push_back(value);
+	}
+
 	void RocketPipeline::bind(VkCommandBuffer commandBuffer)
 	{
 		// Bind the pipeline to the command buffer
@@ -107,39 +121,25 @@ namespace rocket {
 		configInfo.dynamicStateInfo.flags = 0;
 	}
 
-	// Read a file into a vector of chars
-	std::vector<char> RocketPipeline::readFile(const std::string& filepath)
-	{
-		std::ifstream file{ filepath, std::ios::ate | std::ios::binary }; // Start at the end of the file
-
-		if(!file.is_open()) {
-			throw std::runtime_error("Failed to open file: " + filepath);
-		}
-
-		size_t fileSize = static_cast<size_t>(file.tellg()); // Already at the end of the file
-		std::vector<char> buffer(fileSize);
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-		file.close();
-
-		return buffer;
-	}
-
-	// Create the graphics pipeline using given vertex and fragment shader files
+	// Create the graphics pipeline using given vertex and fragment shader modules
 	void RocketPipeline::createGraphicsPipeline(
-		const std::string& vertFilePath,
-		const std::string& fragFilePath,
-		PipelineConfigInfo pipelineConfigInfo)
+		VkShaderModule vertShaderModule,
+		VkShaderModule fragShaderModule,
+		PipelineConfigInfo pipelineConfigInfo,
+		VkPipelineCache pipelineCache)
 	{
 		assert(pipelineConfigInfo.pipelineLayout != VK_NULL_HANDLE
 			&& "Cannot create grahpics pipeline: no pipelineLayout provided in configInfo!");
 		assert(pipelineConfigInfo.renderPass != VK_NULL_HANDLE
 			&& "Cannot create grahpics pipeline: no pipelineLayout provided in configInfo!");
-		auto vertCode = readFile(vertFilePath);
-		auto fragCode = readFile(fragFilePath);
-
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		// Both stages share the same constants, ids missing from a stage are ignored
+		const auto& constants = pipelineConfigInfo.specializationConstants;
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(constants.entries.size());
+		specializationInfo.pMapEntries = constants.entries.data();
+		specializationInfo.dataSize = constants.data.size() * sizeof(uint32_t);
+		specializationInfo.pData = constants.data.data();
+		const VkSpecializationInfo* pSpecializationInfo = constants.empty() ? nullptr : &specializationInfo;
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -147,7 +147,7 @@ namespace rocket {
 		shaderStages[0].module = vertShaderModule;
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
-		shaderStages[0].pSpecializationInfo = nullptr;  // Optional
+		shaderStages[0].pSpecializationInfo = pSpecializationInfo;
 		shaderStages[0].pNext = nullptr;               // Optional
 
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -155,7 +155,7 @@ namespace rocket {
 		shaderStages[1].module = fragShaderModule;
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
-		shaderStages[1].pSpecializationInfo = nullptr;  // Optional
+		shaderStages[1].pSpecializationInfo = pSpecializationInfo;
 		shaderStages[1].pNext = nullptr;               // Optional
 
 		// Vertex input config
@@ -191,7 +191,7 @@ namespace rocket {
 		pipelineInfo.basePipelineIndex = -1;    // Optional
 
 		if(vkCreateGraphicsPipelines(rocketDevice.device(), 
-			VK_NULL_HANDLE, 
+			pipelineCache, 
 			1, 
 			&pipelineInfo, 
 			nullptr, 
@@ -201,16 +201,4 @@ namespace rocket {
 
 	}
 
-	void RocketPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
-	{
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-		if (vkCreateShaderModule(rocketDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create shader module!");
-		}
-	}
-
 }
@@ -4,6 +4,22 @@
 #include "rocket_device.hpp"
 
 namespace rocket {
+	// Shader feature toggles, selected per pipeline with specialization constants instead of separate shader files
+	enum ShaderConstantId : uint32_t {
+		// Model vertex colours instead of the per object colour
+		SHADER_CONSTANT_USE_VERTEX_COLOR = 0,
+		// instanced_shader.vert reads objects through the visible indices written by build_draws.comp
+		SHADER_CONSTANT_INDIRECT = 1
+	};
+
+	struct SpecializationConstants {
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint32_t> data;
+
+		void set(uint32_t constantId, uint32_t value);
+		bool empty() const { return entries.empty(); }
+	};
+
 	struct PipelineConfigInfo {
 		//VkViewport viewport; No longer needed because we are using dynamic viewport and scissor
 		//VkRect2D scissor;
@@ -19,13 +35,16 @@ namespace rocket {
 		VkPipelineLayout pipelineLayout = nullptr;	
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		SpecializationConstants specializationConstants;
 	};
 	class RocketPipeline {
 	public:
-		RocketPipeline(RocketDevice &device, 
-			const std::string& vertFilePath, 
-			const std::string& fragFilePath, 
-			const PipelineConfigInfo pipelineConfigInfo);
+		// Shader modules are only needed while linking and may be destroyed once the constructor returns
+		RocketPipeline(RocketDevice& device,
+			VkShaderModule vertShaderModule,
+			VkShaderModule fragShaderModule,
+			const PipelineConfigInfo pipelineConfigInfo,
+			VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 		~RocketPipeline();
 		RocketPipeline(const RocketPipeline&) = delete;
 		RocketPipeline& operator=(const RocketPipeline&) = delete;
@@ -33,13 +52,9 @@ namespace rocket {
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 	private:
-		static std::vector<char> readFile(const std::string& filepath);
-		void createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo);
+		void createGraphicsPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo, VkPipelineCache pipelineCache);
 
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 		RocketDevice& rocketDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
 	};
 }
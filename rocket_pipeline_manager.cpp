@@ -0,0 +1,293 @@
+#include "rocket_pipeline_manager.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace rocket {
+
+	// Appends the raw bytes of a plain value to the key. Whole Vulkan structs are never appended because
+	// their padding and unused members are not initialized.
+	template <typename T>
+	static void appendKey(std::string& key, const T& value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	static void appendKey(std::string& key, const std::string& value)
+	{
+		appendKey(key, value.size());
+		key.append(value);
+	}
+
+	static std::string normalizePath(const std::string& path)
+	{
+		return std::filesystem::path(path).lexically_normal().generic_string();
+	}
+
+	void RocketPipelineFuture::wait() const
+	{
+		std::unique_lock<std::mutex> lock{ state->mutex };
+		state->condition.wait(lock, [this] { return state->status.load() != PENDING; });
+	}
+
+	bool RocketPipelineFuture::bind(VkCommandBuffer commandBuffer, RocketPipeline* fallback) const
+	{
+		RocketPipeline* pipeline = get();
+		if (pipeline == nullptr) {
+			pipeline = fallback;
+		}
+		if (pipeline == nullptr) {
+			return false;
+		}
+		pipeline->bind(commandBuffer);
+		return true;
+	}
+
+	RocketPipelineManager::RocketPipelineManager(RocketDevice& device, unsigned int compileThreads)
+		: rocketDevice{ device }, compilePool{ compileThreads }
+	{
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		if (vkCreatePipelineCache(rocketDevice.device(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline cache!");
+		}
+	}
+
+	RocketPipelineManager::~RocketPipelineManager()
+	{
+		compilePool.waitIdle();
+		pendingReloads.clear();
+		// Replaced pipelines wait in the device's deletion queue, destroy them while the cache still exists
+		rocketDevice.flushDeletions();
+		clear();
+		vkDestroyPipelineCache(rocketDevice.device(), pipelineCache, nullptr);
+	}
+
+	std::shared_ptr<RocketPipeline> RocketPipelineManager::getPipeline(
+		const std::string& vertFilePath,
+		const std::string& fragFilePath,
+		const PipelineConfigInfo& configInfo)
+	{
+		RocketPipelineFuture future = requestPipeline(vertFilePath, fragFilePath, configInfo, false);
+		future.wait();
+		if (future.hasFailed()) {
+			// Don't keep the failure cached, the next request tries again
+			std::lock_guard<std::mutex> lock{ pipelinesMutex };
+			auto it = pipelines.find(pipelineKey(vertFilePath, fragFilePath, configInfo));
+			if (it != pipelines.end() && it->second == future.state) {
+				pipelines.erase(it);
+			}
+			throw std::runtime_error(future.getError());
+		}
+		return future.share();
+	}
+
+	RocketPipelineFuture RocketPipelineManager::getPipelineAsync(
+		const std::string& vertFilePath,
+		const std::string& fragFilePath,
+		const PipelineConfigInfo& configInfo)
+	{
+		return requestPipeline(vertFilePath, fragFilePath, configInfo, true);
+	}
+
+	void RocketPipelineManager::clear()
+	{
+		std::lock_guard<std::mutex> lock{ pipelinesMutex };
+		pipelines.clear();
+	}
+
+	size_t RocketPipelineManager::pipelineCount()
+	{
+		std::lock_guard<std::mutex> lock{ pipelinesMutex };
+		return pipelines.size();
+	}
+
+	RocketPipelineFuture RocketPipelineManager::requestPipeline(
+		const std::string& vertFilePath,
+		const std::string& fragFilePath,
+		const PipelineConfigInfo& configInfo,
+		bool async)
+	{
+		std::string key = pipelineKey(vertFilePath, fragFilePath, configInfo);
+		auto state = std::make_shared<State>();
+		{
+			std::lock_guard<std::mutex> lock{ pipelinesMutex };
+			auto it = pipelines.find(key);
+			if (it != pipelines.end() && it->second->status.load(std::memory_order_acquire) != RocketPipelineFuture::FAILED) {
+				hitCount++;
+				return RocketPipelineFuture{ it->second };
+			}
+			// A failed build is replaced, earlier futures keep reporting their error
+			pipelines[std::move(key)] = state;
+		}
+
+		// Entries keep their own copy of the build inputs for async builds and hot reload.
+		// The config points into itself, so the copy has to be re-pointed.
+		state->vertFilePath = vertFilePath;
+		state->fragFilePath = fragFilePath;
+		state->configInfo = std::make_shared<PipelineConfigInfo>(configInfo);
+		state->configInfo->colorBlendInfo.pAttachments = &state->configInfo->colorBlendAttachment;
+		state->configInfo->dynamicStateInfo.pDynamicStates = state->configInfo->dynamicStateEnables.data();
+
+		if (!async) {
+			buildPipeline(*state);
+			return RocketPipelineFuture{ state };
+		}
+		compilePool.submit([this, state] { buildPipeline(*state); });
+		return RocketPipelineFuture{ state };
+	}
+
+	void RocketPipelineManager::reloadShader(const std::string& spvPath)
+	{
+		std::string path = normalizePath(spvPath);
+		std::lock_guard<std::mutex> lock{ pipelinesMutex };
+		for (const auto& kv : pipelines) {
+			const auto& target = kv.second;
+			if (target->status.load(std::memory_order_acquire) == RocketPipelineFuture::PENDING ||
+				(normalizePath(target->vertFilePath) != path && normalizePath(target->fragFilePath) != path)) {
+				continue;
+			}
+
+			auto replacement = std::make_shared<State>();
+			replacement->vertFilePath = target->vertFilePath;
+			replacement->fragFilePath = target->fragFilePath;
+			replacement->configInfo = target->configInfo;
+
+			// A newer edit supersedes a reload that is still compiling
+			pendingReloads.erase(
+				std::remove_if(pendingReloads.begin(), pendingReloads.end(),
+					[&target](const PendingReload& reload) { return reload.target == target; }),
+				pendingReloads.end());
+			pendingReloads.push_back({ target, replacement });
+			compilePool.submit([this, replacement] { buildPipeline(*replacement); });
+		}
+	}
+
+	void RocketPipelineManager::applyReloads()
+	{
+		for (auto it = pendingReloads.begin(); it != pendingReloads.end();) {
+			int status = it->replacement->status.load(std::memory_order_acquire);
+			if (status == RocketPipelineFuture::PENDING) {
+				++it;
+				continue;
+			}
+
+			if (status == RocketPipelineFuture::READY) {
+				// Frames still in flight may use the old pipeline, so it outlives them
+				if (it->target->pipeline) {
+					rocketDevice.deferDeletion([retired = std::move(it->target->pipeline)]() mutable { retired.reset(); });
+				}
+				it->target->pipeline = it->replacement->pipeline;
+				it->target->status.store(RocketPipelineFuture::READY, std::memory_order_release);
+				std::cout << "Reloaded pipeline " << it->target->vertFilePath << " + " << it->target->fragFilePath << std::endl;
+			}
+			else {
+				std::cerr << "Pipeline reload failed, keeping previous pipeline: " << it->replacement->error << std::endl;
+			}
+			it = pendingReloads.erase(it);
+		}
+	}
+
+	void RocketPipelineManager::buildPipeline(State& state)
+	{
+		try {
+			auto vertShader = rocketDevice.getShaderCache().getModule(state.vertFilePath);
+			auto fragShader = rocketDevice.getShaderCache().getModule(state.fragFilePath);
+			state.pipeline = std::make_shared<RocketPipeline>(
+				rocketDevice,
+				vertShader->getShaderModule(),
+				fragShader->getShaderModule(),
+				*state.configInfo,
+				pipelineCache);
+			state.status.store(RocketPipelineFuture::READY, std::memory_order_release);
+		}
+		catch (const std::exception& e) {
+			state.error = e.what();
+			state.status.store(RocketPipelineFuture::FAILED, std::memory_order_release);
+		}
+
+		std::lock_guard<std::mutex> lock{ state.mutex };
+		state.condition.notify_all();
+	}
+
+	std::string RocketPipelineManager::pipelineKey(
+		const std::string& vertFilePath,
+		const std::string& fragFilePath,
+		const PipelineConfigInfo& configInfo)
+	{
+		std::string key;
+		key.reserve(256);
+		appendKey(key, vertFilePath);
+		appendKey(key, fragFilePath);
+
+		appendKey(key, configInfo.inputAssemblyInfo.topology);
+		appendKey(key, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+
+		appendKey(key, configInfo.viewport.viewportCount);
+		appendKey(key, configInfo.viewport.scissorCount);
+
+		const auto& rasterization = configInfo.rasterizationInfo;
+		appendKey(key, rasterization.depthClampEnable);
+		appendKey(key, rasterization.rasterizerDiscardEnable);
+		appendKey(key, rasterization.polygonMode);
+		appendKey(key, rasterization.lineWidth);
+		appendKey(key, rasterization.cullMode);
+		appendKey(key, rasterization.frontFace);
+		appendKey(key, rasterization.depthBiasEnable);
+		appendKey(key, rasterization.depthBiasConstantFactor);
+		appendKey(key, rasterization.depthBiasClamp);
+		appendKey(key, rasterization.depthBiasSlopeFactor);
+
+		const auto& multisample = configInfo.multisampleInfo;
+		appendKey(key, multisample.sampleShadingEnable);
+		appendKey(key, multisample.rasterizationSamples);
+		appendKey(key, multisample.minSampleShading);
+		appendKey(key, multisample.alphaToCoverageEnable);
+		appendKey(key, multisample.alphaToOneEnable);
+
+		const auto& blendAttachment = configInfo.colorBlendAttachment;
+		appendKey(key, blendAttachment.colorWriteMask);
+		appendKey(key, blendAttachment.blendEnable);
+		appendKey(key, blendAttachment.srcColorBlendFactor);
+		appendKey(key, blendAttachment.dstColorBlendFactor);
+		appendKey(key, blendAttachment.colorBlendOp);
+		appendKey(key, blendAttachment.srcAlphaBlendFactor);
+		appendKey(key, blendAttachment.dstAlphaBlendFactor);
+		appendKey(key, blendAttachment.alphaBlendOp);
+
+		const auto& colorBlend = configInfo.colorBlendInfo;
+		appendKey(key, colorBlend.logicOpEnable);
+		appendKey(key, colorBlend.logicOp);
+		appendKey(key, colorBlend.attachmentCount);
+		for (float constant : colorBlend.blendConstants) {
+			appendKey(key, constant);
+		}
+
+		const auto& depthStencil = configInfo.depthStencilInfo;
+		appendKey(key, depthStencil.depthTestEnable);
+		appendKey(key, depthStencil.depthWriteEnable);
+		appendKey(key, depthStencil.depthCompareOp);
+		appendKey(key, depthStencil.depthBoundsTestEnable);
+		appendKey(key, depthStencil.minDepthBounds);
+		appendKey(key, depthStencil.maxDepthBounds);
+		appendKey(key, depthStencil.stencilTestEnable);
+
+		appendKey(key, configInfo.dynamicStateEnables.size());
+		for (VkDynamicState state : configInfo.dynamicStateEnables) {
+			appendKey(key, state);
+		}
+
+		appendKey(key, configInfo.pipelineLayout);
+		appendKey(key, configInfo.renderPass);
+		appendKey(key, configInfo.subpass);
+
+		const auto& constants = configInfo.specializationConstants;
+		appendKey(key, constants.entries.size());
+		for (size_t i = 0; i < constants.entries.size(); i++) {
+			appendKey(key, constants.entries[i].constantID);
+			appendKey(key, constants.data[constants.entries[i].offset / sizeof(uint32_t)]);
+		}
+		return key;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "rocket_pipeline.hpp"
+#include "rocket_shader_cache.hpp"
+#include "rocket_thread_pool.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+	// Handle to a pipeline that may still be compiling on a worker thread. Checking and binding it
+	// never blocks: the worker publishes the finished pipeline with a single atomic store.
+	class RocketPipelineFuture {
+	public:
+		RocketPipelineFuture() = default;
+
+		bool isValid() const { return state != nullptr; }
+		bool isReady() const { return state && state->status.load(std::memory_order_acquire) == READY; }
+		bool hasFailed() const { return state && state->status.load(std::memory_order_acquire) == FAILED; }
+		// nullptr while the pipeline is pending or if it failed to compile
+		RocketPipeline* get() const { return isReady() ? state->pipeline.get() : nullptr; }
+		std::shared_ptr<RocketPipeline> share() const { return isReady() ? state->pipeline : nullptr; }
+		const std::string& getError() const { return state->error; }
+		void wait() const;
+
+		// Binds the pipeline, or fallback while it is not ready. Returns false when nothing was bound and
+		// the caller should skip its draws.
+		bool bind(VkCommandBuffer commandBuffer, RocketPipeline* fallback = nullptr) const;
+	private:
+		friend class RocketPipelineManager;
+		enum Status { PENDING, READY, FAILED };
+		struct State {
+			std::string vertFilePath;
+			std::string fragFilePath;
+			std::shared_ptr<PipelineConfigInfo> configInfo;
+			std::atomic<int> status{ PENDING };
+			std::shared_ptr<RocketPipeline> pipeline;
+			std::string error;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+		RocketPipelineFuture(std::shared_ptr<State> state) : state{ std::move(state) } {}
+
+		std::shared_ptr<State> state;
+	};
+
+	// Owns every graphics pipeline built through it. Identical requests (same shaders, fixed function
+	// state, layout, render pass and specialization constants) share a single pipeline.
+	// Shader modules come from the device's shader cache and are released once their pipelines are linked.
+	class RocketPipelineManager {
+	public:
+		RocketPipelineManager(RocketDevice& device, unsigned int compileThreads = 1);
+		~RocketPipelineManager();
+
+		RocketPipelineManager(const RocketPipelineManager&) = delete;
+		RocketPipelineManager& operator=(const RocketPipelineManager&) = delete;
+
+		// Builds on the calling thread, waits if the same pipeline is already compiling asynchronously.
+		// Failed builds are not cached, requesting the same pipeline again retries it.
+		std::shared_ptr<RocketPipeline> getPipeline(
+			const std::string& vertFilePath,
+			const std::string& fragFilePath,
+			const PipelineConfigInfo& configInfo);
+		// Returns immediately, the pipeline is compiled on a worker thread
+		RocketPipelineFuture getPipelineAsync(
+			const std::string& vertFilePath,
+			const std::string& fragFilePath,
+			const PipelineConfigInfo& configInfo);
+		void clear();
+
+		// Shader hot reload, both are called from the render thread. Every pipeline built from spvPath is
+		// recompiled in the background, applyReloads() swaps finished ones in at the next frame boundary.
+		// Futures keep pointing at the same entry, so users pick up the new pipeline without re-requesting it.
+		// If the rebuild fails the previous pipeline stays in use.
+		void reloadShader(const std::string& spvPath);
+		void applyReloads();
+
+		// Keep shader modules alive while many pipelines are created from the same files
+		void beginBatch() { rocketDevice.getShaderCache().beginBatch(); }
+		void endBatch() { rocketDevice.getShaderCache().endBatch(); }
+
+		size_t pipelineCount();
+		size_t cacheHits() const { return hitCount.load(); }
+
+		static std::string pipelineKey(
+			const std::string& vertFilePath,
+			const std::string& fragFilePath,
+			const PipelineConfigInfo& configInfo);
+	private:
+		using State = RocketPipelineFuture::State;
+
+		RocketPipelineFuture requestPipeline(
+			const std::string& vertFilePath,
+			const std::string& fragFilePath,
+			const PipelineConfigInfo& configInfo,
+			bool async);
+		void buildPipeline(State& state);
+
+		struct PendingReload {
+			std::shared_ptr<State> target;
+			std::shared_ptr<State> replacement;
+		};
+
+		RocketDevice& rocketDevice;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		std::mutex pipelinesMutex;
+		std::unordered_map<std::string, std::shared_ptr<State>> pipelines;
+		std::atomic<size_t> hitCount{ 0 };
+		std::vector<PendingReload> pendingReloads;
+		RocketThreadPool compilePool;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace rocket {
+	// xoshiro128+ (Blackman and Vigna) with LANES independent states side by side, so filling a batch
+	// updates all lanes in the same loop and compiles to SIMD. The low bits of xoshiro128+ are weak,
+	// floats only use the top 24.
+	class RocketRandom {
+	public:
+		static constexpr int LANES = 4;
+
+		explicit RocketRandom(uint64_t seed = 0x853C49E6748FEA9Bull) { setSeed(seed); }
+
+		// Seeds every lane from splitmix64, the same seed always gives the same sequence
+		void setSeed(uint64_t seed)
+		{
+			for (int lane = 0; lane < LANES; lane++) {
+				for (int word = 0; word < 4; word += 2) {
+					uint64_t value = splitMix64(seed);
+					state[word][lane] = static_cast<uint32_t>(value);
+					state[word + 1][lane] = static_cast<uint32_t>(value >> 32);
+				}
+			}
+			buffered = LANES;
+		}
+
+		uint32_t nextUint()
+		{
+			if (buffered == LANES) {
+				nextLanes(buffer);
+				buffered = 0;
+			}
+			return buffer[buffered++];
+		}
+
+		// Uniform in [0, 1)
+		float nextFloat() { return toUnitFloat(nextUint()); }
+		float nextFloat(float minimum, float maximum) { return minimum + (maximum - minimum) * nextFloat(); }
+
+		// count uniform floats in [minimum, maximum), LANES at a time
+		void fillUniform(float* out, size_t count, float minimum, float maximum)
+		{
+			float range = maximum - minimum;
+			size_t i = 0;
+			for (; i + LANES <= count; i += LANES) {
+				uint32_t values[LANES];
+				nextLanes(values);
+				for (int lane = 0; lane < LANES; lane++) {
+					out[i + lane] = minimum + range * toUnitFloat(values[lane]);
+				}
+			}
+			for (; i < count; i++) {
+				out[i] = minimum + range * nextFloat();
+			}
+		}
+
+	private:
+		static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+		static float toUnitFloat(uint32_t x) { return static_cast<float>(x >> 8) * (1.0f / 16777216.0f); }
+
+		static uint64_t splitMix64(uint64_t& x)
+		{
+			uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		void nextLanes(uint32_t out[LANES])
+		{
+			for (int lane = 0; lane < LANES; lane++) {
+				uint32_t s0 = state[0][lane], s1 = state[1][lane], s2 = state[2][lane], s3 = state[3][lane];
+				out[lane] = s0 + s3;
+				uint32_t t = s1 << 9;
+				s2 ^= s0;
+				s3 ^= s1;
+				s1 ^= s2;
+				s0 ^= s3;
+				s2 ^= t;
+				s3 = rotl(s3, 11);
+				state[0][lane] = s0;
+				state[1][lane] = s1;
+				state[2][lane] = s2;
+				state[3][lane] = s3;
+			}
+		}
+
+		// state[word][lane]
+		uint32_t state[4][LANES];
+		uint32_t buffer[LANES];
+		int buffered = LANES;
+	};
+}
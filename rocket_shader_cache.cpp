@@ -0,0 +1,119 @@
+#include "rocket_shader_cache.hpp"
+#include "rocket_mapped_file.hpp"
+#include "rocket_utils.hpp"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace rocket {
+	RocketShaderModule::RocketShaderModule(RocketDevice& device, const char* code, size_t codeSize, uint64_t contentHash)
+		: rocketDevice{ device }, contentHash{ contentHash }, code(code, code + codeSize)
+	{
+		if (codeSize == 0 || codeSize % sizeof(uint32_t) != 0) {
+			throw std::runtime_error("Invalid SPIR-V code size!");
+		}
+
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = codeSize;
+		createInfo.pCode = reinterpret_cast<const uint32_t*>(code); // mapped memory is page aligned
+
+		if (vkCreateShaderModule(rocketDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create shader module!");
+		}
+	}
+
+	RocketShaderModule::~RocketShaderModule()
+	{
+		vkDestroyShaderModule(rocketDevice.device(), shaderModule, nullptr);
+	}
+
+	bool RocketShaderModule::hasCode(const char* otherCode, size_t otherSize) const
+	{
+		return otherSize == code.size() && std::equal(code.begin(), code.end(), otherCode);
+	}
+
+	RocketShaderCache::RocketShaderCache(RocketDevice& device) : rocketDevice{ device }
+	{
+	}
+
+	std::shared_ptr<RocketShaderModule> RocketShaderCache::getModule(const std::string& filepath)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(filepath, error);
+		auto fileSize = std::filesystem::file_size(filepath, error);
+		if (error) {
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+
+		// Unchanged file whose module is still alive, no I/O needed
+		auto fileIt = files.find(filepath);
+		if (fileIt != files.end() && fileIt->second.writeTime == writeTime && fileIt->second.fileSize == fileSize) {
+			if (auto module = fileIt->second.module.lock()) {
+				if (batchDepth > 0) {
+					batchModules.push_back(module);
+				}
+				return module;
+			}
+		}
+
+		RocketMappedFile file{ filepath };
+		loadCount++;
+		uint64_t contentHash = hashBytes(file.data(), file.size());
+
+		// Same hash and size is only a candidate, the bytes decide
+		auto& candidates = modules[{ contentHash, file.size() }];
+		std::shared_ptr<RocketShaderModule> module;
+		for (auto it = candidates.begin(); it != candidates.end();) {
+			auto candidate = it->lock();
+			if (!candidate) {
+				it = candidates.erase(it);
+				continue;
+			}
+			if (candidate->hasCode(file.data(), file.size())) {
+				module = std::move(candidate);
+				break;
+			}
+			++it;
+		}
+		if (!module) {
+			module = std::make_shared<RocketShaderModule>(rocketDevice, file.data(), file.size(), contentHash);
+			candidates.push_back(module);
+		}
+		files[filepath] = FileEntry{ writeTime, fileSize, module };
+		if (batchDepth > 0) {
+			batchModules.push_back(module);
+		}
+		return module;
+	}
+
+	void RocketShaderCache::beginBatch()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		batchDepth++;
+	}
+
+	void RocketShaderCache::endBatch()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		assert(batchDepth > 0 && "endBatch called without beginBatch");
+		if (--batchDepth == 0) {
+			batchModules.clear();
+		}
+	}
+
+	size_t RocketShaderCache::liveModules()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		size_t count = 0;
+		for (const auto& kv : modules) {
+			for (const auto& module : kv.second) {
+				if (!module.expired()) {
+					count++;
+				}
+			}
+		}
+		return count;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "rocket_device.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rocket {
+	class RocketShaderModule {
+	public:
+		RocketShaderModule(RocketDevice& device, const char* code, size_t codeSize, uint64_t contentHash);
+		~RocketShaderModule();
+
+		RocketShaderModule(const RocketShaderModule&) = delete;
+		RocketShaderModule& operator=(const RocketShaderModule&) = delete;
+
+		VkShaderModule getShaderModule() const { return shaderModule; }
+		uint64_t getContentHash() const { return contentHash; }
+		// Byte comparison against the SPIR-V the module was created from
+		bool hasCode(const char* otherCode, size_t otherSize) const;
+	private:
+		RocketDevice& rocketDevice;
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		uint64_t contentHash;
+		std::vector<char> code;
+	};
+
+	// Shader modules keyed by file path and by SPIR-V content hash and size. Files are memory mapped instead
+	// of read, and identical SPIR-V behind different paths shares one module, the bytes are compared so a
+	// hash collision can't hand out the wrong module. Owned by RocketDevice. The cache only keeps weak references,
+	// so a module is destroyed as soon as the pipelines using it are linked. Between beginBatch() and
+	// endBatch() modules are kept alive, so building many pipelines from the same shaders loads each file once.
+	// All functions are thread safe.
+	class RocketShaderCache {
+	public:
+		RocketShaderCache(RocketDevice& device);
+
+		RocketShaderCache(const RocketShaderCache&) = delete;
+		RocketShaderCache& operator=(const RocketShaderCache&) = delete;
+
+		std::shared_ptr<RocketShaderModule> getModule(const std::string& filepath);
+		void beginBatch();
+		void endBatch();
+
+		size_t fileLoads() const { return loadCount; }
+		size_t liveModules();
+	private:
+		struct FileEntry {
+			std::filesystem::file_time_type writeTime;
+			uintmax_t fileSize;
+			std::weak_ptr<RocketShaderModule> module;
+		};
+
+		RocketDevice& rocketDevice;
+		std::mutex mutex;
+		std::unordered_map<std::string, FileEntry> files;
+		// Content hash and size, modules whose code differs despite both matching share the list
+		std::map<std::pair<uint64_t, size_t>, std::vector<std::weak_ptr<RocketShaderModule>>> modules;
+		std::vector<std::shared_ptr<RocketShaderModule>> batchModules;
+		int batchDepth = 0;
+		size_t loadCount = 0;
+	};
+}
@@ -0,0 +1,132 @@
+#include "rocket_shader_watcher.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace rocket {
+	RocketShaderWatcher::RocketShaderWatcher(const std::string& directory, const std::string& compilerCommand)
+		: directory{ directory }, compilerCommand{ compilerCommand }
+	{
+		watchThread = std::thread([this] { watchLoop(); });
+	}
+
+	RocketShaderWatcher::~RocketShaderWatcher()
+	{
+		stopping = true;
+		watchThread.join();
+	}
+
+	std::vector<std::string> RocketShaderWatcher::pollRecompiledShaders()
+	{
+		std::lock_guard<std::mutex> lock{ recompiledMutex };
+		std::vector<std::string> shaders;
+		shaders.swap(recompiled);
+		return shaders;
+	}
+
+	bool RocketShaderWatcher::isShaderSource(const std::string& filename)
+	{
+		std::string extension = std::filesystem::path(filename).extension().string();
+		return extension == ".vert" || extension == ".frag" || extension == ".comp";
+	}
+
+	void RocketShaderWatcher::compileShader(const std::string& sourceName)
+	{
+		std::string sourcePath = directory + "/" + sourceName;
+		std::string spvPath = sourcePath + ".spv";
+		std::string tempPath = spvPath + ".tmp";
+
+		std::string command = compilerCommand + " \"" + sourcePath + "\" -o \"" + tempPath + "\"";
+		if (std::system(command.c_str()) != 0) {
+			std::cerr << "Shader compilation failed, keeping previous version of " << sourceName << std::endl;
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+
+		// Replace the .spv in one step so readers never see a partially written file
+		std::error_code error;
+		std::filesystem::rename(tempPath, spvPath, error);
+		if (error) {
+			std::cerr << "Failed to replace " << spvPath << ": " << error.message() << std::endl;
+			return;
+		}
+		std::cout << "Recompiled shader " << sourceName << std::endl;
+
+		std::lock_guard<std::mutex> lock{ recompiledMutex };
+		recompiled.push_back(spvPath);
+	}
+
+#ifdef __linux__
+	void RocketShaderWatcher::watchLoop()
+	{
+		int inotifyFd = inotify_init1(IN_NONBLOCK);
+		if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			std::cerr << "Shader hot reload disabled, cannot watch " << directory << std::endl;
+			if (inotifyFd >= 0) {
+				close(inotifyFd);
+			}
+			return;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		while (!stopping) {
+			pollfd pollDescriptor{ inotifyFd, POLLIN, 0 };
+			if (poll(&pollDescriptor, 1, 200) <= 0) {
+				continue;
+			}
+
+			// Editors often write a file several times per save, compile each source once per batch
+			std::set<std::string> changed;
+			ssize_t length;
+			while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + length;) {
+					auto event = reinterpret_cast<const inotify_event*>(ptr);
+					if (event->len > 0 && isShaderSource(event->name)) {
+						changed.insert(event->name);
+					}
+					ptr += sizeof(inotify_event) + event->len;
+				}
+			}
+			for (const auto& sourceName : changed) {
+				compileShader(sourceName);
+			}
+		}
+		close(inotifyFd);
+	}
+#else
+	void RocketShaderWatcher::watchLoop()
+	{
+		std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+		bool firstScan = true;
+		while (!stopping) {
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+				std::string sourceName = entry.path().filename().string();
+				if (!isShaderSource(sourceName)) {
+					continue;
+				}
+				auto writeTime = entry.last_write_time(error);
+				auto it = writeTimes.find(sourceName);
+				if (it == writeTimes.end() || it->second != writeTime) {
+					writeTimes[sourceName] = writeTime;
+					if (!firstScan) {
+						compileShader(sourceName);
+					}
+				}
+			}
+			firstScan = false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		}
+	}
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rocket {
+	// Watches a directory of GLSL sources (inotify on Linux, polling elsewhere) and recompiles changed
+	// files to SPIR-V on a background thread. The .spv is only replaced when compilation succeeds, so a
+	// broken edit keeps the previous shader.
+	class RocketShaderWatcher {
+	public:
+		RocketShaderWatcher(const std::string& directory, const std::string& compilerCommand = "glslc");
+		~RocketShaderWatcher();
+
+		RocketShaderWatcher(const RocketShaderWatcher&) = delete;
+		RocketShaderWatcher& operator=(const RocketShaderWatcher&) = delete;
+
+		// .spv files recompiled since the last call, as "<directory>/<source>.spv"
+		std::vector<std::string> pollRecompiledShaders();
+
+		static bool isShaderSource(const std::string& filename);
+	private:
+		void watchLoop();
+		void compileShader(const std::string& sourceName);
+
+		std::string directory;
+		std::string compilerCommand;
+		std::atomic<bool> stopping{ false };
+		std::mutex recompiledMutex;
+		std::vector<std::string> recompiled;
+		std::thread watchThread;
+	};
+}
@@ -0,0 +1,232 @@
+#include "rocket_snapshot.hpp"
+#include "rocket_utils.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace rocket {
+	static const char SNAPSHOT_MAGIC[8] = { 'R', 'K', 'T', 'S', 'N', 'A', 'P', '\0' };
+
+	RocketSnapshot::RocketSnapshot(const std::string& filepath) : file{ filepath }
+	{
+		if (file.size() < sizeof(SnapshotHeader)) {
+			throw std::runtime_error("Not a snapshot file: " + filepath);
+		}
+		header = reinterpret_cast<const SnapshotHeader*>(file.data());
+		if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+			throw std::runtime_error("Not a snapshot file: " + filepath);
+		}
+		if (header->version != SNAPSHOT_VERSION || header->headerSize != sizeof(SnapshotHeader) || header->recordSize != sizeof(SnapshotRecord)) {
+			throw std::runtime_error("Unsupported snapshot version " + std::to_string(header->version) + " in " + filepath);
+		}
+		if (header->recordsOffset % alignof(SnapshotRecord) != 0 || header->recordsOffset > file.size() ||
+			header->recordCount > (file.size() - header->recordsOffset) / sizeof(SnapshotRecord)) {
+			throw std::runtime_error("Truncated snapshot file: " + filepath);
+		}
+		// Mapped memory is page aligned, so the records are as aligned as their offset
+		recordData = reinterpret_cast<const SnapshotRecord*>(file.data() + header->recordsOffset);
+	}
+
+	bool RocketSnapshot::verify() const
+	{
+		return hashBytes(recordData, recordCount() * sizeof(SnapshotRecord)) == header->recordsHash;
+	}
+
+	void RocketSnapshot::restore(std::vector<RocketGameObject>& gameObjects, const std::vector<std::shared_ptr<RocketModel>>& models,
+		std::vector<uint32_t>& bodyShapes) const
+	{
+		size_t count = recordCount();
+		for (size_t i = 0; i < count; i++) {
+			const SnapshotRecord& record = recordData[i];
+			if (record.type > static_cast<uint32_t>(RocketGameObjectType::RIGID_BODY)) {
+				throw std::runtime_error("Unknown object type " + std::to_string(record.type) + " in snapshot record " + std::to_string(i));
+			}
+			if (record.type == static_cast<uint32_t>(RocketGameObjectType::RIGID_BODY) && record.shape == SnapshotRecord::NO_SHAPE) {
+				throw std::runtime_error("Rigid body without a shape in snapshot record " + std::to_string(i));
+			}
+		}
+
+		gameObjects.reserve(gameObjects.size() + count);
+		for (size_t i = 0; i < count; i++) {
+			const SnapshotRecord& record = recordData[i];
+			gameObjects.push_back(RocketGameObject::createGameObject());
+			RocketGameObject& object = gameObjects.back();
+			if (record.model < models.size()) {
+				object.model = models[record.model];
+			}
+			object.transform2d.translation = { record.translation[0], record.translation[1] };
+			object.transform2d.scale = { record.scale[0], record.scale[1] };
+			object.transform2d.rotation = record.rotation;
+			object.velocity = { record.velocity[0], record.velocity[1] };
+			object.acceleration = { record.acceleration[0], record.acceleration[1] };
+			object.angularVelocity = record.angularVelocity;
+			object.radius = record.radius;
+			object.mass = record.mass;
+			object.color = { record.color[0], record.color[1], record.color[2] };
+			object.age = record.age;
+			object.lifetime = record.lifetime;
+			object.type = static_cast<RocketGameObjectType>(record.type);
+			if (object.type == RocketGameObjectType::RIGID_BODY) {
+				bodyShapes.push_back(record.shape);
+			}
+			object.gravityApplied = (record.flags & SnapshotRecord::GRAVITY_APPLIED) != 0;
+			object.collisionApplied = (record.flags & SnapshotRecord::COLLISION_APPLIED) != 0;
+			object.sleeping = (record.flags & SnapshotRecord::SLEEPING) != 0;
+			if ((record.flags & SnapshotRecord::EMITTED) != 0) {
+				object.emitter = RocketGameObject::ORPHAN_EMITTER;
+			}
+		}
+	}
+
+	RocketSnapshotWriter::RocketSnapshotWriter(RocketThreadPool& threadPool) : threadPool{ threadPool }
+	{
+	}
+
+	RocketSnapshotWriter::~RocketSnapshotWriter()
+	{
+		wait();
+	}
+
+	bool RocketSnapshotWriter::save(const std::string& filepath, const std::vector<RocketGameObject>& gameObjects, const std::vector<std::shared_ptr<RocketModel>>& models,
+		const std::unordered_map<RocketGameObject::id_t, uint32_t>& bodyShapes)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (writing) {
+				return false;
+			}
+			writing = true;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto records = std::make_shared<std::vector<SnapshotRecord>>();
+		records->reserve(gameObjects.size());
+		for (const auto& object : gameObjects) {
+			if (object.parked()) {
+				continue;
+			}
+			SnapshotRecord record{};
+			record.translation[0] = object.transform2d.translation.x;
+			record.translation[1] = object.transform2d.translation.y;
+			record.velocity[0] = object.velocity.x;
+			record.velocity[1] = object.velocity.y;
+			record.acceleration[0] = object.acceleration.x;
+			record.acceleration[1] = object.acceleration.y;
+			record.scale[0] = object.transform2d.scale.x;
+			record.scale[1] = object.transform2d.scale.y;
+			record.rotation = object.transform2d.rotation;
+			record.angularVelocity = object.angularVelocity;
+			record.radius = object.radius;
+			record.mass = object.mass;
+			record.color[0] = object.color.x;
+			record.color[1] = object.color.y;
+			record.color[2] = object.color.z;
+			record.age = object.age;
+			record.lifetime = object.lifetime;
+			record.model = SnapshotRecord::NO_MODEL;
+			// A null table entry is a model that failed to load, not a match for objects without one
+			for (uint32_t model = 0; object.model != nullptr && model < models.size(); model++) {
+				if (models[model] == object.model) {
+					record.model = model;
+					break;
+				}
+			}
+			record.type = static_cast<uint32_t>(object.type);
+			record.shape = SnapshotRecord::NO_SHAPE;
+			if (object.type == RocketGameObjectType::RIGID_BODY) {
+				auto shape = bodyShapes.find(object.getId());
+				if (shape != bodyShapes.end()) {
+					record.shape = shape->second;
+				}
+			}
+			record.flags = (object.gravityApplied ? SnapshotRecord::GRAVITY_APPLIED : 0) |
+				(object.collisionApplied ? SnapshotRecord::COLLISION_APPLIED : 0) |
+				(object.sleeping ? SnapshotRecord::SLEEPING : 0) |
+				(object.emitter != RocketGameObject::NO_EMITTER ? SnapshotRecord::EMITTED : 0);
+			records->push_back(record);
+		}
+		captureMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		threadPool.submit([this, filepath, records] {
+			write(filepath, *records);
+		});
+		return true;
+	}
+
+	void RocketSnapshotWriter::write(const std::string& filepath, const std::vector<SnapshotRecord>& records)
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::string tempPath = filepath + ".tmp";
+		std::string writeError;
+		{
+			SnapshotHeader header{};
+			std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+			header.version = SNAPSHOT_VERSION;
+			header.headerSize = sizeof(SnapshotHeader);
+			header.recordSize = sizeof(SnapshotRecord);
+			header.recordCount = records.size();
+			header.recordsOffset = sizeof(SnapshotHeader);
+			header.recordsHash = hashBytes(records.data(), records.size() * sizeof(SnapshotRecord));
+
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SnapshotRecord));
+			file.close();
+			if (!file) {
+				writeError = "Failed to write snapshot: " + tempPath;
+			}
+		}
+		if (writeError.empty()) {
+			// Replace the snapshot in one step so readers never see a partially written file
+			std::error_code renameError;
+			std::filesystem::rename(tempPath, filepath, renameError);
+			if (renameError) {
+				writeError = "Failed to replace " + filepath + ": " + renameError.message();
+			}
+		}
+		if (!writeError.empty()) {
+			std::error_code removeError;
+			std::filesystem::remove(tempPath, removeError);
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		error = writeError;
+		recordCount = records.size();
+		writeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		writing = false;
+		finishedCondition.notify_all();
+	}
+
+	void RocketSnapshotWriter::wait()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		finishedCondition.wait(lock, [this] { return !writing; });
+	}
+
+	bool RocketSnapshotWriter::busy()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return writing;
+	}
+
+	std::string RocketSnapshotWriter::lastError()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return error;
+	}
+
+	size_t RocketSnapshotWriter::lastRecordCount()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return recordCount;
+	}
+
+	double RocketSnapshotWriter::lastWriteMilliseconds()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return writeMilliseconds;
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "rocket_mapped_file.hpp"
+#include "rocket_thread_pool.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+	// Snapshot file: a 64 byte header followed by one fixed size record per game object, little endian.
+	// The records start 64 byte aligned, so a mapped file is used in place without any parsing.
+	// Bump SNAPSHOT_VERSION whenever SnapshotRecord changes.
+	static constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t recordSize;
+		uint32_t reserved;
+		uint64_t recordCount;
+		uint64_t recordsOffset;
+		// FNV-1a of the record bytes, checked by RocketSnapshot::verify
+		uint64_t recordsHash;
+		uint8_t padding[16];
+	};
+
+	struct SnapshotRecord {
+		static constexpr uint32_t GRAVITY_APPLIED = 1 << 0;
+		static constexpr uint32_t COLLISION_APPLIED = 1 << 1;
+		static constexpr uint32_t SLEEPING = 1 << 2;
+		// Spawned by an emitter. Emitters are not saved, the object comes back with ORPHAN_EMITTER.
+		static constexpr uint32_t EMITTED = 1 << 3;
+		static constexpr uint32_t NO_MODEL = UINT32_MAX;
+		static constexpr uint32_t NO_SHAPE = UINT32_MAX;
+
+		float translation[2];
+		float velocity[2];
+		float acceleration[2];
+		float scale[2];
+		float rotation;
+		float angularVelocity;
+		float radius;
+		float mass;
+		float color[3];
+		float age;
+		float lifetime;
+		// Index into the model table passed to save and restore
+		uint32_t model;
+		// RocketGameObjectType, restore rejects values it doesn't know
+		uint32_t type;
+		uint32_t flags;
+		// RigidBodySystem shape of a RIGID_BODY object, NO_SHAPE for everything else
+		uint32_t shape;
+	};
+
+	static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+	static_assert(sizeof(SnapshotRecord) == 84, "snapshot record layout changed, bump SNAPSHOT_VERSION");
+	static_assert(std::is_trivially_copyable<SnapshotRecord>::value, "snapshot records are copied as bytes");
+
+	// A mapped snapshot file. The constructor only checks the header, records() points into the mapping.
+	// Throws std::runtime_error for missing, truncated or incompatible files.
+	class RocketSnapshot {
+	public:
+		RocketSnapshot(const std::string& filepath);
+
+		RocketSnapshot(const RocketSnapshot&) = delete;
+		RocketSnapshot& operator=(const RocketSnapshot&) = delete;
+
+		size_t recordCount() const { return static_cast<size_t>(header->recordCount); }
+		const SnapshotRecord* records() const { return recordData; }
+		// Hashes every record, only needed for files that may have been damaged after writing. As slow as
+		// reading the whole file, so loading does not call it unless asked to.
+		bool verify() const;
+
+		// Appends one game object per record, models[record.model] gives the model. bodyShapes gets the
+		// shape of every RIGID_BODY object, in the order they were appended. Throws std::runtime_error
+		// without appending anything if a record has an unknown type or a rigid body without a shape.
+		void restore(std::vector<RocketGameObject>& gameObjects, const std::vector<std::shared_ptr<RocketModel>>& models,
+			std::vector<uint32_t>& bodyShapes) const;
+	private:
+		RocketMappedFile file;
+		const SnapshotHeader* header = nullptr;
+		const SnapshotRecord* recordData = nullptr;
+	};
+
+	// Saves snapshots without stalling the frame: save() copies the game objects into records on the
+	// calling thread and hands the file write to the thread pool. The file is written next to the target
+	// and renamed over it when complete, so readers never see a partial snapshot.
+	class RocketSnapshotWriter {
+	public:
+		RocketSnapshotWriter(RocketThreadPool& threadPool);
+		// Waits for a write still in flight
+		~RocketSnapshotWriter();
+
+		RocketSnapshotWriter(const RocketSnapshotWriter&) = delete;
+		RocketSnapshotWriter& operator=(const RocketSnapshotWriter&) = delete;
+
+		// Returns false without saving while the previous write is still running. Objects parked in an
+		// emitter pool are skipped, emitters and constraints are not part of a snapshot: emitted particles
+		// are flagged EMITTED so they still expire, constrained ones come back as free particles.
+		// bodyShapes gives the shape of each rigid body, see RigidBodySystem::shapesById.
+		bool save(const std::string& filepath, const std::vector<RocketGameObject>& gameObjects, const std::vector<std::shared_ptr<RocketModel>>& models,
+			const std::unordered_map<RocketGameObject::id_t, uint32_t>& bodyShapes);
+		void wait();
+		bool busy();
+
+		// Results of the last finished write
+		std::string lastError();
+		size_t lastRecordCount();
+		double lastCaptureMilliseconds() const { return captureMilliseconds; }
+		double lastWriteMilliseconds();
+	private:
+		void write(const std::string& filepath, const std::vector<SnapshotRecord>& records);
+
+		RocketThreadPool& threadPool;
+		std::mutex mutex;
+		std::condition_variable finishedCondition;
+		bool writing = false;
+		std::string error;
+		size_t recordCount = 0;
+		double captureMilliseconds = 0.0;
+		double writeMilliseconds = 0.0;
+	};
+}
@@ -18,6 +18,13 @@ namespace rocket {
 
     RocketSwapChain::RocketSwapChain(RocketDevice& deviceRef, VkExtent2D extent, std::shared_ptr<RocketSwapChain> previous)
         : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
+        // continue the frame timeline of the previous swap chain so frame values stay monotonic,
+        // without one the timeline starts at 0 like a fresh swap chain
+        if (previous) {
+            previous->waitForFrameValue(previous->frameCounter);
+            frameCounter = previous->frameCounter;
+            completedFrame = previous->frameCounter;
+        }
         init();
         
         // clean up old swap chain since it's no longer needed
@@ -34,6 +41,9 @@ namespace rocket {
     }
 
     RocketSwapChain::~RocketSwapChain() {
+        waitForFrameValue(frameCounter);
+        device.retireFrames(completedFrame, frameCounter + 1);
+
         for (auto imageView : swapChainImageViews) {
             vkDestroyImageView(device.device(), imageView, nullptr);
         }
@@ -47,7 +57,7 @@ namespace rocket {
         for (int i = 0; i < depthImages.size(); i++) {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.freeMemory(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) {
@@ -62,15 +72,13 @@ namespace rocket {
             vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
             vkDestroyFence(device.device(), inFlightFences[i], nullptr);
         }
+        vkDestroySemaphore(device.device(), frameTimeline, nullptr);
     }
 
     VkResult RocketSwapChain::acquireNextImage(uint32_t* imageIndex) {
-        vkWaitForFences(
-            device.device(),
-            1,
-            &inFlightFences[currentFrame],
-            VK_TRUE,
-            std::numeric_limits<uint64_t>::max());
+        waitForFrameValue(frameSignalValues[currentFrame]);
+        // the next submit signals frameCounter + 1, deletions deferred while recording it wait for that
+        device.retireFrames(completedFrame, frameCounter + 1);
 
         VkResult result = vkAcquireNextImageKHR(
             device.device(),
@@ -85,10 +93,11 @@ namespace rocket {
 
     VkResult RocketSwapChain::submitCommandBuffers(
         const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-        if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-        }
-        imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+        // wait until the previous frame that rendered to this image is done
+        waitForFrameValue(imageSignalValues[*imageIndex]);
+        uint64_t signalValue = ++frameCounter;
+        imageSignalValues[*imageIndex] = signalValue;
+        frameSignalValues[currentFrame] = signalValue;
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -102,21 +111,43 @@ namespace rocket {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = buffers;
 
-        VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame], frameTimeline };
+
+        if (useTimelineSemaphore) {
+            // binary semaphores ignore their values, only the timeline entries are read
+            uint64_t waitValues[] = { 0 };
+            uint64_t signalValues[] = { 0, signalValue };
+            VkTimelineSemaphoreSubmitInfo timelineInfo{};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = 1;
+            timelineInfo.pWaitSemaphoreValues = waitValues;
+            timelineInfo.signalSemaphoreValueCount = 2;
+            timelineInfo.pSignalSemaphoreValues = signalValues;
+
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.signalSemaphoreCount = 2;
+            submitInfo.pSignalSemaphores = signalSemaphores;
+
+            if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+        }
+        else {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+            vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+            if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
         }
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
         VkSwapchainKHR swapChains[] = { swapChain };
         presentInfo.swapchainCount = 1;
@@ -131,6 +162,35 @@ namespace rocket {
         return result;
     }
 
+    void RocketSwapChain::waitForFrameValue(uint64_t value) {
+        if (value <= completedFrame) {
+            return;
+        }
+
+        if (useTimelineSemaphore) {
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &frameTimeline;
+            waitInfo.pValues = &value;
+            vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
+        }
+        else {
+            // frames complete in submission order, so waiting on every fence up to value is enough
+            for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                if (frameSignalValues[i] > completedFrame && frameSignalValues[i] <= value) {
+                    vkWaitForFences(
+                        device.device(),
+                        1,
+                        &inFlightFences[i],
+                        VK_TRUE,
+                        std::numeric_limits<uint64_t>::max());
+                }
+            }
+        }
+        completedFrame = value;
+    }
+
     void RocketSwapChain::createSwapChain() {
         SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
@@ -330,7 +390,8 @@ namespace rocket {
                 imageInfo,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 depthImages[i],
-                depthImageMemorys[i]);
+                depthImageMemorys[i],
+                MemoryCategory::DEPTH);
 
             VkImageViewCreateInfo viewInfo{};
             viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -352,8 +413,9 @@ namespace rocket {
     void RocketSwapChain::createSyncObjects() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+        imageSignalValues.resize(imageCount(), frameCounter);
+        frameSignalValues.fill(frameCounter);
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -366,8 +428,31 @@ namespace rocket {
             if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
                 VK_SUCCESS ||
                 vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-                VK_SUCCESS ||
-                vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to create synchronization objects for a frame!");
+            }
+        }
+
+        // one timeline semaphore replaces the per frame fences when the device supports it
+        useTimelineSemaphore = device.supportsTimelineSemaphores();
+        if (useTimelineSemaphore) {
+            VkSemaphoreTypeCreateInfo timelineInfo{};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            timelineInfo.initialValue = frameCounter;
+
+            VkSemaphoreCreateInfo timelineSemaphoreInfo = {};
+            timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            timelineSemaphoreInfo.pNext = &timelineInfo;
+
+            if (vkCreateSemaphore(device.device(), &timelineSemaphoreInfo, nullptr, &frameTimeline) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create frame timeline semaphore!");
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
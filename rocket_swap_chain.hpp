@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
@@ -42,6 +43,10 @@ namespace rocket {
         VkResult acquireNextImage(uint32_t* imageIndex);
         VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
+        // Frame timeline: every submit signals the next value of a monotonically increasing counter.
+        // Finished frames retire the deletions deferred through RocketDevice::deferDeletion.
+        bool usesTimelineSemaphore() const { return useTimelineSemaphore; }
+
         bool compareSwapFormats(const RocketSwapChain& swapChain) const {
             return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
 				swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -54,6 +59,7 @@ namespace rocket {
         void createRenderPass();
         void createFramebuffers();
         void createSyncObjects();
+        void waitForFrameValue(uint64_t value);
 
         // Helper functions
         VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -84,8 +90,14 @@ namespace rocket {
         std::vector<VkSemaphore> imageAvailableSemaphores;
         std::vector<VkSemaphore> renderFinishedSemaphores;
         std::vector<VkFence> inFlightFences;
-        std::vector<VkFence> imagesInFlight;
         size_t currentFrame = 0;
+
+        bool useTimelineSemaphore = false;
+        VkSemaphore frameTimeline = VK_NULL_HANDLE;
+        uint64_t frameCounter = 0;
+        uint64_t completedFrame = 0;
+        std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameSignalValues{};
+        std::vector<uint64_t> imageSignalValues;
     };
 
 }  // namespace rocket
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "rocket_thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace rocket {
+	RocketThreadPool::RocketThreadPool(unsigned int threadCount)
+	{
+		if (threadCount == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		workers.reserve(threadCount);
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back([this] { workerLoop(); });
+		}
+	}
+
+	RocketThreadPool::~RocketThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		taskCondition.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void RocketThreadPool::submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			tasks.push_back(std::move(task));
+		}
+		taskCondition.notify_one();
+	}
+
+	void RocketThreadPool::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		idleCondition.wait(lock, [this] { return tasks.empty() && activeTasks == 0; });
+	}
+
+	void RocketThreadPool::workerLoop()
+	{
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				taskCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) {
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop_front();
+				activeTasks++;
+			}
+
+			task();
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				activeTasks--;
+				if (tasks.empty() && activeTasks == 0) {
+					idleCondition.notify_all();
+				}
+			}
+		}
+	}
+
+	void RocketThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn, size_t minChunk)
+	{
+		if (count == 0) {
+			return;
+		}
+		size_t chunkCount = std::min<size_t>(workers.size() + 1, (count + minChunk - 1) / std::max<size_t>(minChunk, 1));
+		if (chunkCount <= 1) {
+			fn(0, count);
+			return;
+		}
+
+		// Shared with helper tasks that may only start after this call has returned
+		struct Job {
+			std::function<void(size_t, size_t)> fn;
+			size_t count;
+			size_t chunkCount;
+			std::atomic<size_t> nextChunk{ 0 };
+			std::atomic<size_t> doneChunks{ 0 };
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+
+			bool runChunk() {
+				size_t chunk = nextChunk.fetch_add(1);
+				if (chunk >= chunkCount) {
+					return false;
+				}
+				size_t begin = count * chunk / chunkCount;
+				size_t end = count * (chunk + 1) / chunkCount;
+				fn(begin, end);
+				if (doneChunks.fetch_add(1) + 1 == chunkCount) {
+					std::lock_guard<std::mutex> lock{ doneMutex };
+					doneCondition.notify_all();
+				}
+				return true;
+			}
+		};
+		auto job = std::make_shared<Job>();
+		job->fn = fn;
+		job->count = count;
+		job->chunkCount = chunkCount;
+
+		for (size_t i = 1; i < chunkCount; i++) {
+			submit([job] { while (job->runChunk()) {} });
+		}
+		while (job->runChunk()) {}
+
+		std::unique_lock<std::mutex> lock{ job->doneMutex };
+		job->doneCondition.wait(lock, [&job] { return job->doneChunks.load() == job->chunkCount; });
+	}
+}
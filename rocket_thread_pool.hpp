@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rocket {
+	class RocketThreadPool {
+	public:
+		// threadCount 0 uses one worker per hardware thread, minus the calling thread
+		RocketThreadPool(unsigned int threadCount = 0);
+		~RocketThreadPool();
+
+		RocketThreadPool(const RocketThreadPool&) = delete;
+		RocketThreadPool& operator=(const RocketThreadPool&) = delete;
+
+		void submit(std::function<void()> task);
+		void waitIdle();
+
+		// Splits [0, count) into chunks of at least minChunk items and runs fn(begin, end) on the workers
+		// and the calling thread. Returns once every chunk is done. The calling thread keeps taking chunks
+		// itself, so a pool busy with long tasks never blocks it.
+		void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn, size_t minChunk = 256);
+
+		unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()); }
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable taskCondition;
+		std::condition_variable idleCondition;
+		size_t activeTasks = 0;
+		bool stopping = false;
+	};
+}
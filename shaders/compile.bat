@@ -1,2 +1,5 @@
-glslc C:\Users\mario\source\repos\Rocket\shaders\simple_shader.vert -o C:\Users\mario\source\repos\Rocket\shaders\simple_shader.vert.spv
-glslc C:\Users\mario\source\repos\Rocket\shaders\simple_shader.frag -o C:\Users\mario\source\repos\Rocket\shaders\simple_shader.frag.spv
\ No newline at end of file
+glslc %~dp0simple_shader.vert -o %~dp0simple_shader.vert.spv
+glslc %~dp0simple_shader.frag -o %~dp0simple_shader.frag.spv
+glslc %~dp0instanced_shader.vert -o %~dp0instanced_shader.vert.spv
+glslc %~dp0instanced_shader.frag -o %~dp0instanced_shader.frag.spv
+glslc %~dp0build_draws.comp -o %~dp0build_draws.comp.spv
\ No newline at end of file
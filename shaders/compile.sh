@@ -0,0 +1,7 @@
+#!/bin/sh
+# Compiles every shader next to this script, same as compile.bat
+cd "$(dirname "$0")" || exit 1
+for shader in *.vert *.frag *.comp; do
+	[ -e "$shader" ] || continue
+	glslc "$shader" -o "$shader.spv" || exit 1
+done
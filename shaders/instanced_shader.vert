@@ -0,0 +1,52 @@
+#version 450
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec3 color;
+
+layout (location = 0) out vec3 fragColor;
+
+// InstanceData in instanced_render_system.hpp
+struct InstanceData {
+	vec4 transform;
+	vec2 offset;
+	uint color;
+	uint batch;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer Instances {
+	InstanceData instances[];
+};
+
+// Object indices written by build_draws.comp, only read by the INDIRECT variant
+layout (std430, set = 0, binding = 3) readonly buffer Visible {
+	uint visible[];
+};
+
+// Only read by the INDIRECT variant
+layout (push_constant) uniform Push {
+	// World to clip space: (position - viewCenter) * viewScale
+	vec2 viewCenter;
+	vec2 viewScale;
+	// Where the batch's range of visible starts. Passed here instead of as the draw's firstInstance, which
+	// indirect draws only honour with the drawIndirectFirstInstance feature.
+	uint firstInstance;
+} push;
+
+// ShaderConstantId in rocket_pipeline.hpp
+layout (constant_id = 0) const bool USE_VERTEX_COLOR = false;
+layout (constant_id = 1) const bool INDIRECT = false;
+
+void main(){
+	InstanceData instance;
+	if (INDIRECT) {
+		instance = instances[visible[push.firstInstance + gl_InstanceIndex]];
+	}
+	else {
+		// gl_InstanceIndex starts at the firstInstance of the draw, which is where its objects begin
+		instance = instances[gl_InstanceIndex];
+	}
+	mat2 transform = mat2(instance.transform.xy, instance.transform.zw);
+	vec2 world = transform * position + instance.offset;
+	gl_Position = vec4(INDIRECT ? (world - push.viewCenter) * push.viewScale : world, 0.0, 1.0);
+	fragColor = USE_VERTEX_COLOR ? color : unpackUnorm4x8(instance.color).rgb;
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "sleep_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rocket {
+	static bool sleepCandidate(const RocketGameObject& object)
+	{
+		// Constrained objects are integrated by ConstraintSolver, whose rest state depends on the whole body
+		return object.type == RocketGameObjectType::PARTICLE && !object.constraintsApplied;
+	}
+
+	void SleepSystem::resizeGrid()
+	{
+		int width = std::max(1, static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / cellSize)));
+		int height = std::max(1, static_cast<int>(std::ceil((boundsMax.y - boundsMin.y) / cellSize)));
+		if (width == gridWidth && height == gridHeight) {
+			return;
+		}
+		gridWidth = width;
+		gridHeight = height;
+		size_t cellCount = static_cast<size_t>(width) * height;
+		cellRestTime.assign(cellCount, 0.0f);
+		cellSleeping.assign(cellCount, 0);
+		cellWoken.assign(cellCount, 0);
+	}
+
+	void SleepSystem::reset()
+	{
+		std::fill(cellRestTime.begin(), cellRestTime.end(), 0.0f);
+		std::fill(cellSleeping.begin(), cellSleeping.end(), 0);
+		std::fill(cellWoken.begin(), cellWoken.end(), 0);
+		sleepingCount = 0;
+		sleepingCellCount = 0;
+		hiddenCount = 0;
+	}
+
+	uint32_t SleepSystem::cellIndex(glm::vec2 position) const
+	{
+		int x = static_cast<int>(std::floor((position.x - boundsMin.x) / cellSize));
+		int y = static_cast<int>(std::floor((position.y - boundsMin.y) / cellSize));
+		x = std::min(std::max(x, 0), gridWidth - 1);
+		y = std::min(std::max(y, 0), gridHeight - 1);
+		return static_cast<uint32_t>(y * gridWidth + x);
+	}
+
+	void SleepSystem::updateSleep(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		resizeGrid();
+		size_t cellCount = cellRestTime.size();
+		cellMaxSpeed.assign(cellCount, 0.0f);
+		cellHasAwake.assign(cellCount, 0);
+		cellOccupied.assign(cellCount, 0);
+
+		for (const auto& object : gameObjects) {
+			if (!sleepCandidate(object)) {
+				continue;
+			}
+			uint32_t cell = cellIndex(object.transform2d.translation);
+			cellOccupied[cell] = 1;
+			if (!object.sleeping) {
+				cellHasAwake[cell] = 1;
+				cellMaxSpeed[cell] = std::max(cellMaxSpeed[cell], glm::length(object.velocity));
+			}
+		}
+
+		// Wake sleeping cells that were entered by an awake particle, touched by wake() or border a fast cell
+		for (int y = 0; y < gridHeight; y++) {
+			for (int x = 0; x < gridWidth; x++) {
+				uint32_t cell = y * gridWidth + x;
+				if (!cellSleeping[cell]) {
+					continue;
+				}
+				bool woken = cellHasAwake[cell] || cellWoken[cell];
+				for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, gridHeight - 1) && !woken; ny++) {
+					for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, gridWidth - 1); nx++) {
+						if (cellMaxSpeed[ny * gridWidth + nx] > wakeSpeed) {
+							woken = true;
+							break;
+						}
+					}
+				}
+				if (woken) {
+					cellSleeping[cell] = 0;
+					cellRestTime[cell] = 0.0f;
+					cellWoken[cell] = 1;
+				}
+			}
+		}
+
+		// Advance the rest timers of awake cells, empty cells never sleep
+		sleepingCellCount = 0;
+		for (size_t cell = 0; cell < cellCount; cell++) {
+			if (!cellSleeping[cell]) {
+				if (cellOccupied[cell] && cellMaxSpeed[cell] < sleepSpeed) {
+					cellRestTime[cell] += dt;
+				}
+				else {
+					cellRestTime[cell] = 0.0f;
+				}
+				if (cellRestTime[cell] >= timeToSleep) {
+					cellSleeping[cell] = 1;
+				}
+			}
+			sleepingCellCount += cellSleeping[cell];
+		}
+
+		sleepingCount = 0;
+		for (auto& object : gameObjects) {
+			if (!sleepCandidate(object)) {
+				continue;
+			}
+			uint32_t cell = cellIndex(object.transform2d.translation);
+			if (cellSleeping[cell]) {
+				if (!object.sleeping) {
+					object.sleeping = true;
+					object.velocity = glm::vec2{ 0.0f };
+				}
+				sleepingCount++;
+			}
+			else if (object.sleeping) {
+				// Covers cells woken this update as well as particles that drifted out of a sleeping cell
+				object.sleeping = false;
+			}
+		}
+		std::fill(cellWoken.begin(), cellWoken.end(), 0);
+	}
+
+	void SleepSystem::hideSleeping(std::vector<RocketGameObject>& gameObjects)
+	{
+		hiddenIndices.clear();
+		heldParticles.clear();
+		if (sleepingCount == 0) {
+			hiddenCount = 0;
+			return;
+		}
+		resizeGrid();
+		cellHasAwake.assign(cellRestTime.size(), 0);
+		for (const auto& object : gameObjects) {
+			if (object.type == RocketGameObjectType::PARTICLE && !object.sleeping) {
+				cellHasAwake[cellIndex(object.transform2d.translation)] = 1;
+			}
+		}
+
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			auto& object = gameObjects[i];
+			if (!object.sleeping || !sleepCandidate(object)) {
+				continue;
+			}
+			uint32_t cell = cellIndex(object.transform2d.translation);
+			int x = static_cast<int>(cell % gridWidth);
+			int y = static_cast<int>(cell / gridWidth);
+			bool awakeNearby = false;
+			for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, gridHeight - 1) && !awakeNearby; ny++) {
+				for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, gridWidth - 1); nx++) {
+					if (cellHasAwake[ny * gridWidth + nx]) {
+						awakeNearby = true;
+						break;
+					}
+				}
+			}
+			if (awakeNearby) {
+				// Still a collider for the awake particles, but it doesn't move until its cell wakes
+				heldParticles.push_back({ i, object.transform2d.translation });
+			}
+			else {
+				object.type = RocketGameObjectType::NONE;
+				hiddenIndices.push_back(i);
+			}
+		}
+		hiddenCount = hiddenIndices.size();
+	}
+
+	void SleepSystem::restoreSleeping(std::vector<RocketGameObject>& gameObjects)
+	{
+		for (uint32_t index : hiddenIndices) {
+			gameObjects[index].type = RocketGameObjectType::PARTICLE;
+		}
+		for (const auto& held : heldParticles) {
+			gameObjects[held.index].transform2d.translation = held.translation;
+			gameObjects[held.index].velocity = glm::vec2{ 0.0f };
+		}
+		hiddenIndices.clear();
+		heldParticles.clear();
+	}
+
+	void SleepSystem::wake(glm::vec2 position, float radius)
+	{
+		resizeGrid();
+		uint32_t lower = cellIndex(position - glm::vec2(radius));
+		uint32_t upper = cellIndex(position + glm::vec2(radius));
+		for (uint32_t y = lower / gridWidth; y <= upper / gridWidth; y++) {
+			for (uint32_t x = lower % gridWidth; x <= upper % gridWidth; x++) {
+				cellWoken[y * gridWidth + x] = 1;
+			}
+		}
+	}
+
+	void SleepSystem::wakeAll(std::vector<RocketGameObject>& gameObjects)
+	{
+		restoreSleeping(gameObjects);
+		std::fill(cellSleeping.begin(), cellSleeping.end(), 0);
+		std::fill(cellRestTime.begin(), cellRestTime.end(), 0.0f);
+		for (auto& object : gameObjects) {
+			object.sleeping = false;
+		}
+		sleepingCount = 0;
+		sleepingCellCount = 0;
+		hiddenCount = 0;
+	}
+}
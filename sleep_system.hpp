@@ -0,0 +1,74 @@
+#pragma once
+#include "rocket_game_object.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rocket {
+	// Puts settled regions of PARTICLE objects to sleep. The bounds are split into cells, a cell whose
+	// particles all stayed below sleepSpeed for timeToSleep seconds marks them sleeping (and zeroes their
+	// velocity). FluidSystem, ContinuousCollisionSystem and WorldColliders skip sleeping objects.
+	// PhysicsSystem has no flag for it, so hideSleeping() hands it sleeping particles as type NONE, which it
+	// skips in integration and pair tests. Sleepers next to a cell with awake particles stay visible so the
+	// awake ones still collide with them, and restoreSleeping() puts them back where they were.
+	// A sleeping cell wakes when an awake particle enters it, when a neighbouring cell moves faster than
+	// wakeSpeed, or through wake() (mouse drag).
+	class SleepSystem {
+	public:
+		SleepSystem() = default;
+
+		SleepSystem(const SleepSystem&) = delete;
+		SleepSystem& operator=(const SleepSystem&) = delete;
+
+		// Call after the simulation step
+		void updateSleep(float dt, std::vector<RocketGameObject>& gameObjects);
+		// Around PhysicsSystem::updatePhysics, nothing in between may add, remove or reorder objects
+		void hideSleeping(std::vector<RocketGameObject>& gameObjects);
+		void restoreSleeping(std::vector<RocketGameObject>& gameObjects);
+		void wake(glm::vec2 position, float radius);
+		void wakeAll(std::vector<RocketGameObject>& gameObjects);
+		// Forgets every cell's rest time, for a scene that starts over
+		void reset();
+
+		float cellSize = 0.05f;
+		float sleepSpeed = 0.05f;
+		float wakeSpeed = 0.2f;
+		float timeToSleep = 0.5f;
+		glm::vec2 boundsMin{ -1.0f, -1.0f };
+		glm::vec2 boundsMax{ 1.0f, 1.0f };
+
+		size_t sleepingParticles() const { return sleepingCount; }
+		size_t sleepingCells() const { return sleepingCellCount; }
+		// Sleeping particles PhysicsSystem skipped in the last step
+		size_t hiddenParticles() const { return hiddenCount; }
+	private:
+		struct HeldParticle {
+			uint32_t index;
+			glm::vec2 translation;
+		};
+
+		uint32_t cellIndex(glm::vec2 position) const;
+		void resizeGrid();
+
+		int gridWidth = 0;
+		int gridHeight = 0;
+		std::vector<float> cellRestTime;
+		std::vector<uint8_t> cellSleeping;
+		// Cells woken by wake() since the last update, their particles are woken there
+		std::vector<uint8_t> cellWoken;
+
+		// Per update scratch
+		std::vector<float> cellMaxSpeed;
+		std::vector<uint8_t> cellHasAwake;
+		std::vector<uint8_t> cellOccupied;
+
+		// Between hideSleeping() and restoreSleeping()
+		std::vector<uint32_t> hiddenIndices;
+		std::vector<HeldParticle> heldParticles;
+
+		size_t sleepingCount = 0;
+		size_t sleepingCellCount = 0;
+		size_t hiddenCount = 0;
+	};
+}
@@ -0,0 +1,58 @@
+#include "transform_system.hpp"
+
+#include <chrono>
+
+namespace rocket {
+	void sinCosBatch(const float* angles, float* sines, float* cosines, size_t count)
+	{
+		// pi/2 split in three with short leading parts, so quadrant * part is exact (Cody-Waite reduction)
+		const float twoOverPi = 0.636619772f;
+		const float halfPi1 = 1.5703125f;
+		const float halfPi2 = 4.83751297e-4f;
+		const float halfPi3 = 7.54978995e-8f;
+		// 1.5 * 2^23, adding it leaves no fraction bits so the sum is rounded to an integer. Keeps the
+		// loop free of library calls so it vectorises.
+		const float roundingBias = 12582912.0f;
+		for (size_t i = 0; i < count; i++) {
+			float x = angles[i];
+			float quadrant = (x * twoOverPi + roundingBias) - roundingBias;
+			float r = ((x - quadrant * halfPi1) - quadrant * halfPi2) - quadrant * halfPi3;
+			float r2 = r * r;
+			// Taylor series, accurate to float precision on [-pi/4, pi/4]
+			float s = r + r * r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f)));
+			float c = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+
+			// Quadrant k: sin = s, c, -s, -c and cos = c, -s, -c, s
+			int k = static_cast<int>(quadrant) & 3;
+			float sinValue = (k & 1) ? c : s;
+			float cosValue = (k & 1) ? s : c;
+			sines[i] = (k & 2) ? -sinValue : sinValue;
+			cosines[i] = ((k + 1) & 2) ? -cosValue : cosValue;
+		}
+	}
+
+	void TransformSystem::updateTransforms(std::vector<RocketGameObject>& gameObjects)
+	{
+		auto start = std::chrono::steady_clock::now();
+		objectIndices.clear();
+		rotations.clear();
+		for (uint32_t i = 0; i < gameObjects.size(); i++) {
+			const Transform2dComponent& transform = gameObjects[i].transform2d;
+			if (transform.dirty()) {
+				objectIndices.push_back(i);
+				rotations.push_back(transform.rotation);
+			}
+		}
+
+		size_t count = objectIndices.size();
+		sines.resize(count);
+		cosines.resize(count);
+		sinCosBatch(rotations.data(), sines.data(), cosines.data(), count);
+		for (size_t i = 0; i < count; i++) {
+			gameObjects[objectIndices[i]].transform2d.setMatrix(sines[i], cosines[i]);
+		}
+
+		updatedCount = count;
+		lastUpdateTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
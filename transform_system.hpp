@@ -0,0 +1,38 @@
+#pragma once
+#include "rocket_game_object.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace rocket {
+	// Sine and cosine of count angles. Polynomials on the angle reduced to [-pi/4, pi/4], the quadrant is
+	// rounded by adding and subtracting 1.5 * 2^23, so there are no library calls and the loop vectorises.
+	// Measured against double precision sin and cos, absolute error stays below 4e-7 for angles in
+	// [-1e4, 1e4]; it grows with the angle past that (3e-2 at 1e6).
+	void sinCosBatch(const float* angles, float* sines, float* cosines, size_t count);
+
+	// Rebuilds the cached matrices of transforms whose rotation or scale changed. The changed rotations
+	// are gathered into one array, run through sinCosBatch and scattered back, so rendering afterwards
+	// only reads the cached matrices.
+	class TransformSystem {
+	public:
+		TransformSystem() = default;
+
+		TransformSystem(const TransformSystem&) = delete;
+		TransformSystem& operator=(const TransformSystem&) = delete;
+
+		// Call after the simulation step, before rendering
+		void updateTransforms(std::vector<RocketGameObject>& gameObjects);
+
+		size_t updatedTransforms() const { return updatedCount; }
+		double updateMilliseconds() const { return lastUpdateTime; }
+	private:
+		std::vector<uint32_t> objectIndices;
+		std::vector<float> rotations;
+		std::vector<float> sines;
+		std::vector<float> cosines;
+
+		size_t updatedCount = 0;
+		double lastUpdateTime = 0.0;
+	};
+}
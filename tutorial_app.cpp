@@ -1,5 +1,7 @@
 #include "tutorial_app.hpp"
 #include "simple_render_system.hpp"
+#include "instanced_render_system.hpp"
+#include "indirect_render_system.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -9,15 +11,17 @@
 #include <iostream>
 #include <stdexcept>
 #include <array>
+#include <algorithm>
 #include <particle.hpp>
 #include <physics_system.hpp>
-#include <random>
+#include <chrono>
+#include <cstdlib>
 
 namespace rocket {
-	static std::default_random_engine generator;
-	TutorialApp::TutorialApp()
+	TutorialApp::TutorialApp(bool demoLevel)
 	{
 		loadGameObjects();
+		setDemoLevel(demoLevel);
 	}
 	TutorialApp::~TutorialApp()
 	{
@@ -26,12 +30,21 @@ namespace rocket {
 	{
 		std::cout << "Starting Tutorial App." << std::endl;
 		SimpleRenderSystem simpleRenderSystem(rocketDevice, rocketRenderer.getSwapChainRenderPass());
+		InstancedRenderSystem instancedRenderSystem{ rocketDevice, pipelineManager, rocketRenderer.getSwapChainRenderPass() };
+		// Loads build_draws.comp.spv as it is created, so only once the GPU driven path is picked
+		std::unique_ptr<IndirectRenderSystem> indirectRenderSystem;
 
 		//uint32_t testBallPosition = createParticle({ 0.f, 0.f });
 		//gameObjects[testBallPosition].acceleration = glm::vec2(0.0f, 2.0f);
 		while (!rocketWindow.shouldClose()) {
 			glfwPollEvents();
 
+			// Frame boundary, swap in pipelines rebuilt from edited shaders
+			for (const auto& spvPath : shaderWatcher.pollRecompiledShaders()) {
+				pipelineManager.reloadShader(spvPath);
+			}
+			pipelineManager.applyReloads();
+
 			// Start the Dear ImGui frame
 			ImGui_ImplVulkan_NewFrame();
 			ImGui_ImplGlfw_NewFrame();
@@ -50,28 +63,73 @@ namespace rocket {
 				ImGui::SliderInt("Number of particles to add", &i,0, 100);            // Edit 1 float using a slider from 0.0f to 1.0f
 
 				if (ImGui::Button("Clear Simulation")) {
-					clearSimulation();
+					applyInput({ InputCommandType::CLEAR });
 					particleCounter = 0;
 				}                        // Buttons return true when clicked (most widgets return true when edited/activated)
 				float mouseX = 2 * (ImGui::GetMousePos().x / WIDTH - 0.5f);
 				float mouseY = 2 * (ImGui::GetMousePos().y / HEIGHT - 0.5f);
+				if (renderPath == RenderPath::INDIRECT) {
+					// Only the GPU driven path draws the zoomed view, the mouse points into it
+					mouseX = viewCenter.x + mouseX / viewZoom;
+					mouseY = viewCenter.y + mouseY / viewZoom;
+				}
 				//glm::vec2 testPaticlePosition = gameObjects[testBallPosition].transform2d.translation;
 				//float testPaticleRadius = gameObjects[testBallPosition].radius;
 				if (ImGui::IsMouseClicked(1)) {
-					
-					for (int j = 0; j < i; j++) {
-						createParticle({ mouseX, mouseY });
-						particleCounter++;
-					}
+					applyInput({ InputCommandType::SPAWN, static_cast<uint32_t>(i), { mouseX, mouseY } });
+					particleCounter += i;
 				}
 				if (ImGui::IsMouseDown(0)) {
-					uint32_t selectedParticle = getSelectedParticle(mouseX, mouseY);
-					if (selectedParticle != -1) {
-						gameObjects[getParticleIndex(selectedParticle)].transform2d.translation = {mouseX, mouseY};
+					applyInput({ InputCommandType::DRAG, 0, { mouseX, mouseY } });
+				}
+				ImGui::Text("counter = %d", particleCounter);
+				ImGui::Checkbox("Continuous collision", &continuousCollision);
+				bool demoLevel = levelModel != nullptr;
+				if (ImGui::Checkbox("Demo level", &demoLevel)) {
+					setDemoLevel(demoLevel);
+				}
+				ImGui::Checkbox("World colliders from distance field", &worldColliders.useDistanceField);
+				ImGui::Text("%d fast particles, %d speculative contacts",
+					static_cast<int>(continuousCollisionSystem.fastParticles()),
+					static_cast<int>(continuousCollisionSystem.speculativeContacts()));
 
+				int path = static_cast<int>(renderPath);
+				ImGui::RadioButton("Push constants", &path, static_cast<int>(RenderPath::SIMPLE));
+				ImGui::SameLine();
+				ImGui::RadioButton("Instanced", &path, static_cast<int>(RenderPath::INSTANCED));
+				ImGui::SameLine();
+				ImGui::RadioButton("GPU driven", &path, static_cast<int>(RenderPath::INDIRECT));
+				renderPath = static_cast<RenderPath>(path);
+				if (renderPath == RenderPath::INDIRECT && !indirectRenderSystem) {
+					try {
+						indirectRenderSystem = std::make_unique<IndirectRenderSystem>(rocketDevice, pipelineManager, rocketRenderer.getSwapChainRenderPass());
+					}
+					catch (const std::exception& e) {
+						std::cerr << e.what() << std::endl;
+						renderPath = RenderPath::SIMPLE;
 					}
 				}
-				ImGui::Text("counter = %d", particleCounter);
+				if (renderPath == RenderPath::INSTANCED) {
+					ImGui::Checkbox("Vertex colours", &instancedRenderSystem.useVertexColor);
+					ImGui::Text("%d objects in %d draws (%d model runs unsorted), recorded in %.3f ms",
+						static_cast<int>(instancedRenderSystem.instances()),
+						static_cast<int>(instancedRenderSystem.drawCalls()),
+						static_cast<int>(instancedRenderSystem.unsortedRuns()),
+						instancedRenderSystem.recordMilliseconds());
+				}
+				else if (renderPath == RenderPath::INDIRECT) {
+					ImGui::Checkbox("Vertex colours", &indirectRenderSystem->useVertexColor);
+					ImGui::SliderFloat("Zoom", &viewZoom, 1.0f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+					ImGui::SliderFloat2("View centre", &viewCenter.x, -1.0f, 1.0f);
+					ImGui::Text("%d objects in %d indirect draws, prepared in %.3f ms",
+						static_cast<int>(indirectRenderSystem->objects()),
+						static_cast<int>(indirectRenderSystem->batches()),
+						indirectRenderSystem->prepareMilliseconds());
+					ImGui::Text("%d visible after culling", static_cast<int>(indirectRenderSystem->visibleObjects()));
+				}
+				ImGui::Text("%d transforms rebuilt in %.3f ms",
+					static_cast<int>(transformSystem.updatedTransforms()),
+					transformSystem.updateMilliseconds());
 
 				ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 				ImGui::Text("Mouse position is %.3f x, %0.3f y", mouseX, mouseY);
@@ -80,20 +138,102 @@ namespace rocket {
 
 				ImGui::End();
 			}
+			drawMemoryWindow();
+			drawFluidWindow();
+			drawConstraintWindow();
+			drawSleepWindow();
+			drawRigidBodyWindow();
+			drawBroadphaseWindow();
+			drawReorderWindow();
+			drawSpawnWindow();
+			drawEmitterWindow();
+			drawSnapshotWindow();
+			drawInputRecordingWindow();
+			drawMeshWindow();
 
 			// Imgui render
 			ImGui::Render();
 
 			if (auto commandBuffer = rocketRenderer.beginFrame()) {
+				float frameTime = 1 / ImGui::GetIO().Framerate;
+				stepSimulation(frameTime);
+				if (recordingInput) {
+					inputLog.endFrame(frameTime, hashSimulationState(gameObjects));
+				}
+				if (recordingBroadphase) {
+					broadphaseRecording.recordFrame(gameObjects);
+				}
+				// The render system reads the cached matrices, only changed rotations and scales cost trigonometry
+				transformSystem.updateTransforms(gameObjects);
+				// Compute work has to be recorded before the render pass begins
+				if (renderPath == RenderPath::INDIRECT) {
+					indirectRenderSystem->viewCenter = viewCenter;
+					indirectRenderSystem->viewHalfExtent = glm::vec2(1.0f / viewZoom);
+					indirectRenderSystem->prepare(commandBuffer, gameObjects);
+				}
 				rocketRenderer.beginSwapChainRenderPass(commandBuffer);
-				physicsSystem.updatePhysics(1/ ImGui::GetIO().Framerate, gameObjects);
-				simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects);
+				switch (renderPath) {
+				case RenderPath::SIMPLE:
+					simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects);
+					break;
+				case RenderPath::INSTANCED:
+					instancedRenderSystem.renderGameObjects(commandBuffer, gameObjects);
+					break;
+				case RenderPath::INDIRECT:
+					indirectRenderSystem->render(commandBuffer);
+					break;
+				}
 				ImDrawData* draw_data = ImGui::GetDrawData();
 				ImGui_ImplVulkan_RenderDrawData(draw_data, rocketRenderer.getCurrentCommandBuffer());
 				rocketRenderer.endSwapChainRenderPass(commandBuffer);
 				rocketRenderer.endFrame();
 			}
 		}
+		shutdownImgui();
+	}
+
+	int TutorialApp::replay(const std::string& logPath)
+	{
+		std::cout << "Replaying " << logPath << std::endl;
+		InputLog log;
+		log.load(logPath);
+		recordingInput = false;
+		applySimulationSettings(log.settings());
+		restartSimulation(log.seed());
+
+		size_t divergedFrames = 0;
+		size_t firstDivergence = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t frameIndex = 0; frameIndex < log.frameCount(); frameIndex++) {
+			const InputLog::Frame& frame = log.frame(frameIndex);
+			const InputCommand* commands = log.frameCommands(frameIndex);
+			for (uint32_t i = 0; i < frame.commandCount; i++) {
+				applyInput(commands[i]);
+			}
+			stepSimulation(frame.dt);
+			if (hashSimulationState(gameObjects) != frame.stateHash) {
+				if (divergedFrames == 0) {
+					firstDivergence = frameIndex;
+				}
+				divergedFrames++;
+			}
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << log.frameCount() << " frames in " << milliseconds << " ms ("
+			<< milliseconds / std::max<size_t>(log.frameCount(), 1) << " ms/frame), " << gameObjects.size() << " objects at the end" << std::endl;
+		shutdownImgui();
+		if (divergedFrames > 0) {
+			std::cout << "State diverged from the recording at frame " << firstDivergence << ", "
+				<< divergedFrames << " frames differ" << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Every frame matched the recording" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	void TutorialApp::shutdownImgui()
+	{
 		vkDeviceWaitIdle(rocketDevice.device());
 		ImGui_ImplVulkan_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -101,8 +241,66 @@ namespace rocket {
 		vkDeviceWaitIdle(rocketDevice.device());
 
 		vkDestroyDescriptorPool(rocketDevice.device(), rocketDevice.getDescriptorPool(), nullptr);
+	}
 
+	void TutorialApp::stepSimulation(float dt)
+	{
+		if (reorderEnabled) {
+			particleReorder.update(gameObjects);
+		}
+		emitterSystem.updateEmitters(dt, gameObjects);
+		if (fluidMode) {
+			fluidSystem.updateFluid(dt, gameObjects);
+		}
+		else {
+			// Clamps fast particles to their first contact, so a dt spike cannot tunnel them through others
+			if (continuousCollision) {
+				continuousCollisionSystem.applySpeculativeContacts(dt, gameObjects);
+			}
+			// PhysicsSystem integrates constrained particles too, the solver puts them back and integrates them once
+			constraintSolver.holdParticles(gameObjects);
+			// Settled particles are left out of integration and pair tests
+			if (sleepEnabled) {
+				sleepSystem.hideSleeping(gameObjects);
+			}
+			auto physicsStart = std::chrono::steady_clock::now();
+			physicsSystem.updatePhysics(dt, gameObjects);
+			double physicsMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - physicsStart).count();
+			double& average = reorderEnabled ? physicsMillisecondsReordered : physicsMillisecondsUnordered;
+			average = average == 0.0 ? physicsMilliseconds : average + 0.05 * (physicsMilliseconds - average);
+			sleepSystem.restoreSleeping(gameObjects);
+		}
+		constraintSolver.solveConstraints(dt, gameObjects);
+		worldColliders.resolveParticles(dt, gameObjects);
+		rigidBodySystem.updateRigidBodies(dt, gameObjects);
+		if (sleepEnabled) {
+			sleepSystem.updateSleep(dt, gameObjects);
+		}
+	}
 
+	void TutorialApp::applyInput(const InputCommand& command)
+	{
+		if (recordingInput) {
+			inputLog.addCommand(command);
+		}
+		switch (command.type) {
+		case InputCommandType::SPAWN:
+			spawnParticles(command.count, SpawnShape::box(command.position, glm::vec2(0.1f)), SpawnDistribution::UNIFORM);
+			break;
+		case InputCommandType::DRAG: {
+			uint32_t selectedParticle = getSelectedParticle(command.position.x, command.position.y);
+			if (selectedParticle != -1) {
+				auto& particle = gameObjects[getParticleIndex(selectedParticle)];
+				particle.transform2d.translation = command.position;
+				particle.sleeping = false;
+				sleepSystem.wake(command.position, 2 * particle.radius);
+			}
+			break;
+		}
+		case InputCommandType::CLEAR:
+			clearSimulation();
+			break;
+		}
 	}
 
 
@@ -110,35 +308,239 @@ namespace rocket {
 	{
 
 		auto verticies = Particle::createParticleVerticies(0.01f, {0.0f, 0.0f});
-		circleModel = std::make_shared<RocketModel>(rocketDevice, verticies);
-		
+		circleModel = std::make_shared<RocketModel>(geometryArena, verticies);
+		loadRigidBodyShapes();
+		// Loaded up front so snapshots can always resolve the mesh entry of snapshotModels()
+		loadMeshModel();
+	}
+
+	void TutorialApp::loadMeshModel()
+	{
+		static const std::string meshPath = "models/rocket.obj";
+
+		std::shared_ptr<RocketModel> loaded;
+		try {
+			loaded = loadMesh(geometryArena, meshPath, &meshLoadInfo);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return;
+		}
+		if (meshModel != nullptr) {
+			for (auto& object : gameObjects) {
+				if (object.model == meshModel) {
+					object.model = loaded;
+				}
+			}
+		}
+		// The last reference to the old mesh frees its arena range, after the frames in flight (see RocketGeometryArena::free)
+		meshModel = std::move(loaded);
+	}
+
+	void TutorialApp::setDemoLevel(bool enabled)
+	{
+		if (enabled == (levelModel != nullptr)) {
+			return;
+		}
+		if (enabled) {
+			loadLevel();
+			return;
+		}
+		worldColliders.clear();
+		gameObjects.erase(
+			std::remove_if(gameObjects.begin(), gameObjects.end(),
+				[this](const RocketGameObject& object) { return object.model == levelModel; }),
+			gameObjects.end());
+		levelModel = nullptr;
+	}
+
+	void TutorialApp::loadLevel()
+	{
+		// Funnel above a rolling floor made of many short segments, plus a few solid shapes
+		worldColliders.addSegment({ -0.9f, -0.3f }, { -0.15f, 0.1f });
+		worldColliders.addSegment({ 0.9f, -0.3f }, { 0.15f, 0.1f });
+		worldColliders.addCapsule({ 0.3f, 0.35f }, { 0.6f, 0.45f }, 0.03f);
+		worldColliders.addPolygon({ { -0.6f, 0.3f }, { -0.3f, 0.3f }, { -0.3f, 0.5f }, { -0.45f, 0.4f }, { -0.6f, 0.5f } });
+		const int floorSegments = 2000;
+		glm::vec2 previous{ -1.0f, 0.85f };
+		for (int i = 1; i <= floorSegments; i++) {
+			float x = -1.0f + 2.0f * i / floorSegments;
+			glm::vec2 next{ x, 0.85f + 0.04f * glm::sin(x * 15.0f) };
+			worldColliders.addSegment(previous, next);
+			previous = next;
+		}
+		worldColliders.build();
+		worldColliders.bakeDistanceField({ -1.0f, -1.0f }, { 1.0f, 1.0f }, 0.01f);
+
+		std::vector<RocketModel::Vertex> vertices;
+		for (const auto& position : worldColliders.buildTriangles(0.006f)) {
+			vertices.push_back({ position, { 0.6f, 0.6f, 0.6f } });
+		}
+		levelModel = std::make_shared<RocketModel>(geometryArena, vertices);
+		addLevelObject();
+	}
+
+	void TutorialApp::addLevelObject()
+	{
+		RocketGameObject level = RocketGameObject::createGameObject();
+		level.model = levelModel;
+		level.color = { 0.6f, 0.6f, 0.6f };
+		level.transform2d.rotation = 0.0f;
+		gameObjects.push_back(std::move(level));
+	}
+
+	// Triangle list model of a convex polygon, fanned from the first vertex
+	static std::shared_ptr<RocketModel> createPolygonModel(RocketGeometryArena& arena, const ConvexPolygon& polygon, glm::vec3 color)
+	{
+		std::vector<RocketModel::Vertex> vertices;
+		for (size_t i = 1; i + 1 < polygon.vertices.size(); i++) {
+			vertices.push_back({ polygon.vertices[0], color });
+			vertices.push_back({ polygon.vertices[i], color });
+			vertices.push_back({ polygon.vertices[i + 1], color });
+		}
+		return std::make_shared<RocketModel>(arena, vertices);
+	}
+
+	void TutorialApp::loadRigidBodyShapes()
+	{
+		boxShape = rigidBodySystem.addShape(ConvexPolygon::createBox({ 0.02f, 0.02f }));
+		groundShape = rigidBodySystem.addShape(ConvexPolygon::createBox({ 0.35f, 0.02f }));
+		boxModel = createPolygonModel(geometryArena, rigidBodySystem.getShape(boxShape), { 0.8f, 0.5f, 0.2f });
+		groundModel = createPolygonModel(geometryArena, rigidBodySystem.getShape(groundShape), { 0.4f, 0.4f, 0.4f });
+	}
+
+	void TutorialApp::addRigidBodyGround()
+	{
+		RocketGameObject ground = RocketGameObject::createGameObject();
+		ground.model = groundModel;
+		ground.color = { 0.4f, 0.4f, 0.4f };
+		ground.type = RocketGameObjectType::RIGID_BODY;
+		ground.mass = 0.0f;
+		ground.transform2d.translation = { 0.55f, -0.2f };
+		ground.transform2d.rotation = 0.0f;
+		rigidBodySystem.addBody(ground, groundShape);
+		gameObjects.push_back(std::move(ground));
+	}
+
+	void TutorialApp::createBox(glm::vec2 position, float mass)
+	{
+		RocketGameObject box = RocketGameObject::createGameObject();
+		box.model = boxModel;
+		box.color = { 0.8f, 0.5f, 0.2f };
+		box.type = RocketGameObjectType::RIGID_BODY;
+		box.mass = mass;
+		box.transform2d.translation = position;
+		box.transform2d.rotation = 0.0f;
+		rigidBodySystem.addBody(box, boxShape);
+		gameObjects.push_back(std::move(box));
+	}
+
+	void TutorialApp::createBoxPyramid(glm::vec2 base, int rows)
+	{
+		// base is the bottom centre, y grows downwards
+		const float size = 0.04f;
+		for (int row = 0; row < rows; row++) {
+			int boxes = rows - row;
+			float left = base.x - 0.5f * (boxes - 1) * size;
+			for (int i = 0; i < boxes; i++) {
+				createBox({ left + i * size, base.y - 0.5f * size - row * size }, 1.0f);
+			}
+		}
 	}
 
 	uint32_t TutorialApp::createParticle(glm::vec2 position)
 	{
+		spawnParticles(1, SpawnShape::box(position, glm::vec2(0.1f)), SpawnDistribution::UNIFORM);
+		return gameObjects.size() - 1;
+	}
 
-		std::uniform_real_distribution<double> distribution(-0.1, 0.1);
+	void TutorialApp::spawnParticles(size_t count, const SpawnShape& shape, SpawnDistribution distribution)
+	{
+		auto start = std::chrono::steady_clock::now();
+		generateSpawnPositions(count, shape, distribution, random, spawnPositions);
+
+		// One reservation per spawn, grown geometrically so repeated small spawns don't reallocate every time
+		size_t required = gameObjects.size() + count;
+		if (gameObjects.capacity() < required) {
+			gameObjects.reserve(std::max(required, 2 * gameObjects.capacity()));
+		}
+		for (const glm::vec2& position : spawnPositions) {
+			gameObjects.push_back(RocketGameObject::createGameObject());
+			RocketGameObject& particle = gameObjects.back();
+			particle.model = circleModel;
+			particle.color = { 40, 40, 40 };
+			particle.mass = 1.0f;
+			particle.gravityApplied = true;
+			particle.collisionApplied = true;
+			particle.type = RocketGameObjectType::PARTICLE;
+			particle.radius = 0.01f;
+			particle.acceleration = { 0.0f, 3.f };
+			particle.transform2d.translation = position;
+		}
+		lastSpawnMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	RocketGameObject::id_t TutorialApp::createConstrainedParticle(glm::vec2 position)
+	{
 		RocketGameObject gameObject = RocketGameObject::createGameObject();
 		gameObject.model = circleModel;
 		gameObject.color = { 40, 40, 40 };
 		gameObject.mass = 1.0f;
 		gameObject.gravityApplied = true;
-		gameObject.collisionApplied = true;
+		gameObject.constraintsApplied = true;
 		gameObject.type = RocketGameObjectType::PARTICLE;
 		gameObject.radius = 0.01f;
-		gameObject.acceleration = { 0.0f, 3.f };
-		gameObject.transform2d.translation = {position.x + distribution(generator), position.y +distribution(generator)};
-
-		//gameObject.velocity = { distribution(generator),  distribution(generator) };
-		gameObject.velocity = { 0.0f, 0.0f };
+		gameObject.transform2d.translation = position;
+		RocketGameObject::id_t id = gameObject.getId();
 		gameObjects.push_back(std::move(gameObject));
-		//return std::make_unique<RocketGameObject>(gameObjects.back());
-		return gameObjects.size() - 1;
+		return id;
+	}
+
+	void TutorialApp::createRope(glm::vec2 anchor, int links)
+	{
+		const float spacing = 0.02f;
+		std::vector<RocketGameObject::id_t> rope;
+		for (int i = 0; i <= links; i++) {
+			rope.push_back(createConstrainedParticle({ anchor.x + i * spacing, anchor.y }));
+		}
+		for (int i = 0; i < links; i++) {
+			constraintSolver.addDistanceConstraint(rope[i], rope[i + 1], spacing);
+		}
+		for (int i = 0; i + 1 < links; i++) {
+			constraintSolver.addBendingConstraint(rope[i], rope[i + 2], 2 * spacing);
+		}
+		constraintSolver.addPinConstraint(rope[0], anchor);
+	}
+
+	void TutorialApp::createCloth(glm::vec2 topLeft, int columns, int rows)
+	{
+		const float spacing = 0.02f;
+		std::vector<RocketGameObject::id_t> cloth;
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				cloth.push_back(createConstrainedParticle(topLeft + glm::vec2(x * spacing, y * spacing)));
+			}
+		}
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				if (x + 1 < columns) {
+					constraintSolver.addDistanceConstraint(cloth[y * columns + x], cloth[y * columns + x + 1], spacing);
+				}
+				if (y + 1 < rows) {
+					constraintSolver.addDistanceConstraint(cloth[y * columns + x], cloth[(y + 1) * columns + x], spacing);
+				}
+			}
+		}
+		constraintSolver.addPinConstraint(cloth[0], topLeft);
+		constraintSolver.addPinConstraint(cloth[columns - 1], topLeft + glm::vec2((columns - 1) * spacing, 0.0f));
 	}
 
 	uint32_t TutorialApp::getSelectedParticle(float xMouse, float yMouse)
 	{
 		for (auto& particle : gameObjects) {
+			if (particle.type != RocketGameObjectType::PARTICLE) {
+				continue;
+			}
 			float xPart = particle.transform2d.translation.x;
 			float yPart = particle.transform2d.translation.y;
 
@@ -152,6 +554,11 @@ namespace rocket {
 
 	uint32_t TutorialApp::getParticleIndex(uint32_t particleId)
 	{
+		// Exact unless objects were added or removed since the last reorder
+		uint32_t index = particleReorder.indexOf(particleId);
+		if (index < gameObjects.size() && gameObjects[index].getId() == particleId) {
+			return index;
+		}
 		uint32_t counter = 0;
 		for (auto& particle : gameObjects) {
 			if (particle.getId() == particleId) {
@@ -164,7 +571,550 @@ namespace rocket {
 	void TutorialApp::clearSimulation()
 	{
 		gameObjects.clear();
+		constraintSolver.clear();
+		rigidBodySystem.clear();
+		emitterSystem.clear();
+		if (levelModel != nullptr) {
+			addLevelObject();
+		}
 	}
 
+	void TutorialApp::restartSimulation(uint64_t seed)
+	{
+		clearSimulation();
+		sleepSystem.reset();
+		particleReorder.restartSchedule();
+		random.setSeed(seed);
+		emitterSystem.setSeed(seed + 1);
+	}
 
+	SimulationSettings TutorialApp::simulationSettings() const
+	{
+		SimulationSettings settings{};
+		settings.fluidMode = fluidMode;
+		settings.sleepEnabled = sleepEnabled;
+		settings.continuousCollision = continuousCollision;
+		settings.reorderEnabled = reorderEnabled;
+		settings.reorderInterval = particleReorder.reorderInterval;
+		settings.reorderCellSize = particleReorder.cellSize;
+		settings.constraintSubsteps = constraintSolver.substeps;
+		settings.constraintIterations = constraintSolver.iterations;
+		settings.smoothingRadius = fluidSystem.smoothingRadius;
+		settings.restDensity = fluidSystem.restDensity;
+		settings.stiffness = fluidSystem.stiffness;
+		settings.viscosity = fluidSystem.viscosity;
+		settings.fluidMaxSubsteps = fluidSystem.maxSubsteps;
+		settings.sleepSpeed = sleepSystem.sleepSpeed;
+		settings.wakeSpeed = sleepSystem.wakeSpeed;
+		settings.timeToSleep = sleepSystem.timeToSleep;
+		settings.rigidVelocityIterations = rigidBodySystem.velocityIterations;
+		settings.rigidRelaxIterations = rigidBodySystem.relaxIterations;
+		settings.rigidFriction = rigidBodySystem.friction;
+		settings.baumgarte = rigidBodySystem.baumgarte;
+		settings.linearSlop = rigidBodySystem.linearSlop;
+		settings.maxCorrectionSpeed = rigidBodySystem.maxCorrectionSpeed;
+		settings.rigidMaxTimeStep = rigidBodySystem.maxTimeStep;
+		settings.rigidMaxSubsteps = rigidBodySystem.maxSubsteps;
+		settings.broadphase = static_cast<uint32_t>(rigidBodySystem.broadphaseType());
+		settings.fastMotionFraction = continuousCollisionSystem.fastMotionFraction;
+		settings.continuousMaxPasses = continuousCollisionSystem.maxPasses;
+		settings.demoLevel = levelModel != nullptr;
+		settings.worldDistanceField = worldColliders.useDistanceField;
+		settings.worldRestitution = worldColliders.restitution;
+		settings.worldFriction = worldColliders.friction;
+		return settings;
+	}
+
+	void TutorialApp::applySimulationSettings(const SimulationSettings& settings)
+	{
+		fluidMode = settings.fluidMode != 0;
+		sleepEnabled = settings.sleepEnabled != 0;
+		continuousCollision = settings.continuousCollision != 0;
+		reorderEnabled = settings.reorderEnabled != 0;
+		particleReorder.reorderInterval = settings.reorderInterval;
+		particleReorder.cellSize = settings.reorderCellSize;
+		constraintSolver.substeps = settings.constraintSubsteps;
+		constraintSolver.iterations = settings.constraintIterations;
+		fluidSystem.smoothingRadius = settings.smoothingRadius;
+		fluidSystem.restDensity = settings.restDensity;
+		fluidSystem.stiffness = settings.stiffness;
+		fluidSystem.viscosity = settings.viscosity;
+		fluidSystem.maxSubsteps = settings.fluidMaxSubsteps;
+		sleepSystem.sleepSpeed = settings.sleepSpeed;
+		sleepSystem.wakeSpeed = settings.wakeSpeed;
+		sleepSystem.timeToSleep = settings.timeToSleep;
+		rigidBodySystem.velocityIterations = settings.rigidVelocityIterations;
+		rigidBodySystem.relaxIterations = settings.rigidRelaxIterations;
+		rigidBodySystem.friction = settings.rigidFriction;
+		rigidBodySystem.baumgarte = settings.baumgarte;
+		rigidBodySystem.linearSlop = settings.linearSlop;
+		rigidBodySystem.maxCorrectionSpeed = settings.maxCorrectionSpeed;
+		rigidBodySystem.maxTimeStep = settings.rigidMaxTimeStep;
+		rigidBodySystem.maxSubsteps = settings.rigidMaxSubsteps;
+		rigidBodySystem.setBroadphase(static_cast<BroadphaseType>(settings.broadphase));
+		continuousCollisionSystem.fastMotionFraction = settings.fastMotionFraction;
+		continuousCollisionSystem.maxPasses = settings.continuousMaxPasses;
+		setDemoLevel(settings.demoLevel != 0);
+		worldColliders.useDistanceField = settings.worldDistanceField != 0;
+		worldColliders.restitution = settings.worldRestitution;
+		worldColliders.friction = settings.worldFriction;
+	}
+
+	// Models a snapshot can refer to, by index. Only append to this so older snapshots keep their models.
+	// An entry is null if its model failed to load, objects saved with it come back without a model.
+	std::vector<std::shared_ptr<RocketModel>> TutorialApp::snapshotModels() const
+	{
+		return { circleModel, levelModel, boxModel, groundModel, meshModel };
+	}
+
+	void TutorialApp::loadSnapshot(const std::string& filepath)
+	{
+		// Throws before anything is cleared if the file can't be used
+		RocketSnapshot snapshot{ filepath };
+		if (verifySnapshots && !snapshot.verify()) {
+			throw std::runtime_error("Snapshot is damaged: " + filepath);
+		}
+
+		std::vector<RocketGameObject> restored;
+		std::vector<uint32_t> bodyShapes;
+		snapshot.restore(restored, snapshotModels(), bodyShapes);
+		for (uint32_t shape : bodyShapes) {
+			if (shape >= rigidBodySystem.shapeCount()) {
+				throw std::runtime_error("Unknown rigid body shape " + std::to_string(shape) + " in " + filepath);
+			}
+		}
+
+		// The snapshot holds the level object too, so nothing is added back here
+		constraintSolver.clear();
+		rigidBodySystem.clear();
+		emitterSystem.clear();
+		gameObjects.swap(restored);
+		emitterSystem.adoptOrphans(gameObjects);
+		size_t body = 0;
+		for (const auto& object : gameObjects) {
+			if (object.type == RocketGameObjectType::RIGID_BODY) {
+				rigidBodySystem.addBody(object, bodyShapes[body++]);
+			}
+		}
+	}
+
+	void TutorialApp::drawMemoryWindow()
+	{
+		constexpr float MB = 1024.0f * 1024.0f;
+		MemoryStats stats = rocketDevice.getMemoryStats();
+
+		ImGui::Begin("GPU memory");
+		ImGui::TextUnformatted(stats.budgetExtension ? "Budget from VK_EXT_memory_budget" : "Budget is heap size (no VK_EXT_memory_budget)");
+		for (size_t i = 0; i < stats.heaps.size(); i++) {
+			const auto& heap = stats.heaps[i];
+			float usedFraction = heap.budget > 0 ? static_cast<float>(heap.usage) / static_cast<float>(heap.budget) : 0.0f;
+
+			ImGui::Text("Heap %d (%s)", static_cast<int>(i), heap.deviceLocal ? "device local" : "host");
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", heap.usage / MB, heap.budget / MB);
+			bool nearBudget = usedFraction > rocketDevice.memoryWarningThreshold;
+			if (nearBudget) {
+				ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.9f, 0.2f, 0.2f, 1.0f));
+			}
+			ImGui::ProgressBar(usedFraction, ImVec2(-1.0f, 0.0f), overlay);
+			if (nearBudget) {
+				ImGui::PopStyleColor();
+			}
+			// Usage not tracked by RocketDevice is driver overhead and allocations of the ImGui backend
+			ImGui::Text("peak %.1f MB, tracked %.1f MB (peak %.1f MB), untracked %.1f MB",
+				heap.peakUsage / MB,
+				heap.trackedBytes / MB,
+				heap.peakTrackedBytes / MB,
+				heap.usage > heap.trackedBytes ? (heap.usage - heap.trackedBytes) / MB : 0.0f);
+		}
+
+		if (ImGui::BeginTable("memoryCategories", 4, ImGuiTableFlags_Borders)) {
+			ImGui::TableSetupColumn("Category");
+			ImGui::TableSetupColumn("MB");
+			ImGui::TableSetupColumn("Peak MB");
+			ImGui::TableSetupColumn("Allocations");
+			ImGui::TableHeadersRow();
+			for (size_t i = 0; i < stats.categories.size(); i++) {
+				const auto& category = stats.categories[i];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", RocketDevice::memoryCategoryName(static_cast<MemoryCategory>(i)));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", category.bytes / MB);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", category.peakBytes / MB);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", category.allocationCount);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Separator();
+		ImGui::Text("Geometry arena: %u / %u vertices, %u / %u indices",
+			geometryArena.vertexCount(), geometryArena.vertexCapacity(),
+			geometryArena.indexCount(), geometryArena.indexCapacity());
+		ImGui::Text("%d models, %d gaps, %d relocations",
+			static_cast<int>(geometryArena.allocationCount()),
+			static_cast<int>(geometryArena.gaps()),
+			static_cast<int>(geometryArena.relocations()));
+		// Between frames, nothing is being recorded against the arena's buffers here
+		if (ImGui::Button("Compact geometry")) {
+			geometryArena.compact();
+		}
+		ImGui::End();
+	}
+
+	void TutorialApp::drawFluidWindow()
+	{
+		ImGui::Begin("Fluid");
+		ImGui::Checkbox("Fluid mode (SPH)", &fluidMode);
+		ImGui::SliderFloat("Smoothing radius", &fluidSystem.smoothingRadius, 0.01f, 0.1f);
+		ImGui::SliderFloat("Rest density", &fluidSystem.restDensity, 100.0f, 10000.0f);
+		ImGui::SliderFloat("Stiffness", &fluidSystem.stiffness, 1.0f, 500.0f);
+		ImGui::SliderFloat("Viscosity", &fluidSystem.viscosity, 0.0f, 100.0f);
+		ImGui::SliderInt("Max substeps", &fluidSystem.maxSubsteps, 1, 16);
+		ImGui::Text("%d particles, %.1f neighbours on average, %u threads",
+			static_cast<int>(fluidSystem.particleCount()),
+			fluidSystem.averageNeighbours(),
+			threadPool.threadCount() + 1);
+		ImGui::End();
+	}
+
+	void TutorialApp::drawConstraintWindow()
+	{
+		static int ropeLinks = 40;
+		static int clothSize = 30;
+
+		ImGui::Begin("Constraints");
+		ImGui::SliderInt("Rope links", &ropeLinks, 2, 200);
+		if (ImGui::Button("Add rope")) {
+			createRope({ -0.5f, -0.8f }, ropeLinks);
+		}
+		ImGui::SliderInt("Cloth size", &clothSize, 2, 90);
+		if (ImGui::Button("Add cloth")) {
+			createCloth({ -0.2f, -0.9f }, clothSize, clothSize);
+		}
+		ImGui::SliderInt("Substeps", &constraintSolver.substeps, 1, 32);
+		ImGui::SliderInt("Iterations", &constraintSolver.iterations, 1, 16);
+		ImGui::Text("%d constraints in %d colours",
+			static_cast<int>(constraintSolver.constraintCount()),
+			static_cast<int>(constraintSolver.colourCount()));
+		ImGui::End();
+	}
+
+	void TutorialApp::drawSleepWindow()
+	{
+		ImGui::Begin("Sleep");
+		if (ImGui::Checkbox("Sleep settled particles", &sleepEnabled) && !sleepEnabled) {
+			sleepSystem.wakeAll(gameObjects);
+		}
+		ImGui::SliderFloat("Sleep speed", &sleepSystem.sleepSpeed, 0.0f, 0.5f);
+		ImGui::SliderFloat("Wake speed", &sleepSystem.wakeSpeed, 0.0f, 2.0f);
+		ImGui::SliderFloat("Time to sleep", &sleepSystem.timeToSleep, 0.0f, 5.0f);
+		ImGui::Text("%d sleeping particles in %d cells",
+			static_cast<int>(sleepSystem.sleepingParticles()),
+			static_cast<int>(sleepSystem.sleepingCells()));
+		ImGui::Text("%d skipped by the physics step", static_cast<int>(sleepSystem.hiddenParticles()));
+		ImGui::End();
+	}
+
+	void TutorialApp::drawRigidBodyWindow()
+	{
+		static int pyramidRows = 8;
+
+		ImGui::Begin("Rigid bodies");
+		if (ImGui::Button("Add ground")) {
+			addRigidBodyGround();
+		}
+		ImGui::SliderInt("Pyramid rows", &pyramidRows, 1, 16);
+		if (ImGui::Button("Add pyramid")) {
+			createBoxPyramid({ 0.55f, -0.22f }, pyramidRows);
+		}
+		// Tall stacks need more iterations to stay upright
+		ImGui::SliderInt("Velocity iterations", &rigidBodySystem.velocityIterations, 1, 32);
+		ImGui::SliderInt("Relax iterations", &rigidBodySystem.relaxIterations, 0, 8);
+		ImGui::SliderFloat("Friction", &rigidBodySystem.friction, 0.0f, 1.0f);
+		ImGui::SliderInt("Max substeps", &rigidBodySystem.maxSubsteps, 1, 16);
+		ImGui::Text("%d bodies, %d pairs, %d contact points",
+			static_cast<int>(rigidBodySystem.bodyCount()),
+			static_cast<int>(rigidBodySystem.pairCount()),
+			static_cast<int>(rigidBodySystem.contactCount()));
+		ImGui::End();
+	}
+
+	void TutorialApp::drawSpawnWindow()
+	{
+		static int count = 10000;
+		static int shape = 0;
+		static int distribution = 0;
+		static float size = 0.3f;
+		const char* shapes[] = { "Box", "Disc" };
+		const char* distributions[] = { "Uniform", "Gaussian", "Grid" };
+
+		ImGui::Begin("Spawn");
+		ImGui::InputInt("Count", &count, 1000, 100000);
+		count = std::max(count, 0);
+		ImGui::Combo("Shape", &shape, shapes, IM_ARRAYSIZE(shapes));
+		ImGui::Combo("Distribution", &distribution, distributions, IM_ARRAYSIZE(distributions));
+		ImGui::SliderFloat("Size", &size, 0.01f, 1.0f);
+		if (ImGui::Button("Spawn")) {
+			SpawnShape spawnShape = shape == 0 ? SpawnShape::box({ 0.0f, 0.0f }, glm::vec2(size)) : SpawnShape::disc({ 0.0f, 0.0f }, size);
+			spawnParticles(static_cast<size_t>(count), spawnShape, static_cast<SpawnDistribution>(distribution));
+		}
+		ImGui::Text("Last spawn took %.2f ms", lastSpawnMilliseconds);
+		ImGui::End();
+	}
+
+	void TutorialApp::drawEmitterWindow()
+	{
+		ImGui::Begin("Emitters");
+		if (ImGui::Button("Add fountain")) {
+			ParticleEmitter fountain;
+			fountain.shape = SpawnShape::disc({ -0.5f, 0.7f }, 0.02f);
+			fountain.rate = 300.0f;
+			fountain.direction = -glm::half_pi<float>();
+			fountain.coneAngle = 0.3f;
+			fountain.minSpeed = 1.5f;
+			fountain.maxSpeed = 2.0f;
+			fountain.lifetime = 2.5f;
+			fountain.startColor = { 0.3f, 0.6f, 1.0f };
+			fountain.endColor = { 0.1f, 0.2f, 0.6f };
+			fountain.collisionApplied = true;
+			fountain.capacity = 1000;
+			fountain.model = circleModel;
+			emitterSystem.addEmitter(fountain, gameObjects);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Add sparks")) {
+			ParticleEmitter sparks;
+			sparks.shape = SpawnShape::disc({ 0.5f, -0.5f }, 0.01f);
+			sparks.rate = 2000.0f;
+			sparks.coneAngle = glm::two_pi<float>();
+			sparks.minSpeed = 0.5f;
+			sparks.maxSpeed = 1.5f;
+			sparks.lifetime = 0.4f;
+			sparks.capacity = 1000;
+			sparks.model = circleModel;
+			emitterSystem.addEmitter(sparks, gameObjects);
+		}
+		ImGui::Text("%d alive of %d pooled particles",
+			static_cast<int>(emitterSystem.aliveParticles()),
+			static_cast<int>(emitterSystem.pooledParticles()));
+
+		for (size_t i = 0; i < emitterSystem.emitterCount(); i++) {
+			uint32_t id = emitterSystem.emitterId(i);
+			ParticleEmitter* emitter = emitterSystem.getEmitter(id);
+			ImGui::PushID(static_cast<int>(id));
+			ImGui::Checkbox("Enabled", &emitter->enabled);
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(120.0f);
+			ImGui::SliderFloat("Rate", &emitter->rate, 0.0f, 5000.0f);
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(120.0f);
+			ImGui::SliderFloat("Lifetime", &emitter->lifetime, 0.05f, 10.0f);
+			ImGui::SameLine();
+			bool remove = ImGui::Button("Remove");
+			ImGui::PopID();
+			if (remove) {
+				emitterSystem.removeEmitter(id, gameObjects);
+				break;
+			}
+		}
+		ImGui::End();
+	}
+
+	void TutorialApp::drawSnapshotWindow()
+	{
+		static const std::string snapshotPath = "scene.rsnap";
+
+		ImGui::Begin("Snapshot");
+		ImGui::Checkbox("Verify on load", &verifySnapshots);
+		bool busy = snapshotWriter.busy();
+		if (ImGui::Button("Save") && !busy) {
+			snapshotWriter.save(snapshotPath, gameObjects, snapshotModels(), rigidBodySystem.shapesById());
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) {
+			try {
+				// Never read a snapshot that is still being replaced
+				snapshotWriter.wait();
+				auto start = std::chrono::steady_clock::now();
+				loadSnapshot(snapshotPath);
+				lastSnapshotLoadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		if (busy) {
+			ImGui::Text("Writing...");
+		}
+		std::string error = snapshotWriter.lastError();
+		if (!error.empty()) {
+			ImGui::Text("%s", error.c_str());
+		}
+		ImGui::Text("Last save: %d objects, capture %.3f ms, write %.3f ms",
+			static_cast<int>(snapshotWriter.lastRecordCount()),
+			snapshotWriter.lastCaptureMilliseconds(),
+			snapshotWriter.lastWriteMilliseconds());
+		ImGui::Text("Last load: %.3f ms", lastSnapshotLoadMilliseconds);
+		ImGui::End();
+	}
+
+	void TutorialApp::drawInputRecordingWindow()
+	{
+		static const std::string logPath = "input.rlog";
+
+		ImGui::Begin("Input recording");
+		if (!recordingInput) {
+			if (ImGui::Button("Record")) {
+				// Recordings start from a cleared scene, which the replay rebuilds from the seed
+				uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+				restartSimulation(seed);
+				inputLog.begin(seed, simulationSettings());
+				recordingInput = true;
+			}
+		}
+		else if (ImGui::Button("Stop and save")) {
+			recordingInput = false;
+			try {
+				inputLog.save(logPath);
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		ImGui::SameLine();
+		ImGui::Text("%d frames", static_cast<int>(inputLog.frameCount()));
+		// Only the main window's spawn, drag and clear are recorded, along with every frame's dt and the
+		// simulation settings at the start
+		ImGui::Text("Replay with: Rocket --replay %s", logPath.c_str());
+		ImGui::End();
+	}
+
+	void TutorialApp::drawReorderWindow()
+	{
+		ImGui::Begin("Particle order");
+		ImGui::Checkbox("Morton reorder", &reorderEnabled);
+		ImGui::SliderInt("Reorder interval (frames)", &particleReorder.reorderInterval, 1, 600);
+		ImGui::Checkbox("Probe every reorder", &particleReorder.probeEveryReorder);
+		if (ImGui::Button("Reorder now")) {
+			particleReorder.reorder(gameObjects, true);
+		}
+		ImGui::Text("%d reorders, last took %.3f ms",
+			static_cast<int>(particleReorder.reorderCount()),
+			particleReorder.reorderMilliseconds());
+		// How scattered the particles had become, and what that cost a neighbour walk
+		ImGui::Text("Index gap between spatial neighbours before reorder: %.1f", particleReorder.indexGapBefore());
+		ImGui::Text("Neighbour walk %.3f ms before, %.3f ms after",
+			particleReorder.probeMillisecondsBefore(),
+			particleReorder.probeMillisecondsAfter());
+		// What the order is for: the physics step, averaged separately while reordering is on and off
+		ImGui::Text("Physics step %.3f ms reordered, %.3f ms unordered",
+			physicsMillisecondsReordered,
+			physicsMillisecondsUnordered);
+		if (ImGui::Button("Reset timings")) {
+			physicsMillisecondsReordered = 0.0;
+			physicsMillisecondsUnordered = 0.0;
+		}
+		ImGui::End();
+	}
+
+	void TutorialApp::drawBroadphaseWindow()
+	{
+		static const std::string recordingPath = "broadphase_scene.bin";
+		const BroadphaseType types[] = { BroadphaseType::UNIFORM_GRID, BroadphaseType::SORT_AND_SWEEP, BroadphaseType::DYNAMIC_TREE };
+
+		ImGui::Begin("Broadphase");
+		if (ImGui::BeginCombo("Rigid body broadphase", Broadphase::typeName(rigidBodySystem.broadphaseType()))) {
+			for (BroadphaseType type : types) {
+				if (ImGui::Selectable(Broadphase::typeName(type), type == rigidBodySystem.broadphaseType())) {
+					rigidBodySystem.setBroadphase(type);
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		ImGui::Checkbox("Record particle scene", &recordingBroadphase);
+		ImGui::SameLine();
+		ImGui::Text("%d frames", static_cast<int>(broadphaseRecording.frameCount()));
+		if (ImGui::Button("Clear recording")) {
+			broadphaseRecording.clear();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Save")) {
+			try {
+				broadphaseRecording.save(recordingPath);
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) {
+			try {
+				broadphaseRecording.load(recordingPath);
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		if (ImGui::Button("Compare broadphases")) {
+			recordingBroadphase = false;
+			broadphaseReports = compareBroadphases(broadphaseRecording);
+			for (const auto& report : broadphaseReports) {
+				std::cout << Broadphase::typeName(report.type) << ": " << report.frames << " frames, "
+					<< report.totalPairs << " pairs, update " << report.updateMilliseconds << " ms, pairs "
+					<< report.pairMilliseconds << " ms" << std::endl;
+			}
+		}
+
+		if (!broadphaseReports.empty() && ImGui::BeginTable("broadphaseReports", 4, ImGuiTableFlags_Borders)) {
+			ImGui::TableSetupColumn("Broadphase");
+			ImGui::TableSetupColumn("Pairs");
+			ImGui::TableSetupColumn("Update ms/frame");
+			ImGui::TableSetupColumn("Pairs ms/frame");
+			ImGui::TableHeadersRow();
+			for (const auto& report : broadphaseReports) {
+				double frames = std::max<double>(1.0, static_cast<double>(report.frames));
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", Broadphase::typeName(report.type));
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", static_cast<int>(report.totalPairs));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", report.updateMilliseconds / frames);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", report.pairMilliseconds / frames);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+
+	void TutorialApp::drawMeshWindow()
+	{
+		ImGui::Begin("Mesh");
+		// Outside the frame, so the reload is free to grow the arena
+		if (ImGui::Button(meshModel != nullptr ? "Reload" : "Load")) {
+			loadMeshModel();
+		}
+		if (meshModel != nullptr) {
+			ImGui::SameLine();
+			if (ImGui::Button("Place")) {
+				RocketGameObject object = RocketGameObject::createGameObject();
+				object.model = meshModel;
+				object.color = { 0.9f, 0.9f, 0.9f };
+				object.transform2d.translation = viewCenter;
+				object.transform2d.scale = glm::vec2(0.1f);
+				gameObjects.push_back(std::move(object));
+			}
+			ImGui::Text("%u vertices, %u indices, %s in %.3f ms",
+				meshLoadInfo.vertexCount,
+				meshLoadInfo.indexCount,
+				meshLoadInfo.cached ? "from the cooked file" : "parsed and cooked",
+				meshLoadInfo.milliseconds);
+		}
+		ImGui::End();
+	}
 }
@@ -7,8 +7,26 @@
 #include <vector>
 #include "rocket_model.hpp"
 #include "rocket_game_object.hpp"
+#include "rocket_pipeline_manager.hpp"
+#include "rocket_shader_watcher.hpp"
+#include "rocket_thread_pool.hpp"
 
 #include "physics_system.hpp"
+#include "fluid_system.hpp"
+#include "constraint_solver.hpp"
+#include "sleep_system.hpp"
+#include "continuous_collision_system.hpp"
+#include "world_colliders.hpp"
+#include "rigid_body_system.hpp"
+#include "broadphase.hpp"
+#include "particle_reorder.hpp"
+#include "particle_spawner.hpp"
+#include "rocket_random.hpp"
+#include "emitter_system.hpp"
+#include "rocket_snapshot.hpp"
+#include "input_log.hpp"
+#include "transform_system.hpp"
+#include "rocket_mesh.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
@@ -23,24 +41,114 @@ namespace rocket {
 		std::string fragShaderPath = "shaders/simple_shader.frag.spv";
 		std::string vertShaderPath = "shaders/simple_shader.vert.spv";
 
-		TutorialApp();
+		// demoLevel starts with the world collider demo level, see setDemoLevel()
+		TutorialApp(bool demoLevel = false);
 		~TutorialApp();
 
 		TutorialApp(const TutorialApp&) = delete;
 		TutorialApp &operator=(const TutorialApp &) = delete; // Disable copying TutorialApp
 
 		void run();
+		// Steps the simulation through an input log without rendering, checking every frame's state hash.
+		// Returns EXIT_SUCCESS when all frames match.
+		int replay(const std::string& logPath);
 	private:
 		void loadGameObjects();
+		// (Re)loads meshModel, objects showing the previous mesh move to the new one. Errors go to std::cerr.
+		void loadMeshModel();
+		// The funnel, rolling floor and shapes of the world collider demo. Off by default, the scene then
+		// has no world colliders like before they existed.
+		void setDemoLevel(bool enabled);
+		void loadLevel();
+		void addLevelObject();
 		uint32_t createParticle(glm::vec2 position);
+		void spawnParticles(size_t count, const SpawnShape& shape, SpawnDistribution distribution);
+		RocketGameObject::id_t createConstrainedParticle(glm::vec2 position);
+		void createRope(glm::vec2 anchor, int links);
+		void createCloth(glm::vec2 topLeft, int columns, int rows);
+		void loadRigidBodyShapes();
+		void addRigidBodyGround();
+		void createBox(glm::vec2 position, float mass);
+		void createBoxPyramid(glm::vec2 base, int rows);
 		uint32_t getSelectedParticle(float xMouse, float yMouse);
 		uint32_t getParticleIndex(uint32_t particleId);
 		void clearSimulation();
+		// Cleared scene with every random stream seeded, the starting point of a recording and its replay
+		void restartSimulation(uint64_t seed);
+		SimulationSettings simulationSettings() const;
+		void applySimulationSettings(const SimulationSettings& settings);
+		void applyInput(const InputCommand& command);
+		void stepSimulation(float dt);
+		void shutdownImgui();
+		std::vector<std::shared_ptr<RocketModel>> snapshotModels() const;
+		void loadSnapshot(const std::string& filepath);
+		void drawMemoryWindow();
+		void drawFluidWindow();
+		void drawConstraintWindow();
+		void drawSleepWindow();
+		void drawRigidBodyWindow();
+		void drawBroadphaseWindow();
+		void drawReorderWindow();
+		void drawSpawnWindow();
+		void drawEmitterWindow();
+		void drawSnapshotWindow();
+		void drawInputRecordingWindow();
+		void drawMeshWindow();
 		RocketWindow rocketWindow{ WIDTH, HEIGHT, "Rocket" };
 		RocketDevice rocketDevice{ rocketWindow };
 		RocketRenderer rocketRenderer{ rocketWindow, rocketDevice };
+		RocketPipelineManager pipelineManager{ rocketDevice };
+		// Before every model holder, models free their range on destruction
+		RocketGeometryArena geometryArena{ rocketDevice };
+		RocketShaderWatcher shaderWatcher{ "shaders" };
 		std::vector<RocketGameObject> gameObjects;
 		PhysicsSystem physicsSystem{ glm::vec2(0.0f, 3.0f) };
+		RocketThreadPool threadPool{};
+		RocketSnapshotWriter snapshotWriter{ threadPool };
+		FluidSystem fluidSystem{ glm::vec2(0.0f, 3.0f), threadPool };
+		bool fluidMode = false;
+		ConstraintSolver constraintSolver{ glm::vec2(0.0f, 3.0f), threadPool };
+		SleepSystem sleepSystem{};
+		bool sleepEnabled = true;
+		ContinuousCollisionSystem continuousCollisionSystem{ threadPool };
+		bool continuousCollision = true;
+		WorldColliders worldColliders{ threadPool };
+		std::shared_ptr<RocketModel> levelModel = nullptr;
+		RigidBodySystem rigidBodySystem{ glm::vec2(0.0f, 3.0f) };
+		uint32_t boxShape = 0;
+		uint32_t groundShape = 0;
+		std::shared_ptr<RocketModel> boxModel = nullptr;
+		std::shared_ptr<RocketModel> groundModel = nullptr;
+		BroadphaseRecording broadphaseRecording{};
+		bool recordingBroadphase = false;
+		std::vector<BroadphaseReport> broadphaseReports;
+		ParticleReorder particleReorder{};
+		RocketRandom random{};
+		std::vector<glm::vec2> spawnPositions;
+		double lastSpawnMilliseconds = 0.0;
+		EmitterSystem emitterSystem{};
+		bool reorderEnabled = false;
+		// Running averages of PhysicsSystem::updatePhysics, with the Morton reorder on and off
+		double physicsMillisecondsReordered = 0.0;
+		double physicsMillisecondsUnordered = 0.0;
+		double lastSnapshotLoadMilliseconds = 0.0;
+		// Hash every record before loading, for files that may have been damaged after writing
+		bool verifySnapshots = false;
+		TransformSystem transformSystem{};
+		enum class RenderPath {
+			// SimpleRenderSystem, one push constant block and draw per object
+			SIMPLE,
+			INSTANCED,
+			INDIRECT
+		};
+		// Push constants until the instanced shaders are built and checked to render the same colours
+		RenderPath renderPath = RenderPath::SIMPLE;
+		glm::vec2 viewCenter{ 0.0f };
+		float viewZoom = 1.0f;
+		InputLog inputLog{};
+		bool recordingInput = false;
 		std::shared_ptr<RocketModel> circleModel = nullptr;
+		std::shared_ptr<RocketModel> meshModel = nullptr;
+		MeshLoadInfo meshLoadInfo{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,464 @@
+#include "world_colliders.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace rocket {
+	static constexpr uint32_t MAX_LEAF_PRIMITIVES = 4;
+	static constexpr int MAX_TRAVERSAL_DEPTH = 64;
+	static constexpr int MAX_ADVANCEMENT_STEPS = 32;
+
+	bool DistanceFieldGrid::sample(glm::vec2 position, float& distance, glm::vec2& gradient) const
+	{
+		if (width < 2 || height < 2) {
+			return false;
+		}
+		glm::vec2 local = (position - origin) / cellSize;
+		if (local.x < 0.0f || local.y < 0.0f || local.x > width - 1 || local.y > height - 1) {
+			return false;
+		}
+		int x = std::min(static_cast<int>(local.x), width - 2);
+		int y = std::min(static_cast<int>(local.y), height - 2);
+		float tx = local.x - x;
+		float ty = local.y - y;
+		float d00 = distances[y * width + x];
+		float d10 = distances[y * width + x + 1];
+		float d01 = distances[(y + 1) * width + x];
+		float d11 = distances[(y + 1) * width + x + 1];
+		distance = (d00 * (1.0f - tx) + d10 * tx) * (1.0f - ty) + (d01 * (1.0f - tx) + d11 * tx) * ty;
+		gradient.x = ((d10 - d00) * (1.0f - ty) + (d11 - d01) * ty) / cellSize;
+		gradient.y = ((d01 - d00) * (1.0f - tx) + (d11 - d10) * tx) / cellSize;
+		return true;
+	}
+
+	WorldColliders::WorldColliders(RocketThreadPool& threadPool) : threadPool{ threadPool }
+	{
+	}
+
+	void WorldColliders::addSegment(glm::vec2 a, glm::vec2 b)
+	{
+		addCapsule(a, b, 0.0f);
+	}
+
+	void WorldColliders::addCapsule(glm::vec2 a, glm::vec2 b, float radius)
+	{
+		capsules.push_back({ a, b, radius });
+		primitives.push_back({ PrimitiveType::CAPSULE, static_cast<uint32_t>(capsules.size() - 1),
+			glm::min(a, b) - glm::vec2(radius), glm::max(a, b) + glm::vec2(radius) });
+		dirty = true;
+	}
+
+	void WorldColliders::addPolygon(const std::vector<glm::vec2>& vertices)
+	{
+		if (vertices.size() < 3) {
+			throw std::runtime_error("Polygon collider needs at least 3 vertices");
+		}
+		Polygon polygon{ static_cast<uint32_t>(polygonVertices.size()), static_cast<uint32_t>(vertices.size()) };
+		glm::vec2 lower = vertices[0];
+		glm::vec2 upper = vertices[0];
+		for (const auto& vertex : vertices) {
+			polygonVertices.push_back(vertex);
+			lower = glm::min(lower, vertex);
+			upper = glm::max(upper, vertex);
+		}
+		polygons.push_back(polygon);
+		primitives.push_back({ PrimitiveType::POLYGON, static_cast<uint32_t>(polygons.size() - 1), lower, upper });
+		dirty = true;
+	}
+
+	void WorldColliders::addDistanceField(DistanceFieldGrid field)
+	{
+		if (field.width < 2 || field.height < 2 || field.distances.size() != static_cast<size_t>(field.width) * field.height) {
+			throw std::runtime_error("Distance field collider has an invalid size");
+		}
+		fields.push_back(std::move(field));
+		primitives.push_back({ PrimitiveType::DISTANCE_FIELD, static_cast<uint32_t>(fields.size() - 1),
+			fields.back().boundsMin(), fields.back().boundsMax() });
+		dirty = true;
+	}
+
+	void WorldColliders::loadColliders(const std::string& filepath)
+	{
+		std::ifstream file{ filepath };
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line)) {
+			lineNumber++;
+			line = line.substr(0, line.find('#'));
+			std::istringstream stream{ line };
+			std::string kind;
+			if (!(stream >> kind)) {
+				continue;
+			}
+			std::vector<float> values;
+			float value;
+			while (stream >> value) {
+				values.push_back(value);
+			}
+			if (!stream.eof()) {
+				throw std::runtime_error("Invalid number in " + filepath + " line " + std::to_string(lineNumber));
+			}
+
+			if (kind == "segment" && values.size() == 4) {
+				addSegment({ values[0], values[1] }, { values[2], values[3] });
+			}
+			else if (kind == "capsule" && values.size() == 5) {
+				addCapsule({ values[0], values[1] }, { values[2], values[3] }, values[4]);
+			}
+			else if (kind == "polygon" && values.size() >= 6 && values.size() % 2 == 0) {
+				std::vector<glm::vec2> vertices;
+				for (size_t i = 0; i < values.size(); i += 2) {
+					vertices.push_back({ values[i], values[i + 1] });
+				}
+				addPolygon(vertices);
+			}
+			else {
+				throw std::runtime_error("Invalid collider in " + filepath + " line " + std::to_string(lineNumber));
+			}
+		}
+	}
+
+	void WorldColliders::clear()
+	{
+		capsules.clear();
+		polygons.clear();
+		polygonVertices.clear();
+		fields.clear();
+		primitives.clear();
+		nodes.clear();
+		bakedField = DistanceFieldGrid{};
+		dirty = false;
+	}
+
+	void WorldColliders::build()
+	{
+		nodes.clear();
+		dirty = false;
+		if (primitives.empty()) {
+			return;
+		}
+		nodes.reserve(2 * primitives.size());
+		nodes.push_back({});
+		buildNode(0, 0, static_cast<uint32_t>(primitives.size()));
+	}
+
+	// Top down median split on the longest axis of the primitive centres. The hierarchy is built once per
+	// level, so build speed matters less than the query never visiting more than a few leaves.
+	void WorldColliders::buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count)
+	{
+		glm::vec2 lower = primitives[first].boundsMin;
+		glm::vec2 upper = primitives[first].boundsMax;
+		glm::vec2 centreLower{ FLT_MAX };
+		glm::vec2 centreUpper{ -FLT_MAX };
+		for (uint32_t i = first; i < first + count; i++) {
+			lower = glm::min(lower, primitives[i].boundsMin);
+			upper = glm::max(upper, primitives[i].boundsMax);
+			glm::vec2 centre = (primitives[i].boundsMin + primitives[i].boundsMax) * 0.5f;
+			centreLower = glm::min(centreLower, centre);
+			centreUpper = glm::max(centreUpper, centre);
+		}
+		nodes[nodeIndex].boundsMin = lower;
+		nodes[nodeIndex].boundsMax = upper;
+		if (count <= MAX_LEAF_PRIMITIVES) {
+			nodes[nodeIndex].first = first;
+			nodes[nodeIndex].primitiveCount = count;
+			return;
+		}
+
+		int axis = centreUpper.x - centreLower.x >= centreUpper.y - centreLower.y ? 0 : 1;
+		uint32_t half = count / 2;
+		std::nth_element(primitives.begin() + first, primitives.begin() + first + half, primitives.begin() + first + count,
+			[axis](const Primitive& a, const Primitive& b) {
+				return a.boundsMin[axis] + a.boundsMax[axis] < b.boundsMin[axis] + b.boundsMax[axis];
+			});
+
+		uint32_t children = static_cast<uint32_t>(nodes.size());
+		nodes.push_back({});
+		nodes.push_back({});
+		nodes[nodeIndex].first = children;
+		nodes[nodeIndex].primitiveCount = 0;
+		buildNode(children, first, half);
+		buildNode(children + 1, first + half, count - half);
+	}
+
+	float WorldColliders::signedDistance(const Primitive& primitive, glm::vec2 position, glm::vec2& normal) const
+	{
+		switch (primitive.type) {
+		case PrimitiveType::CAPSULE: {
+			const Capsule& capsule = capsules[primitive.index];
+			glm::vec2 edge = capsule.b - capsule.a;
+			float lengthSquared = glm::dot(edge, edge);
+			float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(position - capsule.a, edge) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+			glm::vec2 offset = position - (capsule.a + edge * t);
+			float length = glm::length(offset);
+			if (length > 1e-7f) {
+				normal = offset / length;
+			}
+			else {
+				normal = lengthSquared > 0.0f ? glm::normalize(glm::vec2(-edge.y, edge.x)) : glm::vec2(0.0f, -1.0f);
+			}
+			return length - capsule.radius;
+		}
+		case PrimitiveType::POLYGON: {
+			const Polygon& polygon = polygons[primitive.index];
+			const glm::vec2* vertices = polygonVertices.data() + polygon.firstVertex;
+			float closestSquared = FLT_MAX;
+			glm::vec2 closest{ 0.0f };
+			glm::vec2 closestEdge{ 1.0f, 0.0f };
+			bool inside = false;
+			float signedArea = 0.0f;
+			for (uint32_t i = 0, j = polygon.vertexCount - 1; i < polygon.vertexCount; j = i++) {
+				glm::vec2 a = vertices[j];
+				glm::vec2 b = vertices[i];
+				glm::vec2 edge = b - a;
+				float t = glm::clamp(glm::dot(position - a, edge) / std::max(glm::dot(edge, edge), 1e-12f), 0.0f, 1.0f);
+				glm::vec2 point = a + edge * t;
+				glm::vec2 offset = position - point;
+				float distanceSquared = glm::dot(offset, offset);
+				if (distanceSquared < closestSquared) {
+					closestSquared = distanceSquared;
+					closest = point;
+					closestEdge = edge;
+				}
+				// Crossing test against a horizontal ray
+				if ((a.y > position.y) != (b.y > position.y) && position.x < a.x + (position.y - a.y) / (b.y - a.y) * edge.x) {
+					inside = !inside;
+				}
+				signedArea += a.x * b.y - b.x * a.y;
+			}
+			float distance = std::sqrt(closestSquared);
+			if (distance > 1e-7f) {
+				normal = (inside ? closest - position : position - closest) / distance;
+			}
+			else {
+				// On the boundary, use the outward normal of the edge
+				glm::vec2 outward = signedArea > 0.0f ? glm::vec2(closestEdge.y, -closestEdge.x) : glm::vec2(-closestEdge.y, closestEdge.x);
+				normal = glm::normalize(outward);
+			}
+			return inside ? -distance : distance;
+		}
+		case PrimitiveType::DISTANCE_FIELD: {
+			float distance;
+			glm::vec2 gradient;
+			if (!fields[primitive.index].sample(position, distance, gradient)) {
+				return FLT_MAX;
+			}
+			float length = glm::length(gradient);
+			normal = length > 1e-7f ? gradient / length : glm::vec2(0.0f, -1.0f);
+			return distance;
+		}
+		}
+		return FLT_MAX;
+	}
+
+	float WorldColliders::closestDistance(glm::vec2 position, float maxDistance, glm::vec2& normal) const
+	{
+		float closest = FLT_MAX;
+		if (nodes.empty()) {
+			return closest;
+		}
+		glm::vec2 queryMin = position - glm::vec2(maxDistance);
+		glm::vec2 queryMax = position + glm::vec2(maxDistance);
+
+		uint32_t stack[MAX_TRAVERSAL_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (node.boundsMax.x < queryMin.x || node.boundsMin.x > queryMax.x ||
+				node.boundsMax.y < queryMin.y || node.boundsMin.y > queryMax.y) {
+				continue;
+			}
+			if (node.primitiveCount == 0) {
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = node.first + 1;
+				continue;
+			}
+			for (uint32_t i = node.first; i < node.first + node.primitiveCount; i++) {
+				glm::vec2 primitiveNormal;
+				float distance = signedDistance(primitives[i], position, primitiveNormal);
+				if (distance < closest) {
+					closest = distance;
+					normal = primitiveNormal;
+				}
+			}
+		}
+		return closest;
+	}
+
+	void WorldColliders::bakeDistanceField(glm::vec2 boundsMin, glm::vec2 boundsMax, float cellSize)
+	{
+		if (dirty) {
+			build();
+		}
+		bakedField.origin = boundsMin;
+		bakedField.cellSize = cellSize;
+		bakedField.width = static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / cellSize)) + 1;
+		bakedField.height = static_cast<int>(std::ceil((boundsMax.y - boundsMin.y) / cellSize)) + 1;
+		bakedField.distances.resize(static_cast<size_t>(bakedField.width) * bakedField.height);
+
+		// Distances are exact within a band around the colliders and clamped beyond it, which keeps the bake
+		// a BVH query per sample. The band has to cover the largest particle radius.
+		float band = std::max(0.1f, 4.0f * cellSize);
+		threadPool.parallelFor(static_cast<size_t>(bakedField.height), [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				for (int x = 0; x < bakedField.width; x++) {
+					glm::vec2 normal;
+					glm::vec2 position = bakedField.origin + glm::vec2(static_cast<float>(x), static_cast<float>(y)) * cellSize;
+					bakedField.distances[y * bakedField.width + x] = std::min(closestDistance(position, band, normal), band);
+				}
+			}
+		}, 1);
+	}
+
+	bool WorldColliders::queryCircle(glm::vec2 center, float radius, WorldContact& contact) const
+	{
+		float distance;
+		glm::vec2 normal;
+		if (useDistanceField && hasDistanceField()) {
+			glm::vec2 gradient;
+			if (bakedField.sample(center, distance, gradient)) {
+				if (distance >= radius) {
+					return false;
+				}
+				float length = glm::length(gradient);
+				contact.normal = length > 1e-7f ? gradient / length : glm::vec2(0.0f, -1.0f);
+				contact.penetration = radius - distance;
+				return true;
+			}
+		}
+		distance = closestDistance(center, radius, normal);
+		if (distance >= radius) {
+			return false;
+		}
+		contact.normal = normal;
+		contact.penetration = radius - distance;
+		return true;
+	}
+
+	void WorldColliders::resolveParticles(float dt, std::vector<RocketGameObject>& gameObjects)
+	{
+		if (dirty) {
+			build();
+		}
+		if (nodes.empty()) {
+			return;
+		}
+		threadPool.parallelFor(gameObjects.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				auto& object = gameObjects[i];
+				if (object.type != RocketGameObjectType::PARTICLE || object.sleeping) {
+					continue;
+				}
+				// Segments have no thickness, so a particle that moved more than its radius this step is
+				// walked forward from where it started in radius sized steps and stops at the first contact
+				glm::vec2 end = object.transform2d.translation;
+				glm::vec2 motion = object.velocity * dt;
+				float travelled = glm::length(motion);
+				int steps = object.radius > 0.0f ? std::min(MAX_ADVANCEMENT_STEPS, static_cast<int>(std::ceil(travelled / object.radius))) : 1;
+				WorldContact contact;
+				bool hit = false;
+				for (int step = std::max(steps, 1) - 1; step >= 0 && !hit; step--) {
+					glm::vec2 position = end - motion * (static_cast<float>(step) / std::max(steps, 1));
+					if (queryCircle(position, object.radius, contact)) {
+						object.transform2d.translation = position;
+						hit = true;
+					}
+				}
+				if (!hit) {
+					continue;
+				}
+				object.transform2d.translation += contact.normal * contact.penetration;
+				float normalSpeed = glm::dot(object.velocity, contact.normal);
+				if (normalSpeed < 0.0f) {
+					object.velocity -= contact.normal * (normalSpeed * (1.0f + restitution));
+					glm::vec2 tangent = object.velocity - contact.normal * glm::dot(object.velocity, contact.normal);
+					object.velocity -= tangent * friction;
+				}
+			}
+		}, 1024);
+	}
+
+	std::vector<glm::vec2> WorldColliders::buildTriangles(float segmentWidth) const
+	{
+		constexpr int CAP_SEGMENTS = 8;
+		std::vector<glm::vec2> triangles;
+		for (const auto& capsule : capsules) {
+			glm::vec2 edge = capsule.b - capsule.a;
+			float length = glm::length(edge);
+			glm::vec2 direction = length > 0.0f ? edge / length : glm::vec2(1.0f, 0.0f);
+			float halfWidth = std::max(capsule.radius, segmentWidth * 0.5f);
+			glm::vec2 side = glm::vec2(-direction.y, direction.x) * halfWidth;
+			triangles.insert(triangles.end(), { capsule.a - side, capsule.b - side, capsule.b + side });
+			triangles.insert(triangles.end(), { capsule.a - side, capsule.b + side, capsule.a + side });
+			if (capsule.radius <= 0.0f) {
+				continue;
+			}
+			// Half discs on both ends
+			float baseAngle = std::atan2(side.y, side.x);
+			for (int i = 0; i < CAP_SEGMENTS; i++) {
+				float a0 = baseAngle + glm::pi<float>() * i / CAP_SEGMENTS;
+				float a1 = baseAngle + glm::pi<float>() * (i + 1) / CAP_SEGMENTS;
+				glm::vec2 r0 = glm::vec2(std::cos(a0), std::sin(a0)) * capsule.radius;
+				glm::vec2 r1 = glm::vec2(std::cos(a1), std::sin(a1)) * capsule.radius;
+				triangles.insert(triangles.end(), { capsule.a, capsule.a + r0, capsule.a + r1 });
+				triangles.insert(triangles.end(), { capsule.b, capsule.b - r0, capsule.b - r1 });
+			}
+		}
+
+		// Ear clipping, polygons are simple but not necessarily convex
+		for (const auto& polygon : polygons) {
+			std::vector<glm::vec2> remaining(polygonVertices.begin() + polygon.firstVertex,
+				polygonVertices.begin() + polygon.firstVertex + polygon.vertexCount);
+			float signedArea = 0.0f;
+			for (size_t i = 0, j = remaining.size() - 1; i < remaining.size(); j = i++) {
+				signedArea += remaining[j].x * remaining[i].y - remaining[i].x * remaining[j].y;
+			}
+			float orientation = signedArea >= 0.0f ? 1.0f : -1.0f;
+			auto cross = [](glm::vec2 a, glm::vec2 b) { return a.x * b.y - a.y * b.x; };
+			while (remaining.size() > 3) {
+				size_t count = remaining.size();
+				bool clipped = false;
+				for (size_t i = 0; i < count && !clipped; i++) {
+					glm::vec2 a = remaining[(i + count - 1) % count];
+					glm::vec2 b = remaining[i];
+					glm::vec2 c = remaining[(i + 1) % count];
+					if (cross(b - a, c - b) * orientation <= 0.0f) {
+						continue;
+					}
+					bool containsVertex = false;
+					for (size_t k = 0; k < count && !containsVertex; k++) {
+						glm::vec2 p = remaining[k];
+						if (p == a || p == b || p == c) {
+							continue;
+						}
+						containsVertex = cross(b - a, p - a) * orientation >= 0.0f &&
+							cross(c - b, p - b) * orientation >= 0.0f &&
+							cross(a - c, p - c) * orientation >= 0.0f;
+					}
+					if (!containsVertex) {
+						triangles.insert(triangles.end(), { a, b, c });
+						remaining.erase(remaining.begin() + i);
+						clipped = true;
+					}
+				}
+				if (!clipped) {
+					// Degenerate input, drop what is left rather than loop forever
+					break;
+				}
+			}
+			if (remaining.size() == 3) {
+				triangles.insert(triangles.end(), { remaining[0], remaining[1], remaining[2] });
+			}
+		}
+		return triangles;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "rocket_game_object.hpp"
+#include "rocket_thread_pool.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rocket {
+	// Signed distances sampled on a regular grid, negative inside. Used both for SDF colliders and
+	// for the field baked from all colliders by WorldColliders::bakeDistanceField.
+	struct DistanceFieldGrid {
+		glm::vec2 origin{ 0.0f };
+		float cellSize = 0.0f;
+		int width = 0;
+		int height = 0;
+		std::vector<float> distances;
+
+		glm::vec2 boundsMin() const { return origin; }
+		glm::vec2 boundsMax() const { return origin + glm::vec2(width - 1, height - 1) * cellSize; }
+		// Bilinear distance and its gradient, false outside the grid
+		bool sample(glm::vec2 position, float& distance, glm::vec2& gradient) const;
+	};
+
+	struct WorldContact {
+		glm::vec2 normal{ 0.0f };
+		// Positive when the circle overlaps the collider
+		float penetration = 0.0f;
+	};
+
+	// Static level geometry. Colliders are added once, then build() puts them into a bounding volume
+	// hierarchy so a particle only tests the few colliders around it. Optionally the whole set is baked
+	// into a distance field, which turns the query into one grid lookup.
+	class WorldColliders {
+	public:
+		WorldColliders(RocketThreadPool& threadPool);
+
+		WorldColliders(const WorldColliders&) = delete;
+		WorldColliders& operator=(const WorldColliders&) = delete;
+
+		void addSegment(glm::vec2 a, glm::vec2 b);
+		void addCapsule(glm::vec2 a, glm::vec2 b, float radius);
+		// Solid simple polygon, in either winding order
+		void addPolygon(const std::vector<glm::vec2>& vertices);
+		void addDistanceField(DistanceFieldGrid field);
+		// Text file with one collider per line: "segment x0 y0 x1 y1", "capsule x0 y0 x1 y1 r" or
+		// "polygon x0 y0 x1 y1 x2 y2 ...", '#' starts a comment
+		void loadColliders(const std::string& filepath);
+		void clear();
+
+		void build();
+		void bakeDistanceField(glm::vec2 boundsMin, glm::vec2 boundsMax, float cellSize);
+
+		bool queryCircle(glm::vec2 center, float radius, WorldContact& contact) const;
+		// Pushes PARTICLE objects out of the colliders and removes their velocity into the surface.
+		// dt is the step that was just integrated, it is used to find the first contact along the motion.
+		void resolveParticles(float dt, std::vector<RocketGameObject>& gameObjects);
+
+		// Triangle list covering every segment, capsule and polygon, for drawing the level
+		std::vector<glm::vec2> buildTriangles(float segmentWidth) const;
+
+		bool useDistanceField = false;
+		float restitution = 0.2f;
+		float friction = 0.1f;
+
+		size_t colliderCount() const { return primitives.size(); }
+		size_t nodeCount() const { return nodes.size(); }
+		bool hasDistanceField() const { return !bakedField.distances.empty(); }
+	private:
+		enum class PrimitiveType : uint8_t {
+			CAPSULE,
+			POLYGON,
+			DISTANCE_FIELD
+		};
+
+		struct Primitive {
+			PrimitiveType type;
+			uint32_t index;
+			glm::vec2 boundsMin;
+			glm::vec2 boundsMax;
+		};
+
+		struct Capsule {
+			glm::vec2 a;
+			glm::vec2 b;
+			float radius;
+		};
+
+		struct Polygon {
+			uint32_t firstVertex;
+			uint32_t vertexCount;
+		};
+
+		// Leaves have primitiveCount > 0 and own primitives[first, first + primitiveCount),
+		// inner nodes have their children at first and first + 1
+		struct Node {
+			glm::vec2 boundsMin;
+			glm::vec2 boundsMax;
+			uint32_t first;
+			uint32_t primitiveCount;
+		};
+
+		float signedDistance(const Primitive& primitive, glm::vec2 position, glm::vec2& normal) const;
+		// Smallest signed distance over the colliders within maxDistance of position
+		float closestDistance(glm::vec2 position, float maxDistance, glm::vec2& normal) const;
+		void buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count);
+
+		RocketThreadPool& threadPool;
+
+		std::vector<Capsule> capsules;
+		std::vector<Polygon> polygons;
+		std::vector<glm::vec2> polygonVertices;
+		std::vector<DistanceFieldGrid> fields;
+
+		std::vector<Primitive> primitives;
+		std::vector<Node> nodes;
+		bool dirty = false;
+
+		DistanceFieldGrid bakedField;
+	};
+}